@@ -4,7 +4,7 @@ set -e
 # ==============================================================================
 # Unified Build Script for Obsidian Wasm OCR
 # Usage: ./scripts/build.sh [target] [--mode <Release|Debug|RelWithDebInfo>]
-# Targets: plugin (default), test, benchmark
+# Targets: plugin (default), test, benchmark, bench-tools
 # ==============================================================================
 
 # Paths
@@ -25,7 +25,7 @@ NCNN_VARIANT="simd" # Default variant
 while [[ $# -gt 0 ]]; do
   key="$1"
   case $key in
-    plugin|test|benchmark)
+    plugin|test|benchmark|bench-tools)
       TARGET="$key"
       shift
       ;; 
@@ -40,6 +40,7 @@ while [[ $# -gt 0 ]]; do
       echo "  plugin     (Default) Build Obsidian Plugin (Wasm + TS)"
       echo "  test       Build Browser Test (Test Wasm + WWW)"
       echo "  benchmark  Build Benchmark Suite (All Variants + WWW)"
+      echo "  bench-tools Build Node-runnable benchmark tools (tests/bench) for one variant"
       echo ""
       echo "Options:"
       echo "  --mode <mode>    Build Mode: Release (default), Debug, RelWithDebInfo"
@@ -75,11 +76,13 @@ fi
 # ------------------------------------------------------------------------------
 
 # $1: Build Directory, $2: Variant, $3: CMake Target, $4: Export Name (Optional)
+# $5: Extra CMake Arguments (Optional)
 compile_wasm() {
     local BUILD_DIR="$1"
     local CURRENT_VARIANT="$2"
     local MAKE_TARGET="$3"
     local EXPORT_NAME="$4"
+    local EXTRA_CMAKE_ARGS="$5"
 
     echo "-> Compiling $MAKE_TARGET ($CURRENT_VARIANT) in $BUILD_DIR..."
     
@@ -90,6 +93,9 @@ compile_wasm() {
     if [ -n "$EXPORT_NAME" ]; then
         CMAKE_ARGS="$CMAKE_ARGS -DTEST_EXPORT_NAME=$EXPORT_NAME"
     fi
+    if [ -n "$EXTRA_CMAKE_ARGS" ]; then
+        CMAKE_ARGS="$CMAKE_ARGS $EXTRA_CMAKE_ARGS"
+    fi
 
     emcmake cmake "$SRC_CORE" $CMAKE_ARGS
     emmake make "$MAKE_TARGET" -j4
@@ -192,6 +198,20 @@ build_benchmark() {
 
     echo "SUCCESS: Benchmarks built at $WWW_ROOT"
     echo "Run server: python3 scripts/serve_test.py \"$WWW_ROOT\""
+    echo "Or headless: node tests/node/run-variants.cjs (after yarn install in tests/node)"
+}
+
+build_bench_tools() {
+    local BUILD_DIR="$ROOT_DIR/build/bench-tools/$NCNN_VARIANT"
+
+    compile_wasm "$BUILD_DIR" "$NCNN_VARIANT" "corpus-bench" "" "-DOCR_BUILD_BENCH_TOOLS=ON"
+    emmake make conformance sequence-bench text-index-bench -j4
+
+    echo "SUCCESS: Benchmark tools built at $BUILD_DIR"
+    echo "Run: node \"$BUILD_DIR/corpus-bench.js\" <image_dir> --models \"$ROOT_DIR/assets/models\""
+    echo "     node \"$BUILD_DIR/conformance.js\" [--corpus <image_dir>]"
+    echo "     node \"$BUILD_DIR/sequence-bench.js\" <image_dir> --models \"$ROOT_DIR/assets/models\""
+    echo "     node \"$BUILD_DIR/text-index-bench.js\" [--lines 100000]"
 }
 
 # ------------------------------------------------------------------------------
@@ -203,6 +223,8 @@ elif [ "$TARGET" == "test" ]; then
     build_test
 elif [ "$TARGET" == "benchmark" ]; then
     build_benchmark
+elif [ "$TARGET" == "bench-tools" ]; then
+    build_bench_tools
 else
     echo "Error: Unknown target $TARGET"
     exit 1
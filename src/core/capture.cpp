@@ -0,0 +1,196 @@
+#include "capture.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "hash.h"
+
+namespace {
+
+const char CAPTURE_MAGIC[8] = { 'O', 'C', 'R', 'C', 'A', 'P', '0', '2' };
+
+// Fixed-size part of a record (everything but the pixels)
+const size_t RECORD_FIXED_SIZE = 4 * 2 + 4 + 4 * 2 + 4 + 4 * 3 + 4 * 2 + 8 + 4 * 2 + 8 + 4 + 4;
+
+template <typename T>
+void put(std::vector<unsigned char>& buf, T value)
+{
+    unsigned char bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+    buf.insert(buf.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T get(const unsigned char*& p)
+{
+    T value;
+    memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return value;
+}
+
+// Box-filtered RGB copy of an RGBA image, shrunk to fit max_side (if > 0)
+void downscale_rgb(const unsigned char* rgba_data, int width, int height, int max_side, int& out_w, int& out_h,
+    std::vector<unsigned char>& rgb)
+{
+    out_w = width;
+    out_h = height;
+    if (max_side > 0 && std::max(width, height) > max_side) {
+        const double s = (double)max_side / std::max(width, height);
+        out_w = std::max(1, (int)(width * s + 0.5));
+        out_h = std::max(1, (int)(height * s + 0.5));
+    }
+    rgb.resize((size_t)out_w * out_h * 3);
+
+    for (int y = 0; y < out_h; y++) {
+        const int y0 = (int)((long long)y * height / out_h);
+        const int y1 = std::max(y0 + 1, (int)((long long)(y + 1) * height / out_h));
+        for (int x = 0; x < out_w; x++) {
+            const int x0 = (int)((long long)x * width / out_w);
+            const int x1 = std::max(x0 + 1, (int)((long long)(x + 1) * width / out_w));
+            unsigned int sum[3] = { 0, 0, 0 };
+            for (int sy = y0; sy < y1; sy++) {
+                const unsigned char* row = rgba_data + ((size_t)sy * width + x0) * 4;
+                for (int sx = x0; sx < x1; sx++, row += 4) {
+                    sum[0] += row[0];
+                    sum[1] += row[1];
+                    sum[2] += row[2];
+                }
+            }
+            const unsigned int n = (unsigned int)((y1 - y0) * (x1 - x0));
+            unsigned char* dst = &rgb[((size_t)y * out_w + x) * 3];
+            for (int c = 0; c < 3; c++) dst[c] = (unsigned char)((sum[c] + n / 2) / n);
+        }
+    }
+}
+
+} // namespace
+
+std::vector<unsigned char> CaptureRecord::rgba() const
+{
+    std::vector<unsigned char> out((size_t)stored_width * stored_height * 4);
+    for (size_t i = 0, j = 0; j < rgb.size(); i += 4, j += 3) {
+        out[i] = rgb[j];
+        out[i + 1] = rgb[j + 1];
+        out[i + 2] = rgb[j + 2];
+        out[i + 3] = 255;
+    }
+    return out;
+}
+
+uint64_t hash_pixels(const unsigned char* rgba_data, int width, int height)
+{
+    return hash_bytes(rgba_data, (size_t)width * height * 4, 0);
+}
+
+CaptureWriter::~CaptureWriter() { close(); }
+
+bool CaptureWriter::open(const char* path, bool store_pixels, int max_side)
+{
+    close();
+    m_file = fopen(path, "wb");
+    if (!m_file) return false;
+    m_store_pixels = store_pixels;
+    m_max_side = std::max(0, max_side);
+    fwrite(CAPTURE_MAGIC, 1, sizeof(CAPTURE_MAGIC), m_file);
+    fflush(m_file);
+    return true;
+}
+
+void CaptureWriter::close()
+{
+    if (m_file) fclose(m_file);
+    m_file = nullptr;
+}
+
+bool CaptureWriter::write(CaptureRecord& record, const unsigned char* rgba_data)
+{
+    if (!m_file) return false;
+
+    record.pixel_hash = hash_pixels(rgba_data, record.width, record.height);
+    record.stored_width = record.stored_height = 0;
+    record.rgb.clear();
+    if (m_store_pixels) {
+        downscale_rgb(rgba_data, record.width, record.height, m_max_side, record.stored_width,
+            record.stored_height, record.rgb);
+    }
+
+    std::vector<unsigned char> buf;
+    buf.reserve(4 + RECORD_FIXED_SIZE + record.rgb.size());
+    put<uint32_t>(buf, (uint32_t)(RECORD_FIXED_SIZE + record.rgb.size()));
+    put<int32_t>(buf, record.width);
+    put<int32_t>(buf, record.height);
+    put<float>(buf, record.text_score_threshold);
+    put<int32_t>(buf, record.rec_pack_width);
+    put<int32_t>(buf, record.rec_chunk_width);
+    put<float>(buf, record.axis_aligned_tolerance);
+    put<int32_t>(buf, record.rec_pyramid);
+    put<int32_t>(buf, record.postprocess_threads);
+    put<int32_t>(buf, record.num_threads);
+    put<int32_t>(buf, record.sequence_tile);
+    put<int32_t>(buf, record.sequence_margin);
+    put<uint64_t>(buf, record.pixel_hash);
+    put<int32_t>(buf, record.stored_width);
+    put<int32_t>(buf, record.stored_height);
+    buf.insert(buf.end(), record.rgb.begin(), record.rgb.end());
+    put<double>(buf, record.total_ms);
+    put<int32_t>(buf, record.boxes);
+    put<int32_t>(buf, record.store_hit);
+
+    // One flush per call keeps the file usable if the session dies mid-way
+    bool ok = fwrite(buf.data(), 1, buf.size(), m_file) == buf.size();
+    fflush(m_file);
+    return ok;
+}
+
+CaptureReader::~CaptureReader()
+{
+    if (m_file) fclose(m_file);
+}
+
+bool CaptureReader::open(const char* path)
+{
+    if (m_file) fclose(m_file);
+    m_file = fopen(path, "rb");
+    if (!m_file) return false;
+    char magic[sizeof(CAPTURE_MAGIC)];
+    if (fread(magic, 1, sizeof(magic), m_file) != sizeof(magic) || memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0) {
+        fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool CaptureReader::next(CaptureRecord& record)
+{
+    if (!m_file) return false;
+    uint32_t size = 0;
+    if (fread(&size, sizeof(size), 1, m_file) != 1 || size < RECORD_FIXED_SIZE) return false;
+    std::vector<unsigned char> buf(size);
+    if (fread(buf.data(), 1, size, m_file) != size) return false;
+
+    const unsigned char* p = buf.data();
+    record.width = get<int32_t>(p);
+    record.height = get<int32_t>(p);
+    record.text_score_threshold = get<float>(p);
+    record.rec_pack_width = get<int32_t>(p);
+    record.rec_chunk_width = get<int32_t>(p);
+    record.axis_aligned_tolerance = get<float>(p);
+    record.rec_pyramid = get<int32_t>(p);
+    record.postprocess_threads = get<int32_t>(p);
+    record.num_threads = get<int32_t>(p);
+    record.sequence_tile = get<int32_t>(p);
+    record.sequence_margin = get<int32_t>(p);
+    record.pixel_hash = get<uint64_t>(p);
+    record.stored_width = get<int32_t>(p);
+    record.stored_height = get<int32_t>(p);
+    const size_t pixel_bytes = (size_t)std::max(record.stored_width, 0) * std::max(record.stored_height, 0) * 3;
+    if (pixel_bytes != size - RECORD_FIXED_SIZE) return false;
+    record.rgb.assign(p, p + pixel_bytes);
+    p += pixel_bytes;
+    record.total_ms = get<double>(p);
+    record.boxes = get<int32_t>(p);
+    record.store_hit = get<int32_t>(p);
+    return true;
+}
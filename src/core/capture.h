@@ -0,0 +1,84 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Record/replay of detect calls. A capture file is the 8-byte magic
+// "OCRCAP02" followed by one record per call, all little-endian:
+//
+//   u32 record size (bytes after this field)
+//   i32 width, height                  original input size
+//   f32 text_score_threshold
+//   i32 rec_pack_width, rec_chunk_width
+//   f32 axis_aligned_tolerance
+//   i32 rec_pyramid, postprocess_threads, num_threads
+//   i32 sequence_tile, sequence_margin 0 x 0 outside sequence mode
+//   u64 pixel_hash                     hash_bytes of the original RGBA bytes
+//   i32 stored_width, stored_height    0 x 0 when pixels are omitted
+//   u8  rgb[stored_width * stored_height * 3]
+//   f64 total_ms                       wall time of the captured call
+//   i32 boxes
+//   i32 store_hit                      1 if answered from the result store
+//
+// Pixels can be dropped (hash only) or box-filtered down before storing.
+struct CaptureRecord {
+    int width = 0;
+    int height = 0;
+    float text_score_threshold = 0.f;
+    int rec_pack_width = 0;
+    int rec_chunk_width = 0;
+    float axis_aligned_tolerance = 0.f;
+    int rec_pyramid = 0;
+    int postprocess_threads = 0;
+    int num_threads = 0;
+    int sequence_tile = 0;
+    int sequence_margin = 0;
+    uint64_t pixel_hash = 0;
+    int stored_width = 0;
+    int stored_height = 0;
+    std::vector<unsigned char> rgb;
+    double total_ms = 0.0;
+    int boxes = 0;
+    int store_hit = 0;
+
+    // Stored pixels as RGBA (alpha 255); empty when omitted
+    std::vector<unsigned char> rgba() const;
+};
+
+uint64_t hash_pixels(const unsigned char* rgba_data, int width, int height);
+
+class CaptureWriter {
+public:
+    ~CaptureWriter();
+
+    // store_pixels = false keeps only the hash; max_side > 0 downscales stored
+    // pixels to fit. Returns false if the file cannot be created.
+    bool open(const char* path, bool store_pixels, int max_side);
+    void close();
+    bool is_open() const { return m_file != nullptr; }
+
+    // Fills the pixel fields of `record` from the input and appends it
+    bool write(CaptureRecord& record, const unsigned char* rgba_data);
+
+private:
+    FILE* m_file = nullptr;
+    bool m_store_pixels = true;
+    int m_max_side = 0;
+};
+
+class CaptureReader {
+public:
+    ~CaptureReader();
+
+    bool open(const char* path);
+    // False at the end of the file or on a truncated record
+    bool next(CaptureRecord& record);
+
+private:
+    FILE* m_file = nullptr;
+};
+
+#endif // CAPTURE_H
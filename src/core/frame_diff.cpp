@@ -0,0 +1,150 @@
+#include "frame_diff.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "hash.h"
+
+PixelRect grow_rect(const PixelRect& r, int margin, int width, int height)
+{
+    const int x0 = std::max(0, r.x - margin);
+    const int y0 = std::max(0, r.y - margin);
+    const int x1 = std::min(width, r.x + r.w + margin);
+    const int y1 = std::min(height, r.y + r.h + margin);
+    return { x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0) };
+}
+
+void merge_rects(std::vector<PixelRect>& rects)
+{
+    rects.erase(
+        std::remove_if(rects.begin(), rects.end(), [](const PixelRect& r) { return r.w <= 0 || r.h <= 0; }),
+        rects.end());
+
+    // A union can reach rects that were disjoint from both parts, so repeat until stable
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < rects.size() && !merged; i++) {
+            for (size_t j = i + 1; j < rects.size(); j++) {
+                if (!rects[i].intersects(rects[j])) continue;
+                const int x0 = std::min(rects[i].x, rects[j].x);
+                const int y0 = std::min(rects[i].y, rects[j].y);
+                const int x1 = std::max(rects[i].x + rects[i].w, rects[j].x + rects[j].w);
+                const int y1 = std::max(rects[i].y + rects[i].h, rects[j].y + rects[j].h);
+                rects[i] = { x0, y0, x1 - x0, y1 - y0 };
+                rects.erase(rects.begin() + j);
+                merged = true;
+                break;
+            }
+        }
+    }
+}
+
+TileDiff::TileDiff(int tile_size)
+    : m_tile_size(std::max(8, tile_size))
+{
+}
+
+void TileDiff::set_tile_size(int tile_size)
+{
+    m_tile_size = std::max(8, tile_size);
+    reset();
+}
+
+void TileDiff::reset()
+{
+    m_width = m_height = 0;
+    m_cols = m_rows = 0;
+    m_hashes.clear();
+    m_changed.clear();
+    m_changed_count = 0;
+}
+
+bool TileDiff::update(const unsigned char* rgba_data, int width, int height)
+{
+    const bool comparable = width == m_width && height == m_height && !m_hashes.empty();
+    m_width = width;
+    m_height = height;
+    m_cols = (width + m_tile_size - 1) / m_tile_size;
+    m_rows = (height + m_tile_size - 1) / m_tile_size;
+
+    // One pass over the rows, feeding each row segment into its tile's hash,
+    // so the frame is read sequentially
+    std::vector<uint64_t> hashes((size_t)m_cols * m_rows, 0xcbf29ce484222325ULL);
+    const size_t row_bytes = (size_t)width * 4;
+    for (int y = 0; y < height; y++) {
+        const unsigned char* row = rgba_data + (size_t)y * row_bytes;
+        uint64_t* tile_hashes = hashes.data() + (size_t)(y / m_tile_size) * m_cols;
+        for (int tx = 0; tx < m_cols; tx++) {
+            const size_t begin = (size_t)tx * m_tile_size * 4;
+            const size_t end = std::min(row_bytes, begin + (size_t)m_tile_size * 4);
+            uint64_t h = tile_hashes[tx];
+            size_t i = begin;
+            for (; i + 8 <= end; i += 8) {
+                uint64_t v;
+                memcpy(&v, row + i, 8);
+                h = mix_word(h, v);
+            }
+            if (i < end) {
+                uint32_t v; // segments are whole pixels, so at most one 4-byte tail
+                memcpy(&v, row + i, 4);
+                h = mix_word(h, v);
+            }
+            tile_hashes[tx] = h;
+        }
+    }
+
+    m_changed.assign(hashes.size(), 1);
+    m_changed_count = (int)hashes.size();
+    if (comparable) {
+        m_changed_count = 0;
+        for (size_t i = 0; i < hashes.size(); i++) {
+            m_changed[i] = hashes[i] != m_hashes[i] ? 1 : 0;
+            m_changed_count += m_changed[i];
+        }
+    }
+    m_hashes.swap(hashes);
+    return comparable;
+}
+
+std::vector<PixelRect> TileDiff::changed_regions(int margin) const
+{
+    std::vector<PixelRect> regions;
+    std::vector<unsigned char> visited(m_changed.size(), 0);
+    std::vector<int> stack;
+    for (int start = 0; start < (int)m_changed.size(); start++) {
+        if (!m_changed[start] || visited[start]) continue;
+        int min_x = m_cols, min_y = m_rows, max_x = -1, max_y = -1;
+        visited[start] = 1;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            const int idx = stack.back();
+            stack.pop_back();
+            const int tx = idx % m_cols;
+            const int ty = idx / m_cols;
+            min_x = std::min(min_x, tx);
+            max_x = std::max(max_x, tx);
+            min_y = std::min(min_y, ty);
+            max_y = std::max(max_y, ty);
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    const int nx = tx + dx;
+                    const int ny = ty + dy;
+                    if (nx < 0 || ny < 0 || nx >= m_cols || ny >= m_rows) continue;
+                    const int n = ny * m_cols + nx;
+                    if (m_changed[n] && !visited[n]) {
+                        visited[n] = 1;
+                        stack.push_back(n);
+                    }
+                }
+            }
+        }
+        const int x0 = min_x * m_tile_size;
+        const int y0 = min_y * m_tile_size;
+        const PixelRect block = { x0, y0, std::min(m_width, (max_x + 1) * m_tile_size) - x0,
+            std::min(m_height, (max_y + 1) * m_tile_size) - y0 };
+        regions.push_back(grow_rect(block, margin, m_width, m_height));
+    }
+    merge_rects(regions);
+    return regions;
+}
@@ -0,0 +1,57 @@
+#ifndef FRAME_DIFF_H
+#define FRAME_DIFF_H
+
+#include <cstdint>
+#include <vector>
+
+// Axis-aligned pixel rectangle
+struct PixelRect {
+    int x;
+    int y;
+    int w;
+    int h;
+
+    bool intersects(const PixelRect& o) const { return x < o.x + o.w && o.x < x + w && y < o.y + o.h && o.y < y + h; }
+};
+
+// `r` grown by `margin` px on every side, clamped to width x height
+PixelRect grow_rect(const PixelRect& r, int margin, int width, int height);
+
+// Replaces overlapping rects by their union until all are disjoint
+void merge_rects(std::vector<PixelRect>& rects);
+
+// Finds the parts of a frame that changed since the previous one. Only a
+// 64-bit hash per tile is kept, not the pixels.
+class TileDiff {
+public:
+    explicit TileDiff(int tile_size = 32);
+
+    // Changes the tile grid; forgets the previous frame
+    void set_tile_size(int tile_size);
+    int tile_size() const { return m_tile_size; }
+    void reset();
+
+    // Hashes the tiles of `rgba_data` and compares them with the previous
+    // frame. Returns false when there is nothing to compare against (first
+    // frame or a size change); every tile then counts as changed.
+    bool update(const unsigned char* rgba_data, int width, int height);
+
+    int tiles() const { return (int)m_hashes.size(); }
+    int changed_tiles() const { return m_changed_count; }
+
+    // Bounding rects of 8-connected groups of changed tiles, grown by `margin`
+    // px and merged
+    std::vector<PixelRect> changed_regions(int margin) const;
+
+private:
+    int m_tile_size;
+    int m_width = 0;
+    int m_height = 0;
+    int m_cols = 0;
+    int m_rows = 0;
+    std::vector<uint64_t> m_hashes;
+    std::vector<unsigned char> m_changed;
+    int m_changed_count = 0;
+};
+
+#endif // FRAME_DIFF_H
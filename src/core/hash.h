@@ -0,0 +1,40 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// One mixing step of hash_bytes. Streaming users (the tile hashes of
+// frame_diff.cpp) feed words through it directly.
+inline uint64_t mix_word(uint64_t h, uint64_t v)
+{
+    h = (h ^ v) * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 29);
+}
+
+// Word-at-a-time 64-bit hash. Words are loaded in host byte order, which is
+// little-endian on every target, so stored keys stay valid across builds.
+inline uint64_t hash_bytes(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t h = seed ^ ((uint64_t)size * 0xC2B2AE3D27D4EB4FULL);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t v;
+        memcpy(&v, p + i, 8);
+        h = mix_word(h, v);
+    }
+    if (i < size) {
+        uint64_t v = 0;
+        memcpy(&v, p + i, size - i);
+        h = mix_word(h, v);
+    }
+    // Final avalanche, so every input bit reaches the low bits used for probing
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return h;
+}
+
+#endif // HASH_H
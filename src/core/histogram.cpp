@@ -0,0 +1,116 @@
+#include "histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+const int SUB_BUCKET_BITS = 6; // 64 exact values, then 32 sub-buckets per octave
+const uint64_t SUB_BUCKETS = 1ull << SUB_BUCKET_BITS;
+const uint64_t HALF_SUB_BUCKETS = SUB_BUCKETS / 2;
+const int MAX_SHIFT = 40; // values up to 2^46 units
+const size_t NUM_BUCKETS = SUB_BUCKETS + (size_t)MAX_SHIFT * HALF_SUB_BUCKETS;
+const uint64_t MAX_VALUE = (SUB_BUCKETS << MAX_SHIFT) - 1;
+
+} // namespace
+
+RollingHistogram::RollingHistogram(double unit, size_t window)
+    : m_unit(unit > 0.0 ? unit : 1.0)
+    , m_half_window(std::max<size_t>(window / 2, 1))
+{
+    for (Generation& gen : m_gen) gen.counts.assign(NUM_BUCKETS, 0);
+}
+
+size_t RollingHistogram::bucket_index(uint64_t value)
+{
+    if (value < SUB_BUCKETS) return (size_t)value;
+    int msb = SUB_BUCKET_BITS;
+    while (value >> (msb + 1)) msb++;
+    const int shift = msb - (SUB_BUCKET_BITS - 1);
+    const uint64_t sub = value >> shift; // in [32, 64)
+    return (size_t)(SUB_BUCKETS + (shift - 1) * HALF_SUB_BUCKETS + (sub - HALF_SUB_BUCKETS));
+}
+
+uint64_t RollingHistogram::bucket_value(size_t index)
+{
+    if (index < SUB_BUCKETS) return index;
+    const size_t k = index - SUB_BUCKETS;
+    const int shift = (int)(k / HALF_SUB_BUCKETS) + 1;
+    const uint64_t lower = (HALF_SUB_BUCKETS + k % HALF_SUB_BUCKETS) << shift;
+    return lower + ((1ull << shift) >> 1); // bucket midpoint
+}
+
+void RollingHistogram::clear(Generation& gen)
+{
+    std::fill(gen.counts.begin(), gen.counts.end(), 0);
+    gen.count = 0;
+    gen.sum = 0;
+    gen.min = UINT64_MAX;
+    gen.max = 0;
+}
+
+void RollingHistogram::record(double value)
+{
+    if (!(value >= 0.0)) value = 0.0;
+    const uint64_t v = (uint64_t)std::min(std::llround(value / m_unit), (long long)MAX_VALUE);
+
+    Generation* gen = &m_gen[m_current];
+    if (gen->count >= m_half_window) {
+        m_current ^= 1;
+        gen = &m_gen[m_current];
+        clear(*gen);
+    }
+    gen->counts[bucket_index(v)]++;
+    gen->count++;
+    gen->sum += v;
+    gen->min = std::min(gen->min, v);
+    gen->max = std::max(gen->max, v);
+}
+
+void RollingHistogram::reset()
+{
+    for (Generation& gen : m_gen) clear(gen);
+    m_current = 0;
+}
+
+size_t RollingHistogram::count() const { return m_gen[0].count + m_gen[1].count; }
+
+double RollingHistogram::min() const
+{
+    if (count() == 0) return 0.0;
+    return std::min(m_gen[0].min, m_gen[1].min) * m_unit;
+}
+
+double RollingHistogram::max() const { return std::max(m_gen[0].max, m_gen[1].max) * m_unit; }
+
+double RollingHistogram::mean() const
+{
+    const size_t n = count();
+    return n ? (double)(m_gen[0].sum + m_gen[1].sum) / n * m_unit : 0.0;
+}
+
+double RollingHistogram::quantile(double q) const
+{
+    const size_t n = count();
+    if (n == 0) return 0.0;
+    const size_t rank = std::max<size_t>(1, (size_t)std::ceil(std::min(std::max(q, 0.0), 1.0) * n));
+
+    size_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        seen += m_gen[0].counts[i] + m_gen[1].counts[i];
+        if (seen >= rank) {
+            const double value = bucket_value(i) * m_unit;
+            return std::min(std::max(value, min()), max());
+        }
+    }
+    return max();
+}
+
+std::string RollingHistogram::to_json() const
+{
+    std::ostringstream ss;
+    ss << "{\"count\":" << count() << ",\"mean\":" << mean() << ",\"min\":" << min() << ",\"p50\":" << quantile(0.5)
+       << ",\"p90\":" << quantile(0.9) << ",\"p99\":" << quantile(0.99) << ",\"max\":" << max() << "}";
+    return ss.str();
+}
@@ -0,0 +1,50 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Log-linear (HDR-style) histogram over a rolling window of samples. Values
+// are quantized to `unit` and bucketed with 32 linear sub-buckets per power of
+// two, so quantiles are exact below 64 units and within ~3% above. The window
+// is kept as two generations of window/2 samples: once the current one fills
+// up it replaces the older one, so queries cover the last window/2..window
+// samples at a fixed memory cost.
+class RollingHistogram {
+public:
+    explicit RollingHistogram(double unit = 1.0, size_t window = 8192);
+
+    void record(double value);
+    void reset();
+
+    size_t count() const;
+    double min() const;
+    double max() const;
+    double mean() const;
+    // q in [0, 1]; 0 when empty
+    double quantile(double q) const;
+    // {"count","mean","min","p50","p90","p99","max"}
+    std::string to_json() const;
+
+private:
+    struct Generation {
+        std::vector<uint32_t> counts;
+        size_t count = 0;
+        uint64_t sum = 0;
+        uint64_t min = UINT64_MAX;
+        uint64_t max = 0;
+    };
+
+    static size_t bucket_index(uint64_t value);
+    static uint64_t bucket_value(size_t index);
+    static void clear(Generation& gen);
+
+    double m_unit;
+    size_t m_half_window;
+    Generation m_gen[2];
+    int m_current = 0;
+};
+
+#endif // HISTOGRAM_H
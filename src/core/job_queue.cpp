@@ -0,0 +1,227 @@
+#include "job_queue.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "hash.h"
+#include "log.h"
+
+JobQueue::JobQueue(RunFn run, DoneFn done)
+    : m_run(std::move(run))
+    , m_done(std::move(done))
+{
+}
+
+JobQueue::~JobQueue()
+{
+    std::deque<std::shared_ptr<DetectJob>> dropped;
+    std::vector<uint32_t> ids; // requests of the dropped jobs
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        dropped.swap(m_queue);
+        for (auto& entry : m_pending) entry.second->cancel.store(true);
+        for (const auto& job : dropped) {
+            for (uint32_t id : job->ids) {
+                Request& request = m_requests[id];
+                request.job = nullptr;
+                request.state = JOB_CANCELLED;
+                ids.push_back(id);
+            }
+            job->ids.clear();
+        }
+    }
+    m_wake.notify_all();
+#if OCR_JOB_THREAD
+    // A running job ends as cancelled and reports its own requests
+    if (m_thread.joinable()) m_thread.join();
+#endif
+    if (!dropped.empty()) LOG_INFO("[JobQueue] Dropped " << dropped.size() << " queued jobs");
+    if (m_done)
+        for (uint32_t id : ids) m_done(id, JOB_CANCELLED);
+}
+
+uint32_t JobQueue::submit(const unsigned char* rgba_data, int width, int height, int priority)
+{
+    priority = std::min(std::max(priority, (int)JOB_INTERACTIVE), (int)JOB_BACKGROUND);
+    const size_t bytes = (rgba_data && width > 0 && height > 0) ? (size_t)width * height * 4 : 0;
+    // Hashed outside the lock; the size is in the seed so a reshaped buffer differs
+    const uint64_t key = hash_bytes(rgba_data, bytes, ((uint64_t)(uint32_t)width << 32) | (uint32_t)height);
+
+    std::shared_ptr<DetectJob> job;
+    uint32_t id;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        id = m_next_id++;
+        if (m_next_id == 0) m_next_id = 1;
+
+        auto pending = m_pending.find(key);
+        if (pending != m_pending.end()) {
+            job = pending->second;
+            job->ids.push_back(id);
+            job->priority = std::min(job->priority, priority);
+            m_requests[id].job = job;
+            LOG_DEBUG("[JobQueue] Request " << id << " joins a pending job of " << job->ids.size() - 1);
+            return id;
+        }
+
+        job = std::make_shared<DetectJob>();
+        job->width = width;
+        job->height = height;
+        job->key = key;
+        job->priority = priority;
+        job->queued_at = std::chrono::steady_clock::now();
+        job->ids.push_back(id);
+        if (bytes) {
+            job->rgba.resize(bytes);
+            memcpy(job->rgba.data(), rgba_data, bytes);
+        }
+        m_requests[id].job = job;
+        m_pending[key] = job;
+#if OCR_JOB_THREAD
+        m_queue.push_back(job);
+        if (!m_thread.joinable()) m_thread = std::thread(&JobQueue::worker_loop, this);
+#else
+        start_job(job);
+#endif
+    }
+#if OCR_JOB_THREAD
+    m_wake.notify_one();
+#else
+    run_job(job);
+#endif
+    return id;
+}
+
+int JobQueue::state(uint32_t id) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_requests.find(id);
+    if (it == m_requests.end()) return JOB_UNKNOWN;
+    const Request& request = it->second;
+    if (request.job) return request.job->running ? JOB_RUNNING : JOB_QUEUED;
+    return request.state;
+}
+
+bool JobQueue::cancel(uint32_t id)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_requests.find(id);
+        if (it == m_requests.end() || !it->second.job) return false;
+        std::shared_ptr<DetectJob> job;
+        job.swap(it->second.job);
+        it->second.state = JOB_CANCELLED;
+
+        job->ids.erase(std::find(job->ids.begin(), job->ids.end(), id));
+        if (job->ids.empty()) {
+            auto pending = m_pending.find(job->key);
+            if (pending != m_pending.end() && pending->second == job) m_pending.erase(pending);
+            if (job->running) {
+                job->cancel.store(true);
+            } else {
+                m_queue.erase(std::find(m_queue.begin(), m_queue.end(), job));
+                job->rgba = std::vector<unsigned char>();
+            }
+        }
+    }
+    if (m_done) m_done(id, JOB_CANCELLED);
+    return true;
+}
+
+bool JobQueue::take_result(uint32_t id, std::string& json)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_requests.find(id);
+    if (it == m_requests.end() || it->second.job) return false;
+    json.swap(it->second.result);
+    m_requests.erase(it);
+    return true;
+}
+
+size_t JobQueue::pending() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queue.size() + m_running;
+}
+
+void JobQueue::set_aging_ms(double ms)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_aging_ms = std::max(ms, 0.0);
+}
+
+std::shared_ptr<DetectJob> JobQueue::pick_next()
+{
+    const auto now = std::chrono::steady_clock::now();
+    size_t best = 0;
+    double best_rank = 0.0;
+    for (size_t i = 0; i < m_queue.size(); i++) {
+        const DetectJob& job = *m_queue[i];
+        double rank = job.priority;
+        if (m_aging_ms > 0.0)
+            rank -= std::chrono::duration<double, std::milli>(now - job.queued_at).count() / m_aging_ms;
+        if (i == 0 || rank < best_rank) {
+            best = i;
+            best_rank = rank;
+        }
+    }
+    std::shared_ptr<DetectJob> job = m_queue[best];
+    m_queue.erase(m_queue.begin() + best);
+    return job;
+}
+
+void JobQueue::start_job(const std::shared_ptr<DetectJob>& job)
+{
+    job->wait_ms
+        = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job->queued_at).count();
+    job->running = true;
+    m_running++;
+}
+
+void JobQueue::run_job(const std::shared_ptr<DetectJob>& job)
+{
+    std::string result;
+    if (!job->cancel.load()) result = m_run(*job);
+
+    std::vector<uint32_t> ids;
+    int state;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        job->rgba = std::vector<unsigned char>();
+        job->running = false;
+        m_running--;
+        auto pending = m_pending.find(job->key);
+        if (pending != m_pending.end() && pending->second == job) m_pending.erase(pending);
+
+        state = job->cancel.load() ? JOB_CANCELLED : JOB_DONE;
+        ids.swap(job->ids);
+        for (size_t i = 0; i < ids.size(); i++) {
+            Request& request = m_requests[ids[i]];
+            request.job = nullptr;
+            request.state = state;
+            if (state != JOB_DONE) continue;
+            if (i + 1 < ids.size())
+                request.result = result;
+            else
+                request.result.swap(result);
+        }
+    }
+    if (m_done)
+        for (uint32_t id : ids) m_done(id, state);
+}
+
+void JobQueue::worker_loop()
+{
+    for (;;) {
+        std::shared_ptr<DetectJob> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_stop) return;
+            job = pick_next();
+            start_job(job);
+        }
+        run_job(job);
+    }
+}
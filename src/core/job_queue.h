@@ -0,0 +1,119 @@
+#ifndef JOB_QUEUE_H
+#define JOB_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// The queue owns a job thread where pthreads exist (native and the Wasm
+// threads builds). Elsewhere submit() runs the job before returning.
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#define OCR_JOB_THREAD 1
+#else
+#define OCR_JOB_THREAD 0
+#endif
+
+enum JobState {
+    JOB_UNKNOWN = -1, // never submitted, or already taken
+    JOB_QUEUED = 0,
+    JOB_RUNNING = 1,
+    JOB_DONE = 2,
+    JOB_CANCELLED = 3,
+};
+
+enum JobPriority {
+    JOB_INTERACTIVE = 0, // an image the user is waiting on
+    JOB_VISIBLE = 1, // on screen
+    JOB_BACKGROUND = 2, // prefetching, indexing
+};
+
+// One detect computation. Every submit of the same pixels while it is queued
+// or running joins it instead of queueing another.
+struct DetectJob {
+    std::vector<unsigned char> rgba; // copied at submit, freed when the job ends
+    int width = 0;
+    int height = 0;
+    uint64_t key = 0; // hash of the pixels and size
+    int priority = JOB_BACKGROUND; // best priority among the requests sharing it
+    std::chrono::steady_clock::time_point queued_at;
+    double wait_ms = 0.0; // time spent queued, set when the job starts
+    bool running = false;
+    std::vector<uint32_t> ids; // requests sharing the job, not cancelled yet
+    std::atomic<bool> cancel { false }; // set once no request is left
+};
+
+// Detect calls run one at a time off the caller's thread, so the caller stays
+// free to poll, cancel or submit more. The next job is the one with the lowest
+// priority level minus its waiting time in aging periods: a job moves up one
+// level per period, so background work still runs under a steady stream of
+// interactive requests. Ties run in submit order.
+class JobQueue {
+public:
+    // `run` returns a job's JSON and should stop early once `job.cancel` is
+    // set. `done` is called once per request that finishes or is cancelled,
+    // from the job thread or from cancel().
+    using RunFn = std::function<std::string(DetectJob& job)>;
+    using DoneFn = std::function<void(uint32_t id, int state)>;
+
+    JobQueue(RunFn run, DoneFn done);
+    // Cancels everything left, calling `done` for every request still
+    // pending, and joins the job thread
+    ~JobQueue();
+
+    // Copies the pixels unless a pending job has the same ones; returns the
+    // request id (never 0)
+    uint32_t submit(const unsigned char* rgba_data, int width, int height, int priority = JOB_VISIBLE);
+    int state(uint32_t id) const;
+    // The request ends at once. Its job is dropped if queued, or stopped at its
+    // next check if running, once no other request shares it. Returns false if
+    // the request had already ended.
+    bool cancel(uint32_t id);
+    // Hands over the JSON of a finished request and forgets it. Cancelled
+    // requests are forgotten too (with an empty result). False while pending.
+    bool take_result(uint32_t id, std::string& json);
+    // Jobs queued or running
+    size_t pending() const;
+    // Milliseconds of waiting per priority level (0 = strict priorities)
+    void set_aging_ms(double ms);
+
+private:
+    struct Request {
+        std::shared_ptr<DetectJob> job; // null once the request has ended
+        int state = JOB_QUEUED;
+        std::string result;
+    };
+
+    void worker_loop();
+    // Removes and returns the next job to run; the queue must not be empty
+    std::shared_ptr<DetectJob> pick_next();
+    void start_job(const std::shared_ptr<DetectJob>& job);
+    void run_job(const std::shared_ptr<DetectJob>& job);
+
+    RunFn m_run;
+    DoneFn m_done;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::shared_ptr<DetectJob>> m_queue; // in submit order
+    std::unordered_map<uint64_t, std::shared_ptr<DetectJob>> m_pending; // by key, joinable
+    std::map<uint32_t, Request> m_requests; // not taken yet
+    uint32_t m_next_id = 1;
+    size_t m_running = 0;
+    double m_aging_ms = 5000.0;
+    bool m_stop = false;
+#if OCR_JOB_THREAD
+    std::thread m_thread; // started by the first submit
+#endif
+};
+
+#endif // JOB_QUEUE_H
@@ -0,0 +1,449 @@
+#include "kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "trace.h"
+
+const float PI = 3.1415926535f;
+
+// Output pixels per thread below which a kernel stays on one thread
+const size_t PARALLEL_MIN_PIXELS_PER_THREAD = 16384;
+
+int parallel_threads(size_t pixels, int max_threads)
+{
+    int n = (int)std::min<size_t>((size_t)std::max(max_threads, 1), pixels / PARALLEL_MIN_PIXELS_PER_THREAD);
+    return std::max(n, 1);
+}
+
+void warp_affine_bilinear(const ncnn::Mat& src, ncnn::Mat& dst, const Matrix2x3& M, int dst_w, int dst_h,
+    const float* mean_vals, const float* norm_vals, int num_threads)
+{
+    dst.create(dst_w, dst_h, 3);
+
+    // 计算逆矩阵
+    double D = M.m[0] * M.m[4] - M.m[1] * M.m[3];
+    if (std::abs(D) < 1e-6) return;
+
+    double invD = 1.0 / D;
+    double iM[6];
+    iM[0] = M.m[4] * invD;
+    iM[1] = -M.m[1] * invD;
+    iM[2] = (M.m[1] * M.m[5] - M.m[2] * M.m[4]) * invD;
+    iM[3] = -M.m[3] * invD;
+    iM[4] = M.m[0] * invD;
+    iM[5] = (M.m[2] * M.m[3] - M.m[0] * M.m[5]) * invD;
+
+    const int src_w = src.w;
+    const int src_h = src.h;
+
+    // 预计算每行的起始坐标（行内变化是连续的）
+    std::vector<float> row_start_x(dst_h);
+    std::vector<float> row_start_y(dst_h);
+    for (int dy = 0; dy < dst_h; dy++) {
+        row_start_x[dy] = dy * iM[1] + iM[2];
+        row_start_y[dy] = dy * iM[4] + iM[5];
+    }
+
+    // 按通道处理（更好的缓存局部性）, rows of all channels form the parallel tiles
+    const int threads = parallel_threads((size_t)dst_w * dst_h * 3, num_threads);
+#pragma omp parallel for num_threads(threads) if (threads > 1)
+    for (int t = 0; t < 3 * dst_h; t++) {
+        const int c = t / dst_h;
+        const int dy = t % dst_h;
+        const float* src_ptr = src.channel(c);
+        float* dst_ptr = dst.channel(c);
+        const float mean = mean_vals[c];
+        const float norm = norm_vals[c];
+
+        float sx = row_start_x[dy];
+        float sy = row_start_y[dy];
+
+        // 行步进增量
+        const float sx_step = iM[0];
+        const float sy_step = iM[3];
+
+        for (int dx = 0; dx < dst_w; dx++) {
+            // 双线性插值
+            int x0 = (int)sx;
+            int y0 = (int)sy;
+
+            // 边界检查（优化：使用位运算）
+            if ((unsigned)x0 < (unsigned)(src_w - 1) && (unsigned)y0 < (unsigned)(src_h - 1)) {
+                // 在范围内，快速路径
+                float u = sx - x0;
+                float v = sy - y0;
+
+                const float* p = src_ptr + y0 * src_w + x0;
+                float v00 = p[0];
+                float v01 = p[1];
+                float v10 = p[src_w];
+                float v11 = p[src_w + 1];
+
+                float val = v00 * (1 - u) * (1 - v) + v01 * u * (1 - v) + v10 * (1 - u) * v + v11 * u * v;
+
+                dst_ptr[dy * dst_w + dx] = (val - mean) * norm;
+            } else {
+                // 边界处理（使用clamp）
+                int x0_c = std::max(0, std::min(x0, src_w - 1));
+                int y0_c = std::max(0, std::min(y0, src_h - 1));
+                int x1_c = std::max(0, std::min(x0 + 1, src_w - 1));
+                int y1_c = std::max(0, std::min(y0 + 1, src_h - 1));
+
+                float u = sx - x0;
+                float v = sy - y0;
+
+                float v00 = src_ptr[y0_c * src_w + x0_c];
+                float v01 = src_ptr[y0_c * src_w + x1_c];
+                float v10 = src_ptr[y1_c * src_w + x0_c];
+                float v11 = src_ptr[y1_c * src_w + x1_c];
+
+                float val = v00 * (1 - u) * (1 - v) + v01 * u * (1 - v) + v10 * (1 - u) * v + v11 * u * v;
+
+                dst_ptr[dy * dst_w + dx] = (val - mean) * norm;
+            }
+
+            // 增量更新
+            sx += sx_step;
+            sy += sy_step;
+        }
+    }
+}
+
+void get_min_area_rect(const std::vector<IntPoint>& contour, RotatedRect& out_rect)
+{
+    if (contour.empty()) return;
+
+    // PCA Approach
+    double mean_x = 0, mean_y = 0;
+    for (const auto& p : contour) {
+        mean_x += p.x;
+        mean_y += p.y;
+    }
+    mean_x /= contour.size();
+    mean_y /= contour.size();
+
+    double cov_xx = 0, cov_xy = 0, cov_yy = 0;
+    for (const auto& p : contour) {
+        double dx = p.x - mean_x;
+        double dy = p.y - mean_y;
+        cov_xx += dx * dx;
+        cov_xy += dx * dy;
+        cov_yy += dy * dy;
+    }
+
+    // Eigen decomposition of symmetric 2x2 matrix
+    // [ a  b ]
+    // [ b  c ]
+    // lambda = ((a+c) +/- sqrt((a-c)^2 + 4b^2)) / 2
+    double D = sqrt((cov_xx - cov_yy) * (cov_xx - cov_yy) + 4.0 * cov_xy * cov_xy);
+    double lambda1 = (cov_xx + cov_yy + D) / 2.0;
+    // double lambda2 = (cov_xx + cov_yy - D) / 2.0;
+
+    // Eigen vector 1 (Main direction)
+    double vx = 1.0, vy = 0.0;
+    if (std::abs(cov_xy) > 1e-6) {
+        vx = lambda1 - cov_yy;
+        vy = cov_xy;
+    } else {
+        if (cov_xx >= cov_yy) {
+            vx = 1.0;
+            vy = 0.0;
+        } else {
+            vx = 0.0;
+            vy = 1.0;
+        }
+    }
+    double len = sqrt(vx * vx + vy * vy);
+    vx /= len;
+    vy /= len;
+
+    // Project points to principal axes to find box
+    // Axis 1: (vx, vy), Axis 2: (-vy, vx)
+    double min_u = 1e9, max_u = -1e9;
+    double min_v = 1e9, max_v = -1e9;
+
+    for (const auto& p : contour) {
+        double u = (p.x - mean_x) * vx + (p.y - mean_y) * vy;
+        double v = (p.x - mean_x) * -vy + (p.y - mean_y) * vx;
+        if (u < min_u) min_u = u;
+        if (u > max_u) max_u = u;
+        if (v < min_v) min_v = v;
+        if (v > max_v) max_v = v;
+    }
+
+    // Box dimensions
+    out_rect.size.width = (float)(max_u - min_u);
+    out_rect.size.height = (float)(max_v - min_v);
+
+    // Center in u,v space
+    double center_u = (min_u + max_u) / 2.0;
+    double center_v = (min_v + max_v) / 2.0;
+
+    // Back to world coords
+    out_rect.center.x = (float)(mean_x + center_u * vx - center_v * vy);
+    out_rect.center.y = (float)(mean_y + center_u * vy + center_v * vx);
+
+    // Angle
+    // atan2(y, x) gives angle in radians. Convert to degrees.
+    // OpenCV angle definition is bit tricky. It's usually angle of the "width"
+    // side? Let's standardise: angle is rotation of the box 0..180 or -90..90.
+    out_rect.angle = (float)(atan2(vy, vx) * 180.0 / PI);
+
+    // Normalize angle / size to match typical expectations (width > height
+    // usually for horizontal text) But PP-OCR handles this in logic later.
+}
+
+// Traces one 4-connected component breadth-first from `seed`. `inside(idx)`
+// tells whether a pixel belongs to the foreground being traced. It is tested
+// before `visited`, so a trace only reads entries of its own component and
+// parallel traces of disjoint components never touch each other's.
+template <typename Inside>
+static void trace_component(
+    int seed, int w, int h, Inside inside, std::vector<unsigned char>& visited, std::vector<IntPoint>& contour)
+{
+    std::queue<int> q;
+    q.push(seed);
+    visited[seed] = 1;
+
+    while (!q.empty()) {
+        int curr = q.front();
+        q.pop();
+        int cy = curr / w;
+        int cx = curr % w;
+
+        contour.push_back({ cx, cy });
+
+        // 4-neighbors, checking bounds & valid
+        if (cx > 0 && inside(curr - 1) && !visited[curr - 1]) {
+            visited[curr - 1] = 1;
+            q.push(curr - 1);
+        }
+        if (cx < w - 1 && inside(curr + 1) && !visited[curr + 1]) {
+            visited[curr + 1] = 1;
+            q.push(curr + 1);
+        }
+        if (cy > 0 && inside(curr - w) && !visited[curr - w]) {
+            visited[curr - w] = 1;
+            q.push(curr - w);
+        }
+        if (cy < h - 1 && inside(curr + w) && !visited[curr + w]) {
+            visited[curr + w] = 1;
+            q.push(curr + w);
+        }
+    }
+}
+
+// Connected Component Analysis (BFS) over the thresholded map, in raster
+// order of each component's first pixel
+static void label_components_bfs(
+    const float* pred_data, int w, int h, float threshold, std::vector<std::vector<IntPoint>>& contours)
+{
+    std::vector<unsigned char> visited(w * h, 0);
+    auto inside = [&](int idx) { return pred_data[idx] > threshold; };
+
+    for (int idx = 0; idx < w * h; idx++) {
+        if (!inside(idx) || visited[idx]) continue;
+
+        // New component
+        std::vector<IntPoint> contour;
+        trace_component(idx, w, h, inside, visited, contour);
+        if (contour.size() > 5) { // Filter tiny noise
+            contours.push_back(std::move(contour));
+        }
+    }
+}
+
+#ifdef _OPENMP
+static int find_root(std::vector<int>& parent, int x)
+{
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+// Links two foreground pixels; the smaller index always becomes the root, so a
+// component's root ends up being its first pixel in raster order
+static void unite_roots(std::vector<int>& parent, int a, int b)
+{
+    a = find_root(parent, a);
+    b = find_root(parent, b);
+    if (a < b)
+        parent[b] = a;
+    else if (b < a)
+        parent[a] = b;
+}
+
+// Parallel variant of label_components_bfs. Horizontal strips are labeled
+// independently with union-find, then merged across the strip borders. Each
+// component is finally traced again from its first pixel with the same BFS,
+// so the contours (including point order, which the contour score depends on)
+// match the sequential path exactly.
+static void label_components_strips(const float* pred_data, int w, int h, float threshold, int num_threads,
+    std::vector<std::vector<IntPoint>>& contours)
+{
+    const int n = w * h;
+    const int num_strips = std::max(1, std::min(num_threads, h / 8));
+    std::vector<int> parent(n, -1); // -1 marks background
+
+#pragma omp parallel for num_threads(num_threads)
+    for (int s = 0; s < num_strips; s++) {
+        trace::Scope strip_scope("Det_Label_Strip", s);
+        const int y_begin = s * h / num_strips;
+        const int y_end = (s + 1) * h / num_strips;
+        for (int y = y_begin; y < y_end; y++) {
+            for (int x = 0; x < w; x++) {
+                const int idx = y * w + x;
+                if (!(pred_data[idx] > threshold)) continue;
+                parent[idx] = idx;
+                if (x > 0 && parent[idx - 1] >= 0) unite_roots(parent, idx - 1, idx);
+                if (y > y_begin && parent[idx - w] >= 0) unite_roots(parent, idx - w, idx);
+            }
+        }
+    }
+
+    // Merge labels across strip borders
+    for (int s = 1; s < num_strips; s++) {
+        const int y = s * h / num_strips;
+        for (int x = 0; x < w; x++) {
+            const int idx = y * w + x;
+            if (parent[idx] >= 0 && parent[idx - w] >= 0) unite_roots(parent, idx - w, idx);
+        }
+    }
+
+    // Flatten to final labels (read-only walk, safe to run in parallel)
+    std::vector<int> label(n, -1);
+#pragma omp parallel for num_threads(num_threads)
+    for (int y = 0; y < h; y++) {
+        for (int idx = y * w; idx < (y + 1) * w; idx++) {
+            int r = parent[idx];
+            if (r < 0) continue;
+            while (parent[r] != r) r = parent[r];
+            label[idx] = r;
+        }
+    }
+
+    std::vector<int> seeds;
+    for (int idx = 0; idx < n; idx++) {
+        if (label[idx] == idx) seeds.push_back(idx);
+    }
+
+    // Components are disjoint, so threads read and write disjoint entries of `visited`
+    std::vector<std::vector<IntPoint>> traced(seeds.size());
+    std::vector<unsigned char> visited(n, 0);
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+    for (int k = 0; k < (int)seeds.size(); k++) {
+        const int seed = seeds[k];
+        trace_component(
+            seed, w, h, [&](int idx) { return label[idx] == seed; }, visited, traced[k]);
+    }
+
+    for (auto& contour : traced) {
+        if (contour.size() > 5) { // Filter tiny noise
+            contours.push_back(std::move(contour));
+        }
+    }
+}
+#endif
+
+void label_components(const float* pred_data, int w, int h, float threshold, int num_threads,
+    std::vector<std::vector<IntPoint>>& contours)
+{
+#ifdef _OPENMP
+    if (num_threads > 1) {
+        label_components_strips(pred_data, w, h, threshold, num_threads, contours);
+        return;
+    }
+#endif
+    label_components_bfs(pred_data, w, h, threshold, contours);
+}
+
+void decode_ctc(
+    const ncnn::Mat& out, int t_begin, int t_end, std::vector<Character>& text, int* last_token_state)
+{
+    int last_token = last_token_state ? *last_token_state : 0;
+    for (int i = t_begin; i < t_end; i++) {
+        const float* p = out.row(i);
+        int index = 0;
+        float max_score = -9999.f;
+        for (int j = 0; j < out.w; j++) {
+            float score = *p++;
+            if (score > max_score) {
+                max_score = score;
+                index = j;
+            }
+        }
+
+        if (last_token == index) continue; // CTC Merge
+        last_token = index;
+
+        if (index <= 0) continue; // Blank token
+
+        Character ch;
+        ch.id = index - 1;
+        ch.prob = max_score;
+        text.push_back(ch);
+    }
+    if (last_token_state) *last_token_state = last_token;
+}
+
+// Source pixels covered by one output pixel along an axis, with the covered
+// fraction of each
+struct AreaTap {
+    int index;
+    float weight;
+};
+
+static std::vector<std::vector<AreaTap>> area_taps(int src_n, int dst_n)
+{
+    std::vector<std::vector<AreaTap>> taps(dst_n);
+    const double scale = (double)src_n / dst_n;
+    for (int d = 0; d < dst_n; d++) {
+        const double a = d * scale;
+        const double b = std::min((double)src_n, (d + 1) * scale);
+        for (int i = (int)a; i < b; i++) {
+            const double cover = std::min(b, i + 1.0) - std::max(a, (double)i);
+            if (cover > 1e-9) taps[d].push_back({ i, (float)(cover / scale) });
+        }
+    }
+    return taps;
+}
+
+void resize_region_rgba(const unsigned char* rgba_data, int img_w, int x, int y, int w, int h, unsigned char* dst,
+    int dst_w, int dst_h, bool area)
+{
+    const unsigned char* src = rgba_data + ((size_t)y * img_w + x) * 4;
+    if (!area || h < 2 * dst_h) {
+        ncnn::resize_bilinear_c4(src, w, h, img_w * 4, dst, dst_w, dst_h, dst_w * 4);
+        return;
+    }
+
+    // Separable: source rows are summed into one float row per output row,
+    // which is then reduced along x
+    const std::vector<std::vector<AreaTap>> xs = area_taps(w, dst_w);
+    const std::vector<std::vector<AreaTap>> ys = area_taps(h, dst_h);
+    std::vector<float> row((size_t)w * 4);
+    for (int dy = 0; dy < dst_h; dy++) {
+        std::fill(row.begin(), row.end(), 0.f);
+        for (const AreaTap& ty : ys[dy]) {
+            const unsigned char* s = src + (size_t)ty.index * img_w * 4;
+            for (int i = 0; i < w * 4; i++) row[i] += ty.weight * s[i];
+        }
+        unsigned char* out = dst + (size_t)dy * dst_w * 4;
+        for (int dx = 0; dx < dst_w; dx++) {
+            float acc[4] = { 0.f, 0.f, 0.f, 0.f };
+            for (const AreaTap& tx : xs[dx]) {
+                const float* p = &row[(size_t)tx.index * 4];
+                for (int c = 0; c < 4; c++) acc[c] += tx.weight * p[c];
+            }
+            for (int c = 0; c < 4; c++) out[dx * 4 + c] = (unsigned char)std::min(255.f, acc[c] + 0.5f);
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <vector>
+
+#include "mat.h"
+#include "ocr_engine.h"
+
+// Numeric kernels of the det/rec pipeline. They live outside ocr_engine.cpp so
+// tests/bench/conformance.cpp can run them against the frozen copies in
+// reference_kernels.h; any change here has to keep that harness passing.
+
+struct IntPoint {
+    int x, y;
+};
+
+// Simple Matrix for Affine Transform
+struct Matrix2x3 {
+    float m[6]; // m00, m01, m02, m10, m11, m12
+};
+
+// Threads worth forking for a kernel producing `pixels` outputs: one per
+// 16384 pixels, capped at `max_threads`
+int parallel_threads(size_t pixels, int max_threads);
+
+// Bilinear affine warp of a planar 3-channel image. The result is written as
+// (v - mean) * norm so it can be fed to the network without another pass.
+// `M` maps source to destination coordinates.
+void warp_affine_bilinear(const ncnn::Mat& src, ncnn::Mat& dst, const Matrix2x3& M, int dst_w, int dst_h,
+    const float* mean_vals, const float* norm_vals, int num_threads = 1);
+
+// 4-connected components of `pred_data > threshold` with more than 5 pixels, in
+// raster order of each component's first pixel. Every contour lists its pixels
+// in BFS order from that first pixel. Uses the parallel strip labeler when
+// built with OpenMP and `num_threads > 1`; the output is identical either way.
+void label_components(const float* pred_data, int w, int h, float threshold, int num_threads,
+    std::vector<std::vector<IntPoint>>& contours);
+
+// PCA fit of a component: the box axes follow its principal direction and the
+// angle is that direction in degrees
+void get_min_area_rect(const std::vector<IntPoint>& contour, RotatedRect& out_rect);
+
+// Resize of an RGBA region to dst_w x dst_h (tightly packed). Bilinear, except
+// with `area` set and a region at least twice the output height: then every
+// output pixel is the mean of the source area it covers, so thin strokes are
+// neither skipped nor doubled.
+void resize_region_rgba(const unsigned char* rgba_data, int img_w, int x, int y, int w, int h, unsigned char* dst,
+    int dst_w, int dst_h, bool area);
+
+// CTC greedy decode (with merge) over timesteps [t_begin, t_end) of a rec output.
+// Passing `last_token` carries the merge state across consecutive calls.
+void decode_ctc(
+    const ncnn::Mat& out, int t_begin, int t_end, std::vector<Character>& text, int* last_token_state = nullptr);
+
+#endif // KERNELS_H
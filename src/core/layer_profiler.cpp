@@ -0,0 +1,83 @@
+#include "layer_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <sstream>
+
+int LayerProfiler::extract(const ncnn::Net& net, ncnn::Extractor& ex, const char* output, ncnn::Mat& out)
+{
+    const std::vector<ncnn::Layer*>& layers = net.layers();
+    if (m_layers.size() != layers.size()) {
+        m_layers.assign(layers.size(), LayerStats());
+        for (size_t i = 0; i < layers.size(); i++) {
+            m_layers[i].name = layers[i]->name;
+            m_layers[i].type = layers[i]->type;
+        }
+    }
+
+    // Keep every intermediate blob so later layers find their inputs computed
+    ex.set_light_mode(false);
+    for (size_t i = 0; i < layers.size(); i++) {
+        if (layers[i]->tops.empty()) continue;
+        ncnn::Mat blob;
+        const auto start = std::chrono::steady_clock::now();
+        int ret = ex.extract(layers[i]->tops[0], blob);
+        const auto end = std::chrono::steady_clock::now();
+        if (ret != 0) return ret;
+        m_layers[i].ms += std::chrono::duration<double, std::milli>(end - start).count();
+        m_layers[i].calls++;
+    }
+    m_runs++;
+    return ex.extract(output, out);
+}
+
+void LayerProfiler::reset()
+{
+    m_layers.clear();
+    m_runs = 0;
+}
+
+std::string LayerProfiler::to_json() const
+{
+    struct TypeStats {
+        double ms = 0.0;
+        int layers = 0;
+    };
+
+    double total_ms = 0.0;
+    std::map<std::string, TypeStats> by_type;
+    std::vector<const LayerStats*> by_layer;
+    for (const LayerStats& layer : m_layers) {
+        if (layer.calls == 0) continue;
+        total_ms += layer.ms;
+        by_type[layer.type].ms += layer.ms;
+        by_type[layer.type].layers++;
+        by_layer.push_back(&layer);
+    }
+
+    std::vector<std::pair<std::string, TypeStats>> types(by_type.begin(), by_type.end());
+    std::stable_sort(
+        types.begin(), types.end(), [](const auto& a, const auto& b) { return a.second.ms > b.second.ms; });
+    std::stable_sort(
+        by_layer.begin(), by_layer.end(), [](const LayerStats* a, const LayerStats* b) { return a->ms > b->ms; });
+
+    auto share = [&](double ms) { return total_ms > 0.0 ? ms / total_ms : 0.0; };
+
+    std::ostringstream ss;
+    ss << "{\"runs\":" << m_runs << ",\"total_ms\":" << total_ms << ",\"by_type\":[";
+    for (size_t i = 0; i < types.size(); i++) {
+        if (i > 0) ss << ",";
+        ss << "{\"type\":\"" << types[i].first << "\",\"ms\":" << types[i].second.ms
+           << ",\"share\":" << share(types[i].second.ms) << ",\"layers\":" << types[i].second.layers << "}";
+    }
+    ss << "],\"by_layer\":[";
+    for (size_t i = 0; i < by_layer.size(); i++) {
+        const LayerStats& layer = *by_layer[i];
+        if (i > 0) ss << ",";
+        ss << "{\"name\":\"" << layer.name << "\",\"type\":\"" << layer.type << "\",\"ms\":" << layer.ms
+           << ",\"avg_ms\":" << layer.ms / layer.calls << ",\"share\":" << share(layer.ms) << "}";
+    }
+    ss << "]}";
+    return ss.str();
+}
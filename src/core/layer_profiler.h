@@ -0,0 +1,36 @@
+#ifndef LAYER_PROFILER_H
+#define LAYER_PROFILER_H
+
+#include <string>
+#include <vector>
+
+#include "net.h"
+
+// Per-layer timing for one ncnn::Net without rebuilding ncnn with
+// NCNN_BENCHMARK. The extractor runs with light mode off and extracts the top
+// blob of every layer in param (topological) order, so each extract runs
+// exactly one layer. Times include ncnn's per-layer layout/precision
+// conversions and, for in-place layers, the copy light mode would otherwise
+// avoid. Timing accumulates across calls until reset().
+class LayerProfiler {
+public:
+    // Runs `ex` (inputs already set) layer by layer, then extracts `output` into `out`
+    int extract(const ncnn::Net& net, ncnn::Extractor& ex, const char* output, ncnn::Mat& out);
+    void reset();
+
+    // {"runs","total_ms","by_type":[...],"by_layer":[...]}, both sorted by time
+    std::string to_json() const;
+
+private:
+    struct LayerStats {
+        std::string name;
+        std::string type;
+        double ms = 0.0;
+        long calls = 0;
+    };
+
+    std::vector<LayerStats> m_layers; // by layer index
+    long m_runs = 0;
+};
+
+#endif // LAYER_PROFILER_H
@@ -0,0 +1,314 @@
+#include "layout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+
+// Axis-aligned extent of a box or of a group of boxes
+struct Extent {
+    float x0, y0, x1, y1;
+    float h; // typical text height of the member boxes
+
+    float width() const { return x1 - x0; }
+    float cy() const { return (y0 + y1) * 0.5f; }
+    float x_overlap(const Extent& o) const { return std::min(x1, o.x1) - std::max(x0, o.x0); }
+};
+
+struct DisjointSet {
+    std::vector<int> parent;
+
+    explicit DisjointSet(int n)
+        : parent(n)
+    {
+        for (int i = 0; i < n; i++) parent[i] = i;
+    }
+
+    int find(int x)
+    {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    void unite(int a, int b)
+    {
+        a = find(a);
+        b = find(b);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+};
+
+// Uniform grid over anchor points. Only occupied cells are stored, so memory
+// follows the number of boxes rather than the page area.
+class GridIndex {
+public:
+    GridIndex(float cell_w, float cell_h)
+        : m_cell_w(cell_w)
+        , m_cell_h(cell_h)
+    {
+    }
+
+    void insert(float x, float y, int id) { m_cells[key(cell(x, m_cell_w), cell(y, m_cell_h))].push_back(id); }
+
+    // Calls fn(id) for every anchor inside the cells covering [x0, x1] x [y0, y1]
+    template <typename F>
+    void query(float x0, float y0, float x1, float y1, F&& fn) const
+    {
+        const int gx1 = cell(x1, m_cell_w);
+        const int gy1 = cell(y1, m_cell_h);
+        for (int gy = cell(y0, m_cell_h); gy <= gy1; gy++) {
+            for (int gx = cell(x0, m_cell_w); gx <= gx1; gx++) {
+                auto it = m_cells.find(key(gx, gy));
+                if (it == m_cells.end()) continue;
+                for (int id : it->second) fn(id);
+            }
+        }
+    }
+
+private:
+    static int cell(float v, float size) { return (int)std::floor(v / size); }
+    static long long key(int gx, int gy) { return ((long long)gx << 32) ^ (unsigned int)gy; }
+
+    float m_cell_w;
+    float m_cell_h;
+    std::unordered_map<long long, std::vector<int>> m_cells;
+};
+
+static Extent merge_extents(const std::vector<Extent>& extents, const std::vector<int>& members)
+{
+    Extent e = extents[members[0]];
+    float h_sum = 0.f;
+    for (int m : members) {
+        e.x0 = std::min(e.x0, extents[m].x0);
+        e.y0 = std::min(e.y0, extents[m].y0);
+        e.x1 = std::max(e.x1, extents[m].x1);
+        e.y1 = std::max(e.y1, extents[m].y1);
+        h_sum += extents[m].h;
+    }
+    e.h = h_sum / members.size();
+    return e;
+}
+
+// Collects the members of every set, ordered by their smallest index
+static std::vector<std::vector<int>> collect_groups(DisjointSet& sets, int n)
+{
+    std::vector<int> group_of(n, -1);
+    std::vector<std::vector<int>> groups;
+    for (int i = 0; i < n; i++) {
+        int root = sets.find(i);
+        if (group_of[root] < 0) {
+            group_of[root] = (int)groups.size();
+            groups.emplace_back();
+        }
+        groups[group_of[root]].push_back(i);
+    }
+    return groups;
+}
+
+// Whether a box reads left to right: its long side lies within 30 degrees of
+// the x axis. Near-square boxes (single characters) count as horizontal.
+bool is_horizontal(const RotatedRect& rrect)
+{
+    const float w = rrect.size.width, h = rrect.size.height;
+    if (std::max(w, h) < 1.5f * std::min(w, h)) return true;
+    float dir = w >= h ? rrect.angle : rrect.angle + 90.f;
+    dir = std::fmod(dir, 180.f);
+    if (dir < 0.f) dir += 180.f;
+    return dir <= 30.f || dir >= 150.f;
+}
+
+} // namespace
+
+std::vector<size_t> assemble_layout(std::vector<Object>& objects)
+{
+    const int n = (int)objects.size();
+    std::vector<size_t> order;
+    if (n == 0) return order;
+
+    // 1. Box extents. The text height of a horizontal line is the extent across it.
+    std::vector<Extent> boxes(n);
+    std::vector<float> heights(n);
+    std::vector<char> horizontal(n);
+    for (int i = 0; i < n; i++) {
+        horizontal[i] = is_horizontal(objects[i].rrect);
+        Point corners[4];
+        objects[i].rrect.points(corners);
+        Extent e = { corners[0].x, corners[0].y, corners[0].x, corners[0].y, 0.f };
+        for (int k = 1; k < 4; k++) {
+            e.x0 = std::min(e.x0, corners[k].x);
+            e.y0 = std::min(e.y0, corners[k].y);
+            e.x1 = std::max(e.x1, corners[k].x);
+            e.y1 = std::max(e.y1, corners[k].y);
+        }
+        e.h = std::max(e.y1 - e.y0, 1.f);
+        boxes[i] = e;
+        heights[i] = e.h;
+    }
+    std::nth_element(heights.begin(), heights.begin() + n / 2, heights.end());
+    const float median_h = heights[n / 2];
+
+    // 2. Lines: link each box to boxes whose left edge starts just after its
+    // right edge on the same baseline band. Anchors are (left edge, center y).
+    // Vertical and rotated boxes (vertical CJK columns, rotated labels) are
+    // lines of their own, since side by side they are separate columns.
+    DisjointSet line_sets(n);
+    {
+        GridIndex grid(median_h, median_h);
+        for (int i = 0; i < n; i++) grid.insert(boxes[i].x0, boxes[i].cy(), i);
+
+        for (int i = 0; i < n; i++) {
+            if (!horizontal[i]) continue;
+            const Extent& a = boxes[i];
+            const float max_gap = 1.5f * a.h;
+            grid.query(a.x1 - a.h, a.cy() - 0.5f * a.h, a.x1 + max_gap, a.cy() + 0.5f * a.h, [&](int j) {
+                if (j == i || !horizontal[j]) return;
+                const Extent& b = boxes[j];
+                const float min_h = std::min(a.h, b.h);
+                if (std::abs(a.cy() - b.cy()) > 0.5f * min_h) return;
+                if (std::max(a.h, b.h) > 2.f * min_h) return;
+                if (b.x0 <= a.x0) return;
+                line_sets.unite(i, j);
+            });
+        }
+    }
+
+    std::vector<std::vector<int>> lines = collect_groups(line_sets, n);
+    const int num_lines = (int)lines.size();
+    std::vector<Extent> line_extents(num_lines);
+    for (int l = 0; l < num_lines; l++) {
+        std::sort(lines[l].begin(), lines[l].end(), [&](int a, int b) { return boxes[a].x0 < boxes[b].x0; });
+        line_extents[l] = merge_extents(boxes, lines[l]);
+    }
+
+    // 3. Paragraphs: chain each line to the closest line directly below it that
+    // overlaps it horizontally. Every line keeps at most one link down and one
+    // link up, so a heading above two columns does not fuse them.
+    std::vector<int> below(num_lines, -1);
+    std::vector<float> below_gap(num_lines, 0.f);
+    {
+        // Lines are bucketed by top edge only; each bucket holds roughly one line per column
+        GridIndex grid(1e30f, median_h);
+        for (int l = 0; l < num_lines; l++) grid.insert(0.f, line_extents[l].y0, l);
+
+        for (int l = 0; l < num_lines; l++) {
+            const Extent& a = line_extents[l];
+            grid.query(0.f, a.cy(), 0.f, a.y1 + 0.8f * a.h, [&](int m) {
+                if (m == l) return;
+                const Extent& b = line_extents[m];
+                const float min_h = std::min(a.h, b.h);
+                if (b.cy() < a.cy() + 0.5f * a.h) return;
+                if (std::max(a.h, b.h) > 1.5f * min_h) return;
+                if (a.x_overlap(b) < 0.5f * std::min(a.width(), b.width())) return;
+                float gap = b.y0 - a.y1;
+                if (gap > 0.8f * min_h) return;
+                if (below[l] < 0 || gap < below_gap[l]) {
+                    below[l] = m;
+                    below_gap[l] = gap;
+                }
+            });
+        }
+    }
+
+    std::vector<int> above(num_lines, -1);
+    for (int l = 0; l < num_lines; l++) {
+        int m = below[l];
+        if (m < 0) continue;
+        if (above[m] < 0 || below_gap[l] < below_gap[above[m]]) above[m] = l;
+    }
+
+    DisjointSet para_sets(num_lines);
+    for (int m = 0; m < num_lines; m++) {
+        if (above[m] >= 0) para_sets.unite(above[m], m);
+    }
+    std::vector<std::vector<int>> paragraphs = collect_groups(para_sets, num_lines);
+    const int num_paragraphs = (int)paragraphs.size();
+    std::vector<Extent> para_extents(num_paragraphs);
+    for (int p = 0; p < num_paragraphs; p++) {
+        std::sort(paragraphs[p].begin(), paragraphs[p].end(),
+            [&](int a, int b) { return line_extents[a].y0 < line_extents[b].y0; });
+        para_extents[p] = merge_extents(line_extents, paragraphs[p]);
+    }
+
+    // 4. Columns: sweep paragraphs top to bottom and append each to an open
+    // column of similar horizontal extent; columns close once the sweep has
+    // moved well past their bottom.
+    std::vector<int> para_order(num_paragraphs);
+    for (int p = 0; p < num_paragraphs; p++) para_order[p] = p;
+    std::sort(para_order.begin(), para_order.end(),
+        [&](int a, int b) { return para_extents[a].y0 < para_extents[b].y0; });
+
+    std::vector<std::vector<int>> columns;
+    std::vector<Extent> column_extents;
+    std::vector<int> open_columns;
+    for (int p : para_order) {
+        const Extent& e = para_extents[p];
+        int target = -1;
+        for (size_t k = 0; k < open_columns.size();) {
+            const Extent& c = column_extents[open_columns[k]];
+            if (e.y0 - c.y1 > 4.f * std::max(c.h, e.h)) {
+                open_columns.erase(open_columns.begin() + k);
+                continue;
+            }
+            if (target < 0 && c.x_overlap(e) >= 0.5f * std::max(c.width(), e.width())) target = open_columns[k];
+            k++;
+        }
+
+        if (target < 0) {
+            target = (int)columns.size();
+            columns.emplace_back();
+            column_extents.push_back(e);
+            open_columns.push_back(target);
+        }
+        Extent& c = column_extents[target];
+        c.x0 = std::min(c.x0, e.x0);
+        c.x1 = std::max(c.x1, e.x1);
+        c.y0 = std::min(c.y0, e.y0);
+        c.y1 = std::max(c.y1, e.y1);
+        c.h = e.h;
+        columns[target].push_back(p);
+    }
+
+    // 5. Reading order: columns whose vertical ranges overlap form a band and
+    // are read left to right; bands are read top to bottom.
+    std::vector<int> column_order(columns.size());
+    for (size_t c = 0; c < columns.size(); c++) column_order[c] = (int)c;
+    std::sort(column_order.begin(), column_order.end(),
+        [&](int a, int b) { return column_extents[a].y0 < column_extents[b].y0; });
+
+    std::vector<int> sorted_columns;
+    size_t band_begin = 0;
+    while (band_begin < column_order.size()) {
+        float band_bottom = column_extents[column_order[band_begin]].y1;
+        size_t band_end = band_begin + 1;
+        while (band_end < column_order.size() && column_extents[column_order[band_end]].y0 < band_bottom) {
+            band_bottom = std::max(band_bottom, column_extents[column_order[band_end]].y1);
+            band_end++;
+        }
+        std::sort(column_order.begin() + band_begin, column_order.begin() + band_end,
+            [&](int a, int b) { return column_extents[a].x0 < column_extents[b].x0; });
+        sorted_columns.insert(sorted_columns.end(), column_order.begin() + band_begin, column_order.begin() + band_end);
+        band_begin = band_end;
+    }
+
+    order.reserve(n);
+    int line_id = 0;
+    int paragraph_id = 0;
+    for (int c : sorted_columns) {
+        for (int p : columns[c]) {
+            for (int l : paragraphs[p]) {
+                for (int b : lines[l]) {
+                    objects[b].line_id = line_id;
+                    objects[b].paragraph_id = paragraph_id;
+                    order.push_back((size_t)b);
+                }
+                line_id++;
+            }
+            paragraph_id++;
+        }
+    }
+    return order;
+}
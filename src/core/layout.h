@@ -0,0 +1,14 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <vector>
+
+#include "ocr_engine.h"
+
+// Groups text boxes into lines, paragraphs and columns using grid indexes, so
+// the cost stays near-linear in the number of boxes.
+// Fills Object::line_id / Object::paragraph_id (numbered in reading order) and
+// returns the indices of `objects` in reading order.
+std::vector<size_t> assemble_layout(std::vector<Object>& objects);
+
+#endif // LAYOUT_H
@@ -0,0 +1,247 @@
+#include "log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+namespace logger {
+
+std::atomic<int> g_level { OCR_LOG_LEVEL };
+
+namespace {
+
+    const size_t RING_SIZE = 256;
+
+    struct Record {
+        double t_ms;
+        Level level;
+        const char* file;
+        int line;
+        size_t len;
+        char msg[Line::MAX_MESSAGE];
+    };
+
+    // Fixed storage, no allocation on the logging path
+    Record g_ring[RING_SIZE];
+    size_t g_head = 0; // next slot to write
+    size_t g_count = 0; // buffered records
+    size_t g_dropped = 0;
+    std::mutex g_mutex;
+
+#if defined(DEBUG)
+    std::atomic<int> g_echo_level { LEVEL_DEBUG };
+#else
+    std::atomic<int> g_echo_level { LEVEL_ERROR };
+#endif
+
+    const char* const LEVEL_NAMES[] = { "debug", "info", "warn", "error" };
+    const char* const LEVEL_TAGS[] = { "[DEBUG] ", "[INFO] ", "[WARN] ", "[ERROR] " };
+
+    const char* base_name(const char* path)
+    {
+        const char* slash = strrchr(path, '/');
+#ifdef _WIN32
+        const char* backslash = strrchr(path, '\\');
+        if (backslash && (!slash || backslash > slash)) slash = backslash;
+#endif
+        return slash ? slash + 1 : path;
+    }
+
+    void echo(const Record& r)
+    {
+        // One fwrite per record, so lines from different threads do not interleave
+        char out[Line::MAX_MESSAGE + 96];
+        int n;
+        if (r.level == LEVEL_DEBUG || r.level == LEVEL_ERROR)
+            n = snprintf(out, sizeof(out), "%s%s:%d %.*s\n", LEVEL_TAGS[r.level], r.file, r.line, (int)r.len, r.msg);
+        else
+            n = snprintf(out, sizeof(out), "%s%.*s\n", LEVEL_TAGS[r.level], (int)r.len, r.msg);
+        if (n <= 0) return;
+        fwrite(out, 1, std::min((size_t)n, sizeof(out) - 1), r.level == LEVEL_ERROR ? stderr : stdout);
+    }
+
+    void append_json_string(std::string& out, const char* s, size_t n)
+    {
+        out += '"';
+        for (size_t i = 0; i < n; i++) {
+            const unsigned char c = (unsigned char)s[i];
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += (char)c;
+            } else if (c == '\n') {
+                out += "\\n";
+            } else if (c < 0x20) {
+                char esc[8];
+                snprintf(esc, sizeof(esc), "\\u%04x", c);
+                out += esc;
+            } else {
+                out += (char)c;
+            }
+        }
+        out += '"';
+    }
+
+} // namespace
+
+void set_level(int level) { g_level.store(std::max(0, std::min(level, (int)LEVEL_OFF)), std::memory_order_relaxed); }
+
+int level() { return g_level.load(std::memory_order_relaxed); }
+
+void set_echo_level(int level)
+{
+    g_echo_level.store(std::max(0, std::min(level, (int)LEVEL_OFF)), std::memory_order_relaxed);
+}
+
+std::string drain_json()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    std::string out = "[";
+    char head[96];
+    for (size_t i = 0; i < g_count; i++) {
+        const Record& r = g_ring[(g_head + RING_SIZE - g_count + i) % RING_SIZE];
+        snprintf(head, sizeof(head), "%s{\"t\":%.3f,\"level\":\"%s\",\"line\":%d,\"file\":", i ? "," : "", r.t_ms,
+            LEVEL_NAMES[r.level], r.line);
+        out += head;
+        append_json_string(out, r.file, strlen(r.file));
+        out += ",\"msg\":";
+        append_json_string(out, r.msg, r.len);
+        out += '}';
+    }
+    out += ']';
+    g_count = 0;
+    return out;
+}
+
+size_t dropped()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_dropped;
+}
+
+Line::Line(Level level, const char* file, int line)
+    : m_level(level)
+    , m_file(file)
+    , m_line(line)
+{
+}
+
+Line::~Line()
+{
+    const double t_ms
+        = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    const char* file = base_name(m_file);
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Record& r = g_ring[g_head];
+    r.t_ms = t_ms;
+    r.level = m_level;
+    r.file = file;
+    r.line = m_line;
+    r.len = m_len;
+    memcpy(r.msg, m_buf, m_len);
+    g_head = (g_head + 1) % RING_SIZE;
+    if (g_count == RING_SIZE)
+        g_dropped++;
+    else
+        g_count++;
+
+    if ((int)m_level >= g_echo_level.load(std::memory_order_relaxed)) echo(r);
+}
+
+void Line::append(const char* s, size_t n)
+{
+    n = std::min(n, MAX_MESSAGE - m_len);
+    memcpy(m_buf + m_len, s, n);
+    m_len += n;
+}
+
+Line& Line::operator<<(const char* s)
+{
+    if (s)
+        append(s, strlen(s));
+    else
+        append("(null)", 6);
+    return *this;
+}
+
+Line& Line::operator<<(const std::string& s)
+{
+    append(s.data(), s.size());
+    return *this;
+}
+
+Line& Line::operator<<(char c)
+{
+    append(&c, 1);
+    return *this;
+}
+
+// Numbers print like the default ostream formatting they replace
+#define LOG_APPEND_FORMAT(fmt, value)                         \
+    do {                                                      \
+        char num[32];                                         \
+        const int n = snprintf(num, sizeof(num), fmt, value); \
+        if (n > 0) append(num, (size_t)n);                    \
+    } while (0)
+
+Line& Line::operator<<(bool v)
+{
+    append(v ? "1" : "0", 1);
+    return *this;
+}
+
+Line& Line::operator<<(int v)
+{
+    LOG_APPEND_FORMAT("%d", v);
+    return *this;
+}
+
+Line& Line::operator<<(long v)
+{
+    LOG_APPEND_FORMAT("%ld", v);
+    return *this;
+}
+
+Line& Line::operator<<(long long v)
+{
+    LOG_APPEND_FORMAT("%lld", v);
+    return *this;
+}
+
+Line& Line::operator<<(unsigned v)
+{
+    LOG_APPEND_FORMAT("%u", v);
+    return *this;
+}
+
+Line& Line::operator<<(unsigned long v)
+{
+    LOG_APPEND_FORMAT("%lu", v);
+    return *this;
+}
+
+Line& Line::operator<<(unsigned long long v)
+{
+    LOG_APPEND_FORMAT("%llu", v);
+    return *this;
+}
+
+Line& Line::operator<<(float v) { return *this << (double)v; }
+
+Line& Line::operator<<(double v)
+{
+    LOG_APPEND_FORMAT("%g", v);
+    return *this;
+}
+
+Line& Line::operator<<(const void* p)
+{
+    LOG_APPEND_FORMAT("%p", p);
+    return *this;
+}
+
+#undef LOG_APPEND_FORMAT
+
+} // namespace logger
@@ -1,46 +1,135 @@
 #pragma once
 
-#include <cstring> // For strrchr
-#include <iostream> // For std::cout, std::cerr, std::endl
-#include <sstream> // For std::stringstream
-#include <string> // For std::string
-
-// Macro to get filename only from __FILE__
-#ifdef _WIN32
-#define __FILENAME__ (strrchr(__FILE__, '\\') ? strrchr(__FILE__, '\\') + 1 : __FILE__)
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+// Leveled logger without iostream. Records are formatted into a stack buffer
+// and stored in a fixed ring that the host drains (get_logs); records at or
+// above the echo level are also written to stdout/stderr right away.
+//
+// Levels below OCR_LOG_LEVEL compile to nothing. The others are filtered at
+// runtime before any formatting, so a filtered call costs one relaxed load and
+// never evaluates its message.
+//
+// Usage is unchanged: LOG_INFO("Threshold: " << value);
+
+// Compile-time floor: 0 debug, 1 info, 2 warn, 3 error, 4 off.
+// Enable LOG_DEBUG only if DEBUG is explicitly defined. This allows
+// RelWithDebInfo to have debug logs (by defining DEBUG) even if NDEBUG is set
+// by standard CMake rules.
+#ifndef OCR_LOG_LEVEL
+#if defined(DEBUG)
+#define OCR_LOG_LEVEL 0
 #else
-#define __FILENAME__ (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
+#define OCR_LOG_LEVEL 1
+#endif
 #endif
 
-// --- Debug Logging ---
-// Enable LOG_DEBUG only if DEBUG is explicitly defined.
-// This allows RelWithDebInfo to have debug logs (by defining DEBUG)
-// even if NDEBUG is set by standard CMake rules.
-#if defined(DEBUG)
-#define LOG_DEBUG(msg)                                                                         \
-    do {                                                                                       \
-        std::cout << "[DEBUG] " << __FILENAME__ << ":" << __LINE__ << " " << msg << std::endl; \
+namespace logger {
+
+enum Level {
+    LEVEL_DEBUG = 0,
+    LEVEL_INFO = 1,
+    LEVEL_WARN = 2,
+    LEVEL_ERROR = 3,
+    LEVEL_OFF = 4,
+};
+
+extern std::atomic<int> g_level;
+
+inline bool enabled(Level level) { return (int)level >= g_level.load(std::memory_order_relaxed); }
+
+// Lowest level that is recorded (default OCR_LOG_LEVEL)
+void set_level(int level);
+int level();
+
+// Lowest level that is also printed as it happens (default: everything in
+// DEBUG builds, errors otherwise)
+void set_echo_level(int level);
+
+// Buffered records, oldest first, as a JSON array; clears the buffer.
+// [{"t":ms,"level":"warn","file":"ocr_engine.cpp","line":406,"msg":"..."}]
+std::string drain_json();
+
+// Records overwritten before they were drained, since start
+size_t dropped();
+
+// One record being formatted; committed in the destructor. Messages longer
+// than MAX_MESSAGE bytes are truncated.
+class Line {
+public:
+    static const size_t MAX_MESSAGE = 240;
+
+    Line(Level level, const char* file, int line);
+    ~Line();
+
+    Line& operator<<(const char* s);
+    Line& operator<<(const std::string& s);
+    Line& operator<<(char c);
+    Line& operator<<(bool v);
+    Line& operator<<(int v);
+    Line& operator<<(long v);
+    Line& operator<<(long long v);
+    Line& operator<<(unsigned v);
+    Line& operator<<(unsigned long v);
+    Line& operator<<(unsigned long long v);
+    Line& operator<<(float v);
+    Line& operator<<(double v);
+    Line& operator<<(const void* p);
+
+private:
+    void append(const char* s, size_t n);
+
+    Level m_level;
+    const char* m_file;
+    int m_line;
+    size_t m_len = 0;
+    char m_buf[MAX_MESSAGE];
+};
+
+} // namespace logger
+
+#define OCR_LOG(level, msg)                                    \
+    do {                                                       \
+        if (logger::enabled(level)) {                          \
+            logger::Line log_line_(level, __FILE__, __LINE__); \
+            log_line_ << msg;                                  \
+        }                                                      \
     } while (0)
+
+// --- Debug Logging ---
+#if OCR_LOG_LEVEL <= 0
+#define LOG_DEBUG(msg) OCR_LOG(logger::LEVEL_DEBUG, msg)
 #else
 #define LOG_DEBUG(msg) \
     do {               \
     } while (0)
 #endif
 
-// --- Info Logging (usually enabled in both debug and release) ---
-#define LOG_INFO(msg)                               \
-    do {                                            \
-        std::cout << "[INFO] " << msg << std::endl; \
+// --- Info Logging ---
+#if OCR_LOG_LEVEL <= 1
+#define LOG_INFO(msg) OCR_LOG(logger::LEVEL_INFO, msg)
+#else
+#define LOG_INFO(msg) \
+    do {              \
     } while (0)
+#endif
 
 // --- Warning Logging ---
-#define LOG_WARN(msg)                               \
-    do {                                            \
-        std::cout << "[WARN] " << msg << std::endl; \
+#if OCR_LOG_LEVEL <= 2
+#define LOG_WARN(msg) OCR_LOG(logger::LEVEL_WARN, msg)
+#else
+#define LOG_WARN(msg) \
+    do {              \
     } while (0)
+#endif
 
-// --- Error Logging (always enabled) ---
-#define LOG_ERROR(msg)                                                                         \
-    do {                                                                                       \
-        std::cerr << "[ERROR] " << __FILENAME__ << ":" << __LINE__ << " " << msg << std::endl; \
+// --- Error Logging ---
+#if OCR_LOG_LEVEL <= 3
+#define LOG_ERROR(msg) OCR_LOG(logger::LEVEL_ERROR, msg)
+#else
+#define LOG_ERROR(msg) \
+    do {               \
     } while (0)
+#endif
@@ -1,13 +1,74 @@
 #include <emscripten.h>
 #include <unistd.h> // for access()
 
+#include <mutex>
 #include <string>
 
+#include "job_queue.h"
 #include "log.h" // Include our custom logging header
 #include "ocr_engine.h"
+#include "trace.h"
 
 // Global engine instance
 static OCREngine* g_ocr = nullptr;
+// Async detect jobs (see submit_detect), created with the engine
+static JobQueue* g_jobs = nullptr;
+
+// Jobs use the engine from the job thread, so every other call that changes
+// it (or the trace buffer) waits for the running job to finish. The job
+// functions only take the queue's own lock and return at once.
+static std::mutex g_engine_mutex;
+#define ENGINE_LOCK() std::lock_guard<std::mutex> engine_lock(g_engine_mutex)
+
+// Stats queries read JSON published after every call that changes it, so
+// they never wait for a running job
+struct StatsSnapshot {
+    std::string latency = "{}";
+    std::string layer_profile = "{}";
+    std::string result_store = "{}";
+};
+static std::mutex g_stats_mutex;
+static StatsSnapshot g_stats;
+
+// Caller holds the engine lock
+static void publish_stats()
+{
+    StatsSnapshot stats;
+    if (g_ocr) {
+        stats.latency = g_ocr->latency_stats_json();
+        stats.layer_profile = g_ocr->layer_profile_json();
+        stats.result_store = g_ocr->result_store_stats_json();
+    }
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    std::swap(g_stats, stats);
+}
+
+#if OCR_JOB_THREAD
+// Runs Module.onJobDone on the thread that loaded the module, once it is back
+// in its event loop (immediately if that is the calling thread)
+static void post_job_done(uint32_t id, int state)
+{
+    MAIN_THREAD_ASYNC_EM_ASM({ if (Module['onJobDone']) Module['onJobDone']($0, $1); }, id, state);
+}
+#else
+struct JobDone {
+    uint32_t id;
+    int state;
+};
+
+static void fire_job_done(void* arg)
+{
+    const JobDone* done = (const JobDone*)arg;
+    EM_ASM({ if (Module['onJobDone']) Module['onJobDone']($0, $1); }, (int)done->id, done->state);
+    delete done;
+}
+
+// Jobs finish inside submit_detect here, so report them after it has returned the id
+static void post_job_done(uint32_t id, int state)
+{
+    emscripten_async_call(fire_job_done, new JobDone { id, state }, 0);
+}
+#endif
 
 extern "C" {
 
@@ -15,8 +76,14 @@ extern "C" {
 EMSCRIPTEN_KEEPALIVE
 int init_ocr_model(const char* det_param, const char* det_bin, const char* rec_param, const char* rec_bin)
 {
+    // Cancels and joins any job before the engine goes away
+    delete g_jobs;
+    g_jobs = nullptr;
+
+    ENGINE_LOCK();
     if (g_ocr) delete g_ocr;
     g_ocr = new OCREngine();
+    publish_stats();
 
     LOG_INFO("[Core] Initializing with paths:");
     LOG_INFO("  Det Param: " << det_param);
@@ -28,6 +95,17 @@ int init_ocr_model(const char* det_param, const char* det_bin, const char* rec_p
     }
 
     g_ocr->load_model(det_param, det_bin, rec_param, rec_bin);
+    g_jobs = new JobQueue(
+        [](DetectJob& job) {
+            ENGINE_LOCK();
+            g_ocr->record_queue_delay(job.wait_ms);
+            g_ocr->set_cancel_flag(&job.cancel);
+            std::string json = g_ocr->detect(job.rgba.data(), job.width, job.height);
+            g_ocr->set_cancel_flag(nullptr);
+            publish_stats();
+            return json;
+        },
+        post_job_done);
     LOG_INFO("OCR Model initialized successfully.");
     return 0;
 }
@@ -36,15 +114,295 @@ int init_ocr_model(const char* det_param, const char* det_bin, const char* rec_p
 EMSCRIPTEN_KEEPALIVE
 void set_text_score_threshold(float threshold)
 {
+    ENGINE_LOCK();
     if (g_ocr) {
         g_ocr->set_text_score_threshold(threshold);
     }
 }
 
+// Set Rec Packing Width (0 disables packing of short boxes)
+EMSCRIPTEN_KEEPALIVE
+void set_rec_pack_width(int width)
+{
+    ENGINE_LOCK();
+    if (g_ocr) {
+        g_ocr->set_rec_pack_width(width);
+    }
+}
+
+// Set Rec Chunk Width (0 disables windowed recognition of long lines)
+EMSCRIPTEN_KEEPALIVE
+void set_rec_chunk_width(int width)
+{
+    ENGINE_LOCK();
+    if (g_ocr) {
+        g_ocr->set_rec_chunk_width(width);
+    }
+}
+
+// Set Axis-Aligned Fast Path Tolerance (degrees, negative disables)
+EMSCRIPTEN_KEEPALIVE
+void set_axis_aligned_tolerance(float degrees)
+{
+    ENGINE_LOCK();
+    if (g_ocr) {
+        g_ocr->set_axis_aligned_tolerance(degrees);
+    }
+}
+
+// Enable/Disable Pyramid Sampling of Tall Boxes
+EMSCRIPTEN_KEEPALIVE
+void set_rec_pyramid(int enabled)
+{
+    ENGINE_LOCK();
+    if (g_ocr) {
+        g_ocr->set_rec_pyramid(enabled != 0);
+    }
+}
+
+// Set Det Postprocess Threads (threads builds, 0 = all OpenMP threads)
+EMSCRIPTEN_KEEPALIVE
+void set_postprocess_threads(int num_threads)
+{
+    ENGINE_LOCK();
+    if (g_ocr) {
+        g_ocr->set_postprocess_threads(num_threads);
+    }
+}
+
+// Set Thread Budget (threads builds, 0 = all OpenMP threads; keep within the pthread pool)
+EMSCRIPTEN_KEEPALIVE
+void set_num_threads(int num_threads)
+{
+    ENGINE_LOCK();
+    if (g_ocr) {
+        g_ocr->set_num_threads(num_threads);
+    }
+}
+
+// Rolling Latency Percentiles (JSON)
+EMSCRIPTEN_KEEPALIVE
+const char* get_latency_stats()
+{
+    static std::string ret_cache;
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    ret_cache = g_stats.latency;
+    return ret_cache.c_str();
+}
+
+EMSCRIPTEN_KEEPALIVE
+void reset_latency_stats()
+{
+    ENGINE_LOCK();
+    if (g_ocr) g_ocr->reset_latency_stats();
+    publish_stats();
+}
+
+// Per-Layer Profiling (det/rec inference layer by layer)
+EMSCRIPTEN_KEEPALIVE
+void set_layer_profiling(int enabled)
+{
+    ENGINE_LOCK();
+    if (g_ocr) g_ocr->set_layer_profiling(enabled != 0);
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char* get_layer_profile()
+{
+    static std::string ret_cache;
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    ret_cache = g_stats.layer_profile;
+    return ret_cache.c_str();
+}
+
+EMSCRIPTEN_KEEPALIVE
+void reset_layer_profile()
+{
+    ENGINE_LOCK();
+    if (g_ocr) g_ocr->reset_layer_profile();
+    publish_stats();
+}
+
+// Sequence mode: rerun det/rec only where the frame changed (tile_size 0 disables)
+EMSCRIPTEN_KEEPALIVE
+void set_sequence_mode(int tile_size, int margin)
+{
+    ENGINE_LOCK();
+    if (g_ocr) g_ocr->set_sequence_mode(tile_size, margin);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void reset_sequence()
+{
+    ENGINE_LOCK();
+    if (g_ocr) g_ocr->reset_sequence();
+}
+
+// Persistent result store at `path` (+ `path`.idx) in the VFS (0 on success)
+EMSCRIPTEN_KEEPALIVE
+int open_result_store(const char* path)
+{
+    ENGINE_LOCK();
+    if (!g_ocr) return -1;
+    const bool ok = g_ocr->open_result_store(path);
+    publish_stats();
+    return ok ? 0 : -1;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void close_result_store()
+{
+    ENGINE_LOCK();
+    if (g_ocr) g_ocr->close_result_store();
+    publish_stats();
+}
+
+// Call before copying the store files out of the VFS
+EMSCRIPTEN_KEEPALIVE
+void flush_result_store()
+{
+    ENGINE_LOCK();
+    if (g_ocr) g_ocr->flush_result_store();
+}
+
+// One compaction step of about budget_ms; 1 while work remains
+EMSCRIPTEN_KEEPALIVE
+int compact_result_store(double budget_ms)
+{
+    ENGINE_LOCK();
+    if (!g_ocr) return 0;
+    const bool more = g_ocr->compact_result_store(budget_ms);
+    publish_stats();
+    return more ? 1 : 0;
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char* get_result_store_stats()
+{
+    static std::string ret_cache;
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    ret_cache = g_stats.result_store;
+    return ret_cache.c_str();
+}
+
+// Adds the boxes of the last detect() call to the text index under image_id.
+// Call it right after detect(), not with submit_detect jobs: a job that ends
+// in between replaces the last result.
+EMSCRIPTEN_KEEPALIVE
+void index_last_result(int image_id)
+{
+    ENGINE_LOCK();
+    if (g_ocr && image_id >= 0) g_ocr->index_last_result((uint32_t)image_id);
+}
+
+// Returns the number of boxes removed
+EMSCRIPTEN_KEEPALIVE
+int unindex_image(int image_id)
+{
+    ENGINE_LOCK();
+    if (!g_ocr || image_id < 0) return 0;
+    return (int)g_ocr->remove_indexed_image((uint32_t)image_id);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void clear_text_index()
+{
+    ENGINE_LOCK();
+    if (g_ocr) g_ocr->clear_text_index();
+}
+
+// Indexed boxes containing the UTF-8 phrase (limit 0 = all). Jobs never touch
+// the text index, and only the caller's thread changes it, so reads need no lock.
+EMSCRIPTEN_KEEPALIVE
+const char* search_text(const char* query, int limit)
+{
+    if (!g_ocr) return "[]";
+    static std::string ret_cache;
+    ret_cache = g_ocr->search_text_json(query, limit > 0 ? (size_t)limit : 0);
+    return ret_cache.c_str();
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char* get_text_index_stats()
+{
+    if (!g_ocr) return "{}";
+    static std::string ret_cache;
+    ret_cache = g_ocr->text_index_stats_json();
+    return ret_cache.c_str();
+}
+
+// Capture detect calls for offline replay (0 on success)
+EMSCRIPTEN_KEEPALIVE
+int start_capture(const char* path, int store_pixels, int max_side)
+{
+    ENGINE_LOCK();
+    if (!g_ocr) return -1;
+    return g_ocr->start_capture(path, store_pixels != 0, max_side) ? 0 : -1;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void stop_capture()
+{
+    ENGINE_LOCK();
+    if (g_ocr) g_ocr->stop_capture();
+}
+
+// Tracing (Chrome trace-event JSON; capacity in events, 0 = default)
+EMSCRIPTEN_KEEPALIVE
+void start_trace(int capacity)
+{
+    ENGINE_LOCK();
+    if (capacity > 0)
+        trace::start(capacity);
+    else
+        trace::start();
+}
+
+EMSCRIPTEN_KEEPALIVE
+void stop_trace()
+{
+    ENGINE_LOCK();
+    trace::stop();
+}
+
+// Waits for a running job: events are written without locking, so the buffer
+// can only be read between calls
+EMSCRIPTEN_KEEPALIVE
+const char* export_trace()
+{
+    ENGINE_LOCK();
+    static std::string ret_cache;
+    ret_cache = trace::export_json();
+    return ret_cache.c_str();
+}
+
+// Logging (levels: 0 debug, 1 info, 2 warn, 3 error, 4 off)
+EMSCRIPTEN_KEEPALIVE
+void set_log_level(int level)
+{
+    logger::set_level(level);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void set_log_echo_level(int level)
+{
+    logger::set_echo_level(level);
+}
+
+// Buffered log records as a JSON array; clears the buffer
+EMSCRIPTEN_KEEPALIVE
+const char* get_logs()
+{
+    static std::string ret_cache;
+    ret_cache = logger::drain_json();
+    return ret_cache.c_str();
+}
+
 // Inference
 EMSCRIPTEN_KEEPALIVE
 const char* detect(unsigned char* rgba_data, int width, int height)
 {
+    ENGINE_LOCK();
     if (!g_ocr) {
         return "{\"error\": \"OCR engine not initialized. Call init_ocr_model() "
                "first.\"}";
@@ -52,6 +410,7 @@ const char* detect(unsigned char* rgba_data, int width, int height)
 
     // Call C++ core logic
     std::string json_result = g_ocr->detect(rgba_data, width, height);
+    publish_stats();
 
     // Return result
     static std::string ret_cache;
@@ -59,12 +418,78 @@ const char* detect(unsigned char* rgba_data, int width, int height)
     return ret_cache.c_str();
 }
 
+// Batch Inference (small images share detection passes)
+// rgba_ptrs/widths/heights are arrays of `count` entries
+EMSCRIPTEN_KEEPALIVE
+const char* detect_batch(unsigned char** rgba_ptrs, int* widths, int* heights, int count)
+{
+    ENGINE_LOCK();
+    if (!g_ocr) {
+        return "{\"error\": \"OCR engine not initialized. Call init_ocr_model() "
+               "first.\"}";
+    }
+
+    std::string json_result = g_ocr->detect_batch(rgba_ptrs, widths, heights, count);
+    publish_stats();
+
+    static std::string ret_cache;
+    ret_cache = json_result;
+    return ret_cache.c_str();
+}
+
+// Async Inference: copies the image and queues it, returning a job id (-1
+// without an engine). Threads builds run jobs one at a time on a thread the
+// module owns, so the caller stays free to cancel or submit; other builds run
+// the job before returning. Module.onJobDone(jobId, state) reports every
+// finished or cancelled job. Priority: 0 interactive, 1 visible, 2 background.
+// A request for pixels that are already queued or running shares that job.
+EMSCRIPTEN_KEEPALIVE
+int submit_detect(unsigned char* rgba_data, int width, int height, int priority)
+{
+    if (!g_jobs) return -1;
+    return (int)g_jobs->submit(rgba_data, width, height, priority);
+}
+
+// Waiting time that lifts a queued job by one priority level (0 = strict priorities)
+EMSCRIPTEN_KEEPALIVE
+void set_job_aging(int ms)
+{
+    if (g_jobs) g_jobs->set_aging_ms(ms);
+}
+
+// 0 queued, 1 running, 2 done, 3 cancelled, -1 unknown or taken
+EMSCRIPTEN_KEEPALIVE
+int poll_job(int job_id)
+{
+    if (!g_jobs) return JOB_UNKNOWN;
+    return g_jobs->state((uint32_t)job_id);
+}
+
+// Ends the request at once (1 if it was pending); its job is dropped or stopped once no request shares it
+EMSCRIPTEN_KEEPALIVE
+int cancel_job(int job_id)
+{
+    if (!g_jobs) return 0;
+    return g_jobs->cancel((uint32_t)job_id) ? 1 : 0;
+}
+
+// Result JSON of a finished job ("null" while pending or after a cancel); frees the job
+EMSCRIPTEN_KEEPALIVE
+const char* take_job_result(int job_id)
+{
+    static std::string ret_cache;
+    if (!g_jobs || !g_jobs->take_result((uint32_t)job_id, ret_cache) || ret_cache.empty()) return "null";
+    return ret_cache.c_str();
+}
+
 // Warmup (Dummy Forward)
 EMSCRIPTEN_KEEPALIVE
 void warmup_model()
 {
+    ENGINE_LOCK();
     if (!g_ocr) return;
     g_ocr->warmup();
+    publish_stats();
 }
 
 // Cleanup VFS to free memory
@@ -2,13 +2,24 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
-#include <queue>
 #include <sstream>
+#include <unordered_map>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
+#include "datareader.h"
+#include "kernels.h"
+#include "layer_profiler.h"
+#include "layout.h"
 #include "log.h" // Include our custom logging header
 #include "ppocrv5_dict.h"
+#include "trace.h"
 
 // --- Profiling Macros (Active only in Debug/RelWithDebInfo) ---
 #ifdef DEBUG
@@ -36,8 +47,33 @@
 #define PROFILE_END_ACCUM(name, accum_ptr)
 #endif
 
+// --- Stage Timers (active in all builds, feed StageTimings) ---
+#define STAGE_START(name) const auto stage_##name = std::chrono::steady_clock::now()
+#define STAGE_ELAPSED(name) \
+    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stage_##name).count()
+// Adds the stage time to *accum_ptr (if set) and emits a trace event when tracing is on
+#define STAGE_END(name, accum_ptr)                                                                                     \
+    do {                                                                                                               \
+        const auto stage_end_##name = std::chrono::steady_clock::now();                                                \
+        double* stage_accum_##name = (accum_ptr);                                                                      \
+        if (stage_accum_##name)                                                                                        \
+            *stage_accum_##name += std::chrono::duration<double, std::milli>(stage_end_##name - stage_##name).count(); \
+        if (trace::enabled()) trace::record(#name, stage_##name, stage_end_##name);                                    \
+    } while (0)
+
 // Constants
 const float PI = 3.1415926535f;
+const int REC_INPUT_HEIGHT = 48; // Rec model expects fixed height 48
+const int REC_MAX_CHUNKED_WIDTH = 16384; // Upper bound for lines recognized in windows
+const int DET_TARGET_SIZE = 960; // Longest det input side
+// Sequence mode runs in full once the regions to redo cover this share of the frame
+const float SEQUENCE_FULL_RUN_AREA = 0.5f;
+
+// Input normalization, (v - mean) * norm per BGR channel
+const float DET_MEAN_VALS[3] = { 0.485f * 255.f, 0.456f * 255.f, 0.406f * 255.f };
+const float DET_NORM_VALS[3] = { 1 / 0.229f / 255.f, 1 / 0.224f / 255.f, 1 / 0.225f / 255.f };
+const float REC_MEAN_VALS[3] = { 127.5f, 127.5f, 127.5f };
+const float REC_NORM_VALS[3] = { 1.0f / 127.5f, 1.0f / 127.5f, 1.0f / 127.5f };
 // const float TEXT_SCORE_THRESHOLD = 0.5f; // Removed in favor of member variable
 
 // -------------------------------------------------------------------------
@@ -72,11 +108,6 @@ void RotatedRect::points(Point pts[]) const
     }
 }
 
-// Simple Matrix for Affine Transform
-struct Matrix2x3 {
-    float m[6]; // m00, m01, m02, m10, m11, m12
-};
-
 static Matrix2x3 get_affine_transform(const Point src[], const Point dst[])
 {
     // Solves for affine matrix mapping 3 src points to 3 dst points
@@ -129,188 +160,147 @@ static Matrix2x3 get_affine_transform(const Point src[], const Point dst[])
     return mat;
 }
 
-static void warp_affine_bilinear(
-    const ncnn::Mat& src, ncnn::Mat& dst, const Matrix2x3& M, int dst_w, int dst_h)
+// Converts RGBA pixels to planar BGR normalized as (v - mean) * norm, writing
+// them at (dst_x, dst_y) of an already allocated 3-channel Mat
+static void rgba_to_bgr_normalize(const unsigned char* rgba, int w, int h, int stride, ncnn::Mat& dst, int dst_x,
+    int dst_y, const float* mean_vals, const float* norm_vals, int num_threads = 1)
 {
-    dst.create(dst_w, dst_h, 3);
-
-    // 计算逆矩阵
-    double D = M.m[0] * M.m[4] - M.m[1] * M.m[3];
-    if (std::abs(D) < 1e-6) return;
-
-    double invD = 1.0 / D;
-    double iM[6];
-    iM[0] = M.m[4] * invD;
-    iM[1] = -M.m[1] * invD;
-    iM[2] = (M.m[1] * M.m[5] - M.m[2] * M.m[4]) * invD;
-    iM[3] = -M.m[3] * invD;
-    iM[4] = M.m[0] * invD;
-    iM[5] = (M.m[2] * M.m[3] - M.m[0] * M.m[5]) * invD;
-
-    const int src_w = src.w;
-    const int src_h = src.h;
-
-    // 预计算每行的起始坐标（行内变化是连续的）
-    std::vector<float> row_start_x(dst_h);
-    std::vector<float> row_start_y(dst_h);
-    for (int dy = 0; dy < dst_h; dy++) {
-        row_start_x[dy] = dy * iM[1] + iM[2];
-        row_start_y[dy] = dy * iM[4] + iM[5];
+    const int threads = parallel_threads((size_t)w * h, num_threads);
+#pragma omp parallel for num_threads(threads) if (threads > 1)
+    for (int y = 0; y < h; y++) {
+        const unsigned char* p = rgba + (size_t)y * stride;
+        float* b = dst.channel(0).row(dst_y + y) + dst_x;
+        float* g = dst.channel(1).row(dst_y + y) + dst_x;
+        float* r = dst.channel(2).row(dst_y + y) + dst_x;
+        for (int x = 0; x < w; x++) {
+            b[x] = (p[2] - mean_vals[0]) * norm_vals[0];
+            g[x] = (p[1] - mean_vals[1]) * norm_vals[1];
+            r[x] = (p[0] - mean_vals[2]) * norm_vals[2];
+            p += 4;
+        }
     }
+}
 
-    // 按通道处理（更好的缓存局部性）
-    for (int c = 0; c < 3; c++) {
-        const float* src_ptr = src.channel(c);
-        float* dst_ptr = dst.channel(c);
-
-        for (int dy = 0; dy < dst_h; dy++) {
-            float sx = row_start_x[dy];
-            float sy = row_start_y[dy];
-
-            // 行步进增量
-            const float sx_step = iM[0];
-            const float sy_step = iM[3];
-
-            for (int dx = 0; dx < dst_w; dx++) {
-                // 双线性插值
-                int x0 = (int)sx;
-                int y0 = (int)sy;
-
-                // 边界检查（优化：使用位运算）
-                if ((unsigned)x0 < (unsigned)(src_w - 1) && (unsigned)y0 < (unsigned)(src_h - 1)) {
-                    // 在范围内，快速路径
-                    float u = sx - x0;
-                    float v = sy - y0;
-
-                    const float* p = src_ptr + y0 * src_w + x0;
-                    float v00 = p[0];
-                    float v01 = p[1];
-                    float v10 = p[src_w];
-                    float v11 = p[src_w + 1];
-
-                    float val = v00 * (1 - u) * (1 - v) + v01 * u * (1 - v) + v10 * (1 - u) * v + v11 * u * v;
-
-                    dst_ptr[dy * dst_w + dx] = val;
-                } else {
-                    // 边界处理（使用clamp）
-                    int x0_c = std::max(0, std::min(x0, src_w - 1));
-                    int y0_c = std::max(0, std::min(y0, src_h - 1));
-                    int x1_c = std::max(0, std::min(x0 + 1, src_w - 1));
-                    int y1_c = std::max(0, std::min(y0 + 1, src_h - 1));
-
-                    float u = sx - x0;
-                    float v = sy - y0;
-
-                    float v00 = src_ptr[y0_c * src_w + x0_c];
-                    float v01 = src_ptr[y0_c * src_w + x1_c];
-                    float v10 = src_ptr[y1_c * src_w + x0_c];
-                    float v11 = src_ptr[y1_c * src_w + x1_c];
-
-                    float val = v00 * (1 - u) * (1 - v) + v01 * u * (1 - v) + v10 * (1 - u) * v + v11 * u * v;
-
-                    dst_ptr[dy * dst_w + dx] = val;
-                }
-
-                // 增量更新
-                sx += sx_step;
-                sy += sy_step;
+// Bilinear resize of RGBA pixels straight into a normalized planar BGR Mat at
+// (dst_x, dst_y), with the same half-pixel sampling as ncnn's resize_bilinear.
+// Output rows are split into tiles across threads for large outputs.
+static void resize_rgba_to_bgr_normalize(const unsigned char* src, int src_w, int src_h, ncnn::Mat& dst, int dst_x,
+    int dst_y, int w, int h, const float* mean_vals, const float* norm_vals, int num_threads = 1)
+{
+    // Source taps along one axis: left/top index, right/bottom index and weight
+    auto make_taps = [](int src_size, int dst_size, std::vector<int>& i0, std::vector<int>& i1,
+                         std::vector<float>& alpha) {
+        const float scale = (float)src_size / dst_size;
+        i0.resize(dst_size);
+        i1.resize(dst_size);
+        alpha.resize(dst_size);
+        for (int d = 0; d < dst_size; d++) {
+            float f = (d + 0.5f) * scale - 0.5f;
+            int i = (int)std::floor(f);
+            f -= i;
+            if (i < 0) {
+                i = 0;
+                f = 0.f;
+            }
+            if (i >= src_size - 1) {
+                i = src_size - 1;
+                f = 0.f;
             }
+            i0[d] = i;
+            i1[d] = std::min(i + 1, src_size - 1);
+            alpha[d] = f;
+        }
+    };
+
+    std::vector<int> x0, x1, y0, y1;
+    std::vector<float> ax, ay;
+    make_taps(src_w, w, x0, x1, ax);
+    make_taps(src_h, h, y0, y1, ay);
+
+    const int threads = parallel_threads((size_t)w * h, num_threads);
+#pragma omp parallel for num_threads(threads) if (threads > 1)
+    for (int dy = 0; dy < h; dy++) {
+        const unsigned char* row0 = src + (size_t)y0[dy] * src_w * 4;
+        const unsigned char* row1 = src + (size_t)y1[dy] * src_w * 4;
+        const float b1 = ay[dy];
+        const float b0 = 1.f - b1;
+        float* out_b = dst.channel(0).row(dst_y + dy) + dst_x;
+        float* out_g = dst.channel(1).row(dst_y + dy) + dst_x;
+        float* out_r = dst.channel(2).row(dst_y + dy) + dst_x;
+        for (int dx = 0; dx < w; dx++) {
+            const unsigned char* p00 = row0 + x0[dx] * 4;
+            const unsigned char* p01 = row0 + x1[dx] * 4;
+            const unsigned char* p10 = row1 + x0[dx] * 4;
+            const unsigned char* p11 = row1 + x1[dx] * 4;
+            const float a1 = ax[dx];
+            const float a0 = 1.f - a1;
+            float v[3];
+            for (int k = 0; k < 3; k++) {
+                v[k] = (p00[k] * a0 + p01[k] * a1) * b0 + (p10[k] * a0 + p11[k] * a1) * b1;
+            }
+            out_b[dx] = (v[2] - mean_vals[0]) * norm_vals[0];
+            out_g[dx] = (v[1] - mean_vals[1]) * norm_vals[1];
+            out_r[dx] = (v[0] - mean_vals[2]) * norm_vals[2];
         }
     }
 }
 
-// -------------------------------------------------------------------------
-// Contour & Box Helpers (Simplified)
-// -------------------------------------------------------------------------
-
-struct IntPoint {
-    int x, y;
-};
-
-static void get_min_area_rect(const std::vector<IntPoint>& contour, RotatedRect& out_rect)
+// Fills everything outside the (x, y, w, h) window of a 3-channel Mat with a
+// per-channel constant
+static void fill_border(ncnn::Mat& dst, int x, int y, int w, int h, const float* values)
 {
-    if (contour.empty()) return;
-
-    // PCA Approach
-    double mean_x = 0, mean_y = 0;
-    for (const auto& p : contour) {
-        mean_x += p.x;
-        mean_y += p.y;
-    }
-    mean_x /= contour.size();
-    mean_y /= contour.size();
-
-    double cov_xx = 0, cov_xy = 0, cov_yy = 0;
-    for (const auto& p : contour) {
-        double dx = p.x - mean_x;
-        double dy = p.y - mean_y;
-        cov_xx += dx * dx;
-        cov_xy += dx * dy;
-        cov_yy += dy * dy;
-    }
-
-    // Eigen decomposition of symmetric 2x2 matrix
-    // [ a  b ]
-    // [ b  c ]
-    // lambda = ((a+c) +/- sqrt((a-c)^2 + 4b^2)) / 2
-    double D = sqrt((cov_xx - cov_yy) * (cov_xx - cov_yy) + 4.0 * cov_xy * cov_xy);
-    double lambda1 = (cov_xx + cov_yy + D) / 2.0;
-    // double lambda2 = (cov_xx + cov_yy - D) / 2.0;
-
-    // Eigen vector 1 (Main direction)
-    double vx = 1.0, vy = 0.0;
-    if (std::abs(cov_xy) > 1e-6) {
-        vx = lambda1 - cov_yy;
-        vy = cov_xy;
-    } else {
-        if (cov_xx >= cov_yy) {
-            vx = 1.0;
-            vy = 0.0;
-        } else {
-            vx = 0.0;
-            vy = 1.0;
+    for (int c = 0; c < 3; c++) {
+        for (int row = 0; row < dst.h; row++) {
+            float* p = dst.channel(c).row(row);
+            if (row < y || row >= y + h) {
+                std::fill(p, p + dst.w, values[c]);
+            } else {
+                std::fill(p, p + x, values[c]);
+                std::fill(p + x + w, p + dst.w, values[c]);
+            }
         }
     }
-    double len = sqrt(vx * vx + vy * vy);
-    vx /= len;
-    vy /= len;
+}
 
-    // Project points to principal axes to find box
-    // Axis 1: (vx, vy), Axis 2: (-vy, vx)
-    double min_u = 1e9, max_u = -1e9;
-    double min_v = 1e9, max_v = -1e9;
+// Box-filter downscale of an RGBA region by an integer factor. Trailing rows and
+// columns that do not fill a whole block are dropped.
+static void downscale_box_rgba(const unsigned char* rgba_data, int img_w, int x, int y, int w, int h, int factor,
+    std::vector<unsigned char>& out)
+{
+    const int out_w = w / factor;
+    const int out_h = h / factor;
+    const int area = factor * factor;
+    out.resize(out_w * out_h * 4);
+
+    std::vector<int> acc(out_w * 4);
+    for (int oy = 0; oy < out_h; oy++) {
+        std::fill(acc.begin(), acc.end(), 0);
+        for (int ky = 0; ky < factor; ky++) {
+            const unsigned char* src_row = rgba_data + ((size_t)(y + oy * factor + ky) * img_w + x) * 4;
+            for (int ox = 0; ox < out_w; ox++) {
+                const unsigned char* p = src_row + ox * factor * 4;
+                int* a = acc.data() + ox * 4;
+                for (int kx = 0; kx < factor; kx++) {
+                    a[0] += p[0];
+                    a[1] += p[1];
+                    a[2] += p[2];
+                    a[3] += p[3];
+                    p += 4;
+                }
+            }
+        }
 
-    for (const auto& p : contour) {
-        double u = (p.x - mean_x) * vx + (p.y - mean_y) * vy;
-        double v = (p.x - mean_x) * -vy + (p.y - mean_y) * vx;
-        if (u < min_u) min_u = u;
-        if (u > max_u) max_u = u;
-        if (v < min_v) min_v = v;
-        if (v > max_v) max_v = v;
+        unsigned char* dst_row = out.data() + oy * out_w * 4;
+        for (int i = 0; i < out_w * 4; i++) {
+            dst_row[i] = (unsigned char)((acc[i] + area / 2) / area);
+        }
     }
-
-    // Box dimensions
-    out_rect.size.width = (float)(max_u - min_u);
-    out_rect.size.height = (float)(max_v - min_v);
-
-    // Center in u,v space
-    double center_u = (min_u + max_u) / 2.0;
-    double center_v = (min_v + max_v) / 2.0;
-
-    // Back to world coords
-    out_rect.center.x = (float)(mean_x + center_u * vx - center_v * vy);
-    out_rect.center.y = (float)(mean_y + center_u * vy + center_v * vx);
-
-    // Angle
-    // atan2(y, x) gives angle in radians. Convert to degrees.
-    // OpenCV angle definition is bit tricky. It's usually angle of the "width"
-    // side? Let's standardise: angle is rotation of the box 0..180 or -90..90.
-    out_rect.angle = (float)(atan2(vy, vx) * 180.0 / PI);
-
-    // Normalize angle / size to match typical expectations (width > height
-    // usually for horizontal text) But PP-OCR handles this in logic later.
 }
 
+// -------------------------------------------------------------------------
+// Contour & Box Helpers (Simplified)
+// -------------------------------------------------------------------------
+
 static double calculate_contour_score(const ncnn::Mat& pred_map, const std::vector<IntPoint>& contour, int w, int h)
 {
     // bounding rect
@@ -354,11 +344,216 @@ static double calculate_contour_score(const ncnn::Mat& pred_map, const std::vect
     return count > 0 ? sum / count : 0.0;
 }
 
+// Scores one component and fits its text box in original image coordinates.
+// Returns false when the component is rejected.
+static bool fit_text_box(
+    const ncnn::Mat& pred_map, const std::vector<IntPoint>& contour, float scale, int wpad, int hpad, Object& obj)
+{
+    const float box_thresh = 0.6f;
+    const float enlarge_ratio = 1.95f;
+    const float min_size = 3 * scale;
+
+    // Score
+    double score = calculate_contour_score(pred_map, contour, pred_map.w, pred_map.h);
+    score /= 255.0; // Normalize to [0, 1]
+
+    if (score < box_thresh) return false;
+
+    // Min Area Rect
+    RotatedRect rrect;
+    get_min_area_rect(contour, rrect);
+
+    float rrect_maxwh = std::max(rrect.size.width, rrect.size.height);
+    if (rrect_maxwh < min_size) return false;
+
+    // Logic from original ppocrv5.cpp for orientation
+    int orientation = 0;
+    // rrect.angle is from PCA, which might be different from cv::minAreaRect.
+    // Assuming get_min_area_rect provides angle in -90..90 or 0..180
+    // We will stick to the logic from ppocrv5.cpp assuming similar angle
+    // conventions. If our angle is purely direction of first eigenvector, it
+    // might need adjustment.
+
+    if (rrect.angle >= -30 && rrect.angle <= 30 && rrect.size.height > rrect.size.width * 2.7) {
+        orientation = 1;
+    }
+    if ((rrect.angle <= -60 || rrect.angle >= 60) && rrect.size.width > rrect.size.height * 2.7) {
+        orientation = 1;
+    }
+
+    if (rrect.angle < -30) {
+        rrect.angle += 180;
+    }
+
+    if (orientation == 0 && rrect.angle < 30) {
+        rrect.angle += 90;
+        std::swap(rrect.size.width, rrect.size.height);
+    }
+
+    if (orientation == 1 && rrect.angle >= 60) {
+        rrect.angle -= 90;
+        std::swap(rrect.size.width, rrect.size.height);
+    }
+
+    // Enlarge
+    rrect.size.height += rrect.size.width * (enlarge_ratio - 1);
+    rrect.size.width *= enlarge_ratio;
+
+    // Remap to original image
+    rrect.center.x = (rrect.center.x - (wpad / 2.0f)) / scale;
+    rrect.center.y = (rrect.center.y - (hpad / 2.0f)) / scale;
+    rrect.size.width = rrect.size.width / scale;
+    rrect.size.height = rrect.size.height / scale;
+
+    // Validation: Check for degenerate boxes (extremely thin or small) that cause memory issues
+    if (rrect.size.width < 1.0f || rrect.size.height < 1.0f) {
+        LOG_WARN("Ignoring degenerate text box: " << rrect.size.width << "x" << rrect.size.height
+                                                  << " at (" << rrect.center.x << "," << rrect.center.y << ")");
+        return false;
+    }
+
+    // Check for extreme aspect ratios that might blow up the warping (e.g. ratio > 1:120)
+    // In crop_and_warp, target_width = rh * 48 / rw. If rw is tiny compared to rh, width explodes.
+    // If orientation=0 (horizontal), text is usually width > height.
+    // If orientation=1 (vertical), text is usually height > width.
+    // The warping logic depends on the specific un-rotated width/height logic in crop_and_warp.
+    // Let's just safeguard against the specific division: ratio of H/W or W/H exceeding a limit.
+    float ratio = rrect.size.height / (rrect.size.width + 1e-6f);
+    if (ratio > 120.0f || ratio < (1.0f / 120.0f)) { // 1:120 or 120:1
+        LOG_WARN("Ignoring extreme aspect ratio text box: " << rrect.size.width << "x" << rrect.size.height
+                                                            << " (Ratio: " << ratio << ")");
+        return false;
+    }
+
+    obj.rrect = rrect;
+    obj.orientation = orientation;
+    obj.prob = score;
+    return true;
+}
+
+std::string decode_text(const std::vector<Character>& text)
+{
+    std::string utf8;
+    for (const auto& ch : text) {
+        if (ch.id < character_dict_size) utf8 += character_dict[ch.id];
+    }
+    return utf8;
+}
+
+static size_t utf8_sequence_length(unsigned char lead)
+{
+    if (lead < 0x80) return 1;
+    if ((lead >> 5) == 0x6) return 2;
+    if ((lead >> 4) == 0xE) return 3;
+    if ((lead >> 3) == 0x1E) return 4;
+    return 1;
+}
+
+bool encode_text(const std::string& utf8, std::vector<int>& ids)
+{
+    static const std::unordered_map<std::string, int> dict_ids = [] {
+        std::unordered_map<std::string, int> m;
+        for (int i = 0; i < character_dict_size; i++) m.emplace(character_dict[i], i);
+        return m;
+    }();
+
+    ids.clear();
+    size_t i = 0;
+    while (i < utf8.size()) {
+        // A few entries (flags) are two code points; try those first
+        const size_t one = std::min(utf8.size() - i, utf8_sequence_length(utf8[i]));
+        size_t two = one;
+        if (i + one < utf8.size()) two += std::min(utf8.size() - i - one, utf8_sequence_length(utf8[i + one]));
+        auto it = two > one ? dict_ids.find(utf8.substr(i, two)) : dict_ids.end();
+        size_t used = two;
+        if (it == dict_ids.end()) {
+            it = dict_ids.find(utf8.substr(i, one));
+            used = one;
+        }
+        if (it == dict_ids.end()) return false;
+        ids.push_back(it->second);
+        i += used;
+    }
+    return true;
+}
+
+// Forwards weight reads to another DataReader and accumulates the time they take
+class TimedDataReader : public ncnn::DataReader {
+public:
+    TimedDataReader(const ncnn::DataReader& dr, double& elapsed_ms)
+        : m_dr(dr)
+        , m_elapsed_ms(elapsed_ms)
+    {
+    }
+
+    size_t read(void* buf, size_t size) const override
+    {
+        STAGE_START(Read);
+        size_t n = m_dr.read(buf, size);
+        m_elapsed_ms += STAGE_ELAPSED(Read);
+        return n;
+    }
+
+    size_t reference(size_t size, const void** buf) const override
+    {
+        STAGE_START(Reference);
+        size_t n = m_dr.reference(size, buf);
+        m_elapsed_ms += STAGE_ELAPSED(Reference);
+        return n;
+    }
+
+private:
+    const ncnn::DataReader& m_dr;
+    double& m_elapsed_ms;
+};
+
+// Loads one net. A param path ending in .bin is read as binary param (ncnn2mem).
+// Time inside load_model that is not spent reading weights goes to weight
+// transforms and create_pipeline.
+static int load_net(ncnn::Net& net, const char* param_path, const char* bin_path, LoadTimings& timings)
+{
+    const size_t len = strlen(param_path);
+    const bool binary_param = len > 4 && strcmp(param_path + len - 4, ".bin") == 0;
+
+    STAGE_START(Param);
+    int ret = binary_param ? net.load_param_bin(param_path) : net.load_param(param_path);
+    timings.param_parse += STAGE_ELAPSED(Param);
+    if (ret != 0) return ret;
+
+    FILE* fp = fopen(bin_path, "rb");
+    if (!fp) return -1;
+    double read_ms = 0.0;
+    STAGE_START(Model);
+    ncnn::DataReaderFromStdio dr(fp);
+    ret = net.load_model(TimedDataReader(dr, read_ms));
+    const double model_ms = STAGE_ELAPSED(Model);
+    fclose(fp);
+
+    timings.weight_read += read_ms;
+    timings.pipeline += model_ms - read_ms;
+    return ret;
+}
+
 // -------------------------------------------------------------------------
 // OCREngine Implementation
 // -------------------------------------------------------------------------
 
-OCREngine::OCREngine() { }
+#ifdef _OPENMP
+// OpenMP's own thread count, read before set_num_threads() first caps it:
+// omp_get_max_threads() returns the cap from then on
+static int omp_default_threads()
+{
+    static const int threads = omp_get_max_threads();
+    return threads;
+}
+#endif
+
+OCREngine::OCREngine()
+{
+#ifdef _OPENMP
+    omp_default_threads();
+#endif
+}
 
 OCREngine::~OCREngine()
 {
@@ -368,17 +563,37 @@ OCREngine::~OCREngine()
 
 void OCREngine::load_model(const char* det_param, const char* det_bin, const char* rec_param, const char* rec_bin)
 {
+    m_load_timings = LoadTimings();
+    reset_sequence(); // results of the previous model must not be reused
+
     ppocrv5_det.opt.use_vulkan_compute = false;
     ppocrv5_det.opt.use_fp16_packed = false;
     ppocrv5_det.opt.use_fp16_storage = false;
-    ppocrv5_det.load_param(det_param);
-    ppocrv5_det.load_model(det_bin);
+    ppocrv5_det.opt.num_threads = thread_budget();
+    if (load_net(ppocrv5_det, det_param, det_bin, m_load_timings) != 0) {
+        LOG_ERROR("Failed to load det model: " << det_param << ", " << det_bin);
+    }
 
     ppocrv5_rec.opt.use_vulkan_compute = false;
     ppocrv5_rec.opt.use_fp16_packed = false;
     ppocrv5_rec.opt.use_fp16_storage = false;
-    ppocrv5_rec.load_param(rec_param);
-    ppocrv5_rec.load_model(rec_bin);
+    ppocrv5_rec.opt.num_threads = thread_budget();
+    if (load_net(ppocrv5_rec, rec_param, rec_bin, m_load_timings) != 0) {
+        LOG_ERROR("Failed to load rec model: " << rec_param << ", " << rec_bin);
+    }
+
+    LOG_DEBUG("[Profile] Load: param " << m_load_timings.param_parse << " ms, weight read "
+                                       << m_load_timings.weight_read << " ms, pipeline " << m_load_timings.pipeline
+                                       << " ms");
+
+    const char* files[4] = { det_param, det_bin, rec_param, rec_bin };
+    for (int i = 0; i < 4; i++) m_model_files[i] = files[i];
+    m_model_fingerprint = 0;
+    // Stored results of the previous model are discarded by the reopen
+    if (m_result_store.is_open()) {
+        const std::string path = m_result_store_path;
+        open_result_store(path.c_str());
+    }
 }
 
 void OCREngine::warmup()
@@ -413,16 +628,162 @@ void OCREngine::set_text_score_threshold(float threshold)
     LOG_INFO("[OCREngine] Text score threshold set to: " << threshold);
 }
 
-void OCREngine::detect_text(const unsigned char* rgba_data, int img_w, int img_h, std::vector<Object>& objects)
+void OCREngine::set_rec_pack_width(int width)
 {
-    PROFILE_START(Det_Preprocess);
-    const int target_size = 960;
+    m_rec_pack_width = std::max(0, width);
+    LOG_INFO("[OCREngine] Rec pack width set to: " << m_rec_pack_width);
+}
+
+void OCREngine::set_rec_chunk_width(int width)
+{
+    m_rec_chunk_width = std::max(0, width);
+    LOG_INFO("[OCREngine] Rec chunk width set to: " << m_rec_chunk_width);
+}
+
+void OCREngine::set_axis_aligned_tolerance(float degrees)
+{
+    m_axis_aligned_tolerance = degrees;
+    LOG_INFO("[OCREngine] Axis-aligned fast path tolerance set to: " << degrees << " deg");
+}
+
+void OCREngine::set_rec_pyramid(bool enabled)
+{
+    m_rec_pyramid = enabled;
+    LOG_INFO("[OCREngine] Rec pyramid sampling " << (enabled ? "enabled" : "disabled"));
+}
+
+void OCREngine::set_postprocess_threads(int num_threads)
+{
+    m_postprocess_threads = std::max(0, num_threads);
+    LOG_INFO("[OCREngine] Postprocess threads set to: " << m_postprocess_threads);
+}
+
+void OCREngine::set_num_threads(int num_threads)
+{
+    m_num_threads = std::max(0, num_threads);
+#ifdef _OPENMP
+    // Stages run one after another, so each may use the whole budget. Capping
+    // the OpenMP default keeps unsized parallel regions inside it as well.
+    omp_set_num_threads(thread_budget());
+#endif
+    ppocrv5_det.opt.num_threads = thread_budget();
+    ppocrv5_rec.opt.num_threads = thread_budget();
+    LOG_INFO("[OCREngine] Thread budget set to: " << thread_budget());
+}
+
+void OCREngine::set_layer_profiling(bool enabled)
+{
+    m_layer_profiling = enabled;
+    LOG_INFO("[OCREngine] Layer profiling " << (enabled ? "enabled" : "disabled"));
+}
+
+std::string OCREngine::layer_profile_json() const
+{
+    return "{\"det\":" + m_det_profile.to_json() + ",\"rec\":" + m_rec_profile.to_json() + "}";
+}
+
+void OCREngine::reset_layer_profile()
+{
+    m_det_profile.reset();
+    m_rec_profile.reset();
+}
+
+int OCREngine::extract_output(const ncnn::Net& net, ncnn::Extractor& ex, LayerProfiler& profiler, ncnn::Mat& out)
+{
+    if (m_layer_profiling) return profiler.extract(net, ex, "out0", out);
+    return ex.extract("out0", out);
+}
+
+int OCREngine::thread_budget() const
+{
+#ifdef _OPENMP
+    return m_num_threads > 0 ? m_num_threads : omp_default_threads();
+#else
+    return 1;
+#endif
+}
+
+double OCREngine::benchmark_det_preprocess(
+    const unsigned char* rgba_data, int width, int height, int num_threads, int iterations) const
+{
+    if (width <= 0 || height <= 0 || !rgba_data || iterations <= 0) return 0.0;
+
+    double total_ms = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        float scale = 1.f;
+        int wpad = 0, hpad = 0;
+        auto start = std::chrono::steady_clock::now();
+        ncnn::Mat in_pad = prepare_det_input(rgba_data, width, height, scale, wpad, hpad, num_threads);
+        total_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return total_ms / iterations;
+}
+
+double OCREngine::benchmark_det_postprocess(
+    const unsigned char* rgba_data, int width, int height, int num_threads, int iterations)
+{
+    if (width <= 0 || height <= 0 || !rgba_data || iterations <= 0) return 0.0;
+
+    float scale = 1.f;
+    int wpad = 0, hpad = 0;
+    ncnn::Mat out = infer_det(rgba_data, width, height, scale, wpad, hpad);
+
+    const int saved_threads = m_postprocess_threads;
+    m_postprocess_threads = num_threads;
+    double total_ms = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        ncnn::Mat pred = out.clone(); // postprocess rescales the map in place
+        std::vector<Object> objects;
+        auto start = std::chrono::steady_clock::now();
+        postprocess_det(pred, scale, wpad, hpad, objects);
+        total_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    m_postprocess_threads = saved_threads;
+    return total_ms / iterations;
+}
+
+void OCREngine::detect_text(
+    const unsigned char* rgba_data, int img_w, int img_h, std::vector<Object>& objects, float det_scale)
+{
+    float scale = 1.f;
+    int wpad = 0, hpad = 0;
+    ncnn::Mat out = infer_det(rgba_data, img_w, img_h, scale, wpad, hpad, det_scale);
+
+    STAGE_START(Det_Postprocess);
+    postprocess_det(out, scale, wpad, hpad, objects);
+    STAGE_END(Det_Postprocess, &m_timings.det_postprocess);
+}
+
+ncnn::Mat OCREngine::infer_det(
+    const unsigned char* rgba_data, int img_w, int img_h, float& scale, int& wpad, int& hpad, float det_scale)
+{
+    STAGE_START(Det_Preprocess);
+    ncnn::Mat in_pad = prepare_det_input(rgba_data, img_w, img_h, scale, wpad, hpad, thread_budget(), det_scale);
+    STAGE_END(Det_Preprocess, &m_timings.det_preprocess);
+
+    STAGE_START(Det_Inference);
+    ncnn::Extractor ex = ppocrv5_det.create_extractor();
+    ex.input("in0", in_pad);
+    ncnn::Mat out;
+    extract_output(ppocrv5_det, ex, m_det_profile, out);
+    STAGE_END(Det_Inference, &m_timings.det_inference);
+    return out;
+}
+
+ncnn::Mat OCREngine::prepare_det_input(const unsigned char* rgba_data, int img_w, int img_h, float& scale, int& wpad,
+    int& hpad, int num_threads, float det_scale) const
+{
+    const int target_size = DET_TARGET_SIZE;
     const int target_stride = 32;
 
     int w = img_w;
     int h = img_h;
-    float scale = 1.f;
-    if (std::max(w, h) > target_size) {
+    scale = 1.f;
+    if (det_scale > 0.f && det_scale < 1.f) {
+        scale = det_scale;
+        w = std::max(1, (int)(img_w * scale));
+        h = std::max(1, (int)(img_h * scale));
+    } else if (det_scale <= 0.f && std::max(w, h) > target_size) {
         if (w > h) {
             scale = (float)target_size / w;
             w = target_size;
@@ -434,48 +795,46 @@ void OCREngine::detect_text(const unsigned char* rgba_data, int img_w, int img_h
         }
     }
 
-    // Convert RGBA to BGR and resize in one step (like reference implementation)
-    ncnn::Mat in = ncnn::Mat::from_pixels_resize(rgba_data, ncnn::Mat::PIXEL_RGBA2BGR, img_w, img_h, w, h);
+    wpad = (w + target_stride - 1) / target_stride * target_stride - w;
+    hpad = (h + target_stride - 1) / target_stride * target_stride - h;
 
-    int wpad = (w + target_stride - 1) / target_stride * target_stride - w;
-    int hpad = (h + target_stride - 1) / target_stride * target_stride - h;
-    ncnn::Mat in_pad;
-    ncnn::copy_make_border(
-        in, in_pad, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, ncnn::BORDER_CONSTANT, 114.f);
-
-    const float mean_vals[3] = { 0.485f * 255.f, 0.456f * 255.f, 0.406f * 255.f };
-    const float norm_vals[3] = { 1 / 0.229f / 255.f, 1 / 0.224f / 255.f, 1 / 0.225f / 255.f };
-    in_pad.substract_mean_normalize(mean_vals, norm_vals);
-    PROFILE_END(Det_Preprocess);
-
-    PROFILE_START(Det_Inference);
-    ncnn::Extractor ex = ppocrv5_det.create_extractor();
-    ex.input("in0", in_pad);
-    ncnn::Mat out;
-    ex.extract("out0", out);
-    PROFILE_END(Det_Inference);
+    // Resize, BGR conversion, padding and normalization are written into the
+    // final planar input in a single pass. The net's first convolution takes 3
+    // input channels, which ncnn keeps at elempack=1 on every build variant, so
+    // this is already the layout it consumes and no repack happens inside the net.
+    ncnn::Mat in_pad(w + wpad, h + hpad, 3);
+    float border_vals[3];
+    for (int c = 0; c < 3; c++) {
+        border_vals[c] = (114.f - DET_MEAN_VALS[c]) * DET_NORM_VALS[c];
+    }
+    fill_border(in_pad, wpad / 2, hpad / 2, w, h, border_vals);
+    if (w != img_w || h != img_h) {
+        resize_rgba_to_bgr_normalize(rgba_data, img_w, img_h, in_pad, wpad / 2, hpad / 2, w, h, DET_MEAN_VALS,
+            DET_NORM_VALS, num_threads);
+    } else {
+        rgba_to_bgr_normalize(
+            rgba_data, w, h, w * 4, in_pad, wpad / 2, hpad / 2, DET_MEAN_VALS, DET_NORM_VALS, num_threads);
+    }
+    return in_pad;
+}
 
-    PROFILE_START(Det_Postprocess);
+void OCREngine::postprocess_det(ncnn::Mat& out, float scale, int wpad, int hpad, std::vector<Object>& objects) const
+{
     // CRITICAL: Denormalize output from [0,1] to [0,255]
     // PP-OCR detection model outputs probability map in range [0,1]
     // We need to scale it to [0,255] for proper thresholding
     const float denorm_vals[1] = { 255.f };
     out.substract_mean_normalize(0, denorm_vals);
 
-    // Threshold to binary
     int out_w = out.w;
     int out_h = out.h;
 
     LOG_DEBUG("Detection map size: " << out_w << "x" << out_h);
 
-    // Connected Component Analysis (BFS)
-    // Create visited map
-    std::vector<bool> visited(out_w * out_h, false);
-    std::vector<std::vector<IntPoint>> contours;
-
     const float threshold = 0.3f * 255.f; // Scale threshold to match [0,255] range
     const float* pred_data = out.row(0); // Assuming channel 0
 
+#ifdef DEBUG
     // Debug: Check probability map statistics
     float max_prob = 0.0f;
     int above_threshold = 0;
@@ -484,168 +843,54 @@ void OCREngine::detect_text(const unsigned char* rgba_data, int img_w, int img_h
         if (pred_data[i] > threshold) above_threshold++;
     }
     LOG_DEBUG("Max probability: " << max_prob << ", Pixels above threshold: " << above_threshold);
+#endif
 
-    for (int y = 0; y < out_h; y++) {
-        for (int x = 0; x < out_w; x++) {
-            int idx = y * out_w + x;
-            if (pred_data[idx] > threshold && !visited[idx]) {
-                // New component
-                std::vector<IntPoint> contour;
-                std::queue<int> q;
-                q.push(idx);
-                visited[idx] = true;
-
-                while (!q.empty()) {
-                    int curr = q.front();
-                    q.pop();
-                    int cy = curr / out_w;
-                    int cx = curr % out_w;
-
-                    contour.push_back({ cx, cy });
-
-                    // 4-neighbors
-                    int nbs[4] = { curr - 1, curr + 1, curr - out_w, curr + out_w };
-                    // Check bounds & valid
-                    if (cx > 0) {
-                        if (pred_data[curr - 1] > threshold && !visited[curr - 1]) {
-                            visited[curr - 1] = true;
-                            q.push(curr - 1);
-                        }
-                    }
-                    if (cx < out_w - 1) {
-                        if (pred_data[curr + 1] > threshold && !visited[curr + 1]) {
-                            visited[curr + 1] = true;
-                            q.push(curr + 1);
-                        }
-                    }
-                    if (cy > 0) {
-                        if (pred_data[curr - out_w] > threshold && !visited[curr - out_w]) {
-                            visited[curr - out_w] = true;
-                            q.push(curr - out_w);
-                        }
-                    }
-                    if (cy < out_h - 1) {
-                        if (pred_data[curr + out_w] > threshold && !visited[curr + out_w]) {
-                            visited[curr + out_w] = true;
-                            q.push(curr + out_w);
-                        }
-                    }
-                }
-
-                if (contour.size() > 5) { // Filter tiny noise
-                    contours.push_back(contour);
-                }
-            }
-        }
+    const int num_threads
+        = m_postprocess_threads > 0 ? std::min(m_postprocess_threads, thread_budget()) : thread_budget();
+    std::vector<std::vector<IntPoint>> contours;
+    label_components(pred_data, out_w, out_h, threshold, num_threads, contours);
+
+    // Process Contours (scoring and box fitting are independent per component)
+    std::vector<Object> candidates(contours.size());
+    std::vector<unsigned char> accepted(contours.size(), 0);
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+    for (int i = 0; i < (int)contours.size(); i++) {
+        trace::Scope box_scope("Det_Box", i);
+        accepted[i] = fit_text_box(out, contours[i], scale, wpad, hpad, candidates[i]) ? 1 : 0;
     }
-
-    // Process Contours
-    const float box_thresh = 0.6f;
-    const float enlarge_ratio = 1.95f;
-    const float min_size = 3 * scale;
-
-    for (const auto& contour : contours) {
-        // Score
-        double score = calculate_contour_score(out, contour, out_w, out_h);
-        score /= 255.0; // Normalize to [0, 1]
-
-        if (score < box_thresh) continue;
-
-        // Min Area Rect
-        RotatedRect rrect;
-        get_min_area_rect(contour, rrect);
-
-        float rrect_maxwh = std::max(rrect.size.width, rrect.size.height);
-        if (rrect_maxwh < min_size) continue;
-
-        // Logic from original ppocrv5.cpp for orientation
-        int orientation = 0;
-        // rrect.angle is from PCA, which might be different from cv::minAreaRect.
-        // Assuming get_min_area_rect provides angle in -90..90 or 0..180
-        // We will stick to the logic from ppocrv5.cpp assuming similar angle
-        // conventions. If our angle is purely direction of first eigenvector, it
-        // might need adjustment.
-
-        if (rrect.angle >= -30 && rrect.angle <= 30 && rrect.size.height > rrect.size.width * 2.7) {
-            orientation = 1;
-        }
-        if ((rrect.angle <= -60 || rrect.angle >= 60) && rrect.size.width > rrect.size.height * 2.7) {
-            orientation = 1;
-        }
-
-        if (rrect.angle < -30) {
-            rrect.angle += 180;
-        }
-
-        if (orientation == 0 && rrect.angle < 30) {
-            rrect.angle += 90;
-            std::swap(rrect.size.width, rrect.size.height);
-        }
-
-        if (orientation == 1 && rrect.angle >= 60) {
-            rrect.angle -= 90;
-            std::swap(rrect.size.width, rrect.size.height);
-        }
-
-        // Enlarge
-        rrect.size.height += rrect.size.width * (enlarge_ratio - 1);
-        rrect.size.width *= enlarge_ratio;
-
-        // Remap to original image
-        rrect.center.x = (rrect.center.x - (wpad / 2.0f)) / scale;
-        rrect.center.y = (rrect.center.y - (hpad / 2.0f)) / scale;
-        rrect.size.width = rrect.size.width / scale;
-        rrect.size.height = rrect.size.height / scale;
-
-        // Validation: Check for degenerate boxes (extremely thin or small) that cause memory issues
-        if (rrect.size.width < 1.0f || rrect.size.height < 1.0f) {
-            LOG_WARN("Ignoring degenerate text box: " << rrect.size.width << "x" << rrect.size.height
-                                                      << " at (" << rrect.center.x << "," << rrect.center.y << ")");
-            continue;
-        }
-
-        // Check for extreme aspect ratios that might blow up the warping (e.g. ratio > 1:120)
-        // In crop_and_warp, target_width = rh * 48 / rw. If rw is tiny compared to rh, width explodes.
-        // If orientation=0 (horizontal), text is usually width > height.
-        // If orientation=1 (vertical), text is usually height > width.
-        // The warping logic depends on the specific un-rotated width/height logic in crop_and_warp.
-        // Let's just safeguard against the specific division: ratio of H/W or W/H exceeding a limit.
-        float ratio = rrect.size.height / (rrect.size.width + 1e-6f);
-        if (ratio > 120.0f || ratio < (1.0f / 120.0f)) { // 1:120 or 120:1
-            LOG_WARN("Ignoring extreme aspect ratio text box: " << rrect.size.width << "x" << rrect.size.height
-                                                                << " (Ratio: " << ratio << ")");
-            continue;
-        }
-
-        Object obj;
-        obj.rrect = rrect;
-        obj.orientation = orientation;
-        obj.prob = score;
-        objects.push_back(obj);
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (accepted[i]) objects.push_back(candidates[i]);
     }
-    PROFILE_END(Det_Postprocess);
 }
 
-ncnn::Mat OCREngine::crop_and_warp_roi(const unsigned char* rgba_data, int img_w, int img_h, const Object& object)
+// Width of the 48px-high rec input for a box, before any warping happens
+static int get_rec_input_width(const RotatedRect& rrect, int max_width = 2048)
 {
-    const int orientation = object.orientation;
-    float rw = object.rrect.size.width;
-    float rh = object.rrect.size.height;
+    float rw = rrect.size.width;
+    float rh = rrect.size.height;
 
     // Safety: Prevent division by zero or extremely thin boxes
     if (rw < 1.0f) rw = 1.0f;
     if (rh < 1.0f) rh = 1.0f;
 
-    const int target_height = 48;
     // Safety check for extreme aspect ratios
-    float target_width = rh * target_height / rw;
+    float target_width = rh * REC_INPUT_HEIGHT / rw;
 
     // Cap max width to prevent memory explosion/OOB on weird artifacts
-    const float max_target_width = 2048.0f;
+    const float max_target_width = (float)max_width;
     if (target_width > max_target_width) target_width = max_target_width;
 
     int final_w_int = (int)target_width;
     if (final_w_int < 16) final_w_int = 16;
+    return final_w_int;
+}
+
+ncnn::Mat OCREngine::crop_and_warp_roi(
+    const unsigned char* rgba_data, int img_w, int img_h, const Object& object, int max_width, RecStats* stats)
+{
+    const int orientation = object.orientation;
+    const int target_height = REC_INPUT_HEIGHT;
+    const int final_w_int = get_rec_input_width(object.rrect, max_width);
 
     // Get corners
     Point corners[4];
@@ -660,6 +905,52 @@ ncnn::Mat OCREngine::crop_and_warp_roi(const unsigned char* rgba_data, int img_w
         if (corners[i].y > max_y) max_y = corners[i].y;
     }
 
+    // Source points in image coordinates
+    Point src_pts[3];
+    if (orientation == 0) {
+        src_pts[0] = corners[3]; // TL
+        src_pts[1] = corners[0]; // TR
+        src_pts[2] = corners[2]; // BL
+    } else {
+        src_pts[0] = corners[1]; // TR
+        src_pts[1] = corners[2]; // BR
+        src_pts[2] = corners[0]; // TL
+    }
+
+    Point dst_pts[3];
+    dst_pts[0] = { 0, 0 };
+    dst_pts[1] = { (float)final_w_int, 0 };
+    dst_pts[2] = { 0, (float)target_height };
+
+    PROFILE_START(Rec_Warp);
+    Matrix2x3 M = get_affine_transform(src_pts, dst_pts);
+
+    // Fast path: an (almost) unrotated box maps to the rec input by scale and
+    // translation only, so the source rectangle can be resized straight from the
+    // RGBA buffer without cropping, float conversion or an affine warp. With the
+    // pyramid on, tall boxes are area-averaged instead of sampled with 2 taps.
+    float angle_dev = std::fmod(std::abs(object.rrect.angle), 90.0f);
+    angle_dev = std::min(angle_dev, 90.0f - angle_dev);
+    if (angle_dev <= m_axis_aligned_tolerance && M.m[0] > 0 && M.m[4] > 0) {
+        int x0 = (int)std::lround(-M.m[2] / M.m[0]);
+        int x1 = (int)std::lround((final_w_int - M.m[2]) / M.m[0]);
+        int y0 = (int)std::lround(-M.m[5] / M.m[4]);
+        int y1 = (int)std::lround((target_height - M.m[5]) / M.m[4]);
+
+        // Boxes reaching past the image border keep the clamping behaviour of the affine path
+        if (x0 >= 0 && y0 >= 0 && x1 <= img_w && y1 <= img_h && x1 > x0 && y1 > y0) {
+            std::vector<unsigned char> resized_rgba(final_w_int * target_height * 4);
+            resize_region_rgba(rgba_data, img_w, x0, y0, x1 - x0, y1 - y0, resized_rgba.data(), final_w_int,
+                target_height, m_rec_pyramid);
+            ncnn::Mat roi_planar(final_w_int, target_height, 3);
+            rgba_to_bgr_normalize(resized_rgba.data(), final_w_int, target_height, final_w_int * 4, roi_planar, 0, 0,
+                REC_MEAN_VALS, REC_NORM_VALS, thread_budget());
+            if (stats) stats->warp_axis_aligned++;
+            PROFILE_END_ACCUM(Rec_Warp, (stats ? &stats->warp_axis_aligned_time : nullptr));
+            return roi_planar;
+        }
+    }
+
     // Add margin and clamp
     const int margin = 10;
     int crop_x = std::max(0, (int)min_x - margin);
@@ -667,100 +958,232 @@ ncnn::Mat OCREngine::crop_and_warp_roi(const unsigned char* rgba_data, int img_w
     int crop_w = std::min(img_w - crop_x, (int)(max_x - min_x) + 2 * margin);
     int crop_h = std::min(img_h - crop_y, (int)(max_y - min_y) + 2 * margin);
 
-    // Manual crop: copy cropped RGBA region
-    std::vector<unsigned char> cropped_rgba(crop_w * crop_h * 4);
-    for (int y = 0; y < crop_h; y++) {
-        const unsigned char* src_row = rgba_data + ((crop_y + y) * img_w + crop_x) * 4;
-        unsigned char* dst_row = cropped_rgba.data() + y * crop_w * 4;
-        memcpy(dst_row, src_row, crop_w * 4);
+    // Pick a pyramid level so that the final warp samples the source close to 1:1.
+    // Source pixels per output pixel is 1/sqrt(|det|) of the linear part of M.
+    int level = 1;
+    if (m_rec_pyramid) {
+        double src_per_dst = 1.0 / std::sqrt(std::abs(M.m[0] * M.m[4] - M.m[1] * M.m[3]) + 1e-12);
+        while (level < 4 && level * 2 <= src_per_dst && crop_w / (level * 2) >= 2 && crop_h / (level * 2) >= 2) {
+            level *= 2;
+        }
     }
 
-    // Convert cropped region to BGR
-    ncnn::Mat bgr_crop = ncnn::Mat::from_pixels(cropped_rgba.data(), ncnn::Mat::PIXEL_RGBA2BGR, crop_w, crop_h);
-
-    // Adjust corners to cropped coordinate system
-    Point src_pts[3];
-    if (orientation == 0) {
-        src_pts[0] = { corners[3].x - crop_x, corners[3].y - crop_y }; // TL
-        src_pts[1] = { corners[0].x - crop_x, corners[0].y - crop_y }; // TR
-        src_pts[2] = { corners[2].x - crop_x, corners[2].y - crop_y }; // BL
+    // Manual crop: copy (or box-filter downscale) the cropped RGBA region
+    std::vector<unsigned char> cropped_rgba;
+    if (level > 1) {
+        downscale_box_rgba(rgba_data, img_w, crop_x, crop_y, crop_w, crop_h, level, cropped_rgba);
     } else {
-        src_pts[0] = { corners[1].x - crop_x, corners[1].y - crop_y }; // TR
-        src_pts[1] = { corners[2].x - crop_x, corners[2].y - crop_y }; // BR
-        src_pts[2] = { corners[0].x - crop_x, corners[0].y - crop_y }; // TL
+        cropped_rgba.resize(crop_w * crop_h * 4);
+        for (int y = 0; y < crop_h; y++) {
+            const unsigned char* src_row = rgba_data + ((crop_y + y) * img_w + crop_x) * 4;
+            unsigned char* dst_row = cropped_rgba.data() + y * crop_w * 4;
+            memcpy(dst_row, src_row, crop_w * 4);
+        }
     }
 
-    Point dst_pts[3];
-    dst_pts[0] = { 0, 0 };
-    dst_pts[1] = { (float)final_w_int, 0 };
-    dst_pts[2] = { 0, (float)target_height };
-
-    Matrix2x3 M = get_affine_transform(src_pts, dst_pts);
+    // Convert cropped region to BGR
+    ncnn::Mat bgr_crop = ncnn::Mat::from_pixels(
+        cropped_rgba.data(), ncnn::Mat::PIXEL_RGBA2BGR, crop_w / level, crop_h / level);
+
+    // Shift the transform into the cropped coordinate system. Pixel q of a level-f
+    // image is centred on source pixel crop + f * q + (f - 1) / 2.
+    const float offset_x = crop_x + (level - 1) * 0.5f;
+    const float offset_y = crop_y + (level - 1) * 0.5f;
+    M.m[2] += M.m[0] * offset_x + M.m[1] * offset_y;
+    M.m[5] += M.m[3] * offset_x + M.m[4] * offset_y;
+    M.m[0] *= level;
+    M.m[1] *= level;
+    M.m[3] *= level;
+    M.m[4] *= level;
 
     ncnn::Mat roi_planar;
-    warp_affine_bilinear(bgr_crop, roi_planar, M, final_w_int, target_height);
+    warp_affine_bilinear(
+        bgr_crop, roi_planar, M, final_w_int, target_height, REC_MEAN_VALS, REC_NORM_VALS, thread_budget());
+    if (stats) stats->warp_affine++;
+    PROFILE_END_ACCUM(Rec_Warp, (stats ? &stats->warp_affine_time : nullptr));
 
     return roi_planar;
 }
 
 void OCREngine::recognize_text(const unsigned char* rgba_data, int img_w, int img_h, Object& object, RecStats* stats)
 {
-    PROFILE_START(Rec_Preprocess);
-    // Crop and warp ROI
-    ncnn::Mat roi_planar = crop_and_warp_roi(rgba_data, img_w, img_h, object);
+    STAGE_START(Rec_Preprocess);
+    // Crop and warp ROI (already normalized)
+    ncnn::Mat roi_planar = crop_and_warp_roi(rgba_data, img_w, img_h, object, 2048, stats);
+    STAGE_END(Rec_Preprocess, stats ? &stats->preprocess : nullptr);
 
-    // Normalization
-    const float mean_vals[3] = { 127.5f, 127.5f, 127.5f };
-    const float norm_vals[3] = { 1.0f / 127.5f, 1.0f / 127.5f, 1.0f / 127.5f };
-    roi_planar.substract_mean_normalize(mean_vals, norm_vals);
-    PROFILE_END_ACCUM(Rec_Preprocess, (stats ? &stats->preprocess : nullptr));
-
-    PROFILE_START(Rec_Inference);
+    STAGE_START(Rec_Inference);
     ncnn::Extractor ex = ppocrv5_rec.create_extractor();
     ex.input("in0", roi_planar);
     ncnn::Mat out;
-    ex.extract("out0", out);
-    PROFILE_END_ACCUM(Rec_Inference, (stats ? &stats->inference : nullptr));
+    extract_output(ppocrv5_rec, ex, m_rec_profile, out);
+    STAGE_END(Rec_Inference, stats ? &stats->inference : nullptr);
 
-    PROFILE_START(Rec_Decode);
+    STAGE_START(Rec_Decode);
     // Decode (CTC Greedy) with Merge
-    int last_token = 0;
-    for (int i = 0; i < out.h; i++) {
-        const float* p = out.row(i);
-        int index = 0;
-        float max_score = -9999.f;
-        for (int j = 0; j < out.w; j++) {
-            float score = *p++;
-            if (score > max_score) {
-                max_score = score;
-                index = j;
+    decode_ctc(out, 0, out.h, object.text);
+    STAGE_END(Rec_Decode, stats ? &stats->decode : nullptr);
+}
+
+void OCREngine::recognize_chunked(const unsigned char* rgba_data, int img_w, int img_h, Object& object, RecStats* stats)
+{
+    // Warp the line once at its natural width, then recognize overlapping
+    // windows of it independently. Each window contributes the timesteps up to
+    // the middle of its overlap with the next one.
+    const int stride = 8;
+    const int window = std::max(m_rec_chunk_width / stride * stride, 4 * stride);
+    const int overlap = std::max(window / 4 / stride * stride, stride);
+
+    STAGE_START(Rec_Preprocess);
+    ncnn::Mat line = crop_and_warp_roi(rgba_data, img_w, img_h, object, REC_MAX_CHUNKED_WIDTH, stats);
+    const int line_w = line.w;
+
+    std::vector<int> starts;
+    for (int x = 0;; x += window - overlap) {
+        if (x + window >= line_w) {
+            // Keep the last window full width by sliding it back onto the previous
+            // one. It ends exactly at the line end, off the stride grid if need
+            // be: aligning its start would leave the last columns unread.
+            starts.push_back(std::max(0, line_w - window));
+            break;
+        }
+        starts.push_back(x);
+    }
+    if (starts.size() > 1 && starts[starts.size() - 1] <= starts[starts.size() - 2]) starts.pop_back();
+
+    const int num_windows = (int)starts.size();
+    std::vector<ncnn::Mat> inputs(num_windows);
+    for (int k = 0; k < num_windows; k++) {
+        int win_w = std::min(window, line_w - starts[k]);
+        inputs[k].create(win_w, REC_INPUT_HEIGHT, 3);
+        for (int c = 0; c < 3; c++) {
+            for (int y = 0; y < REC_INPUT_HEIGHT; y++) {
+                memcpy(inputs[k].channel(c).row(y), line.channel(c).row(y) + starts[k], win_w * sizeof(float));
             }
         }
+    }
+    STAGE_END(Rec_Preprocess, stats ? &stats->preprocess : nullptr);
+
+    STAGE_START(Rec_Inference);
+    // Windows run side by side and split the thread budget between their
+    // extractors, so the nested ncnn teams never exceed it. Layer profiling
+    // accumulates into one profiler and runs the windows one at a time.
+    std::vector<ncnn::Mat> outputs(num_windows);
+    const int window_threads = m_layer_profiling ? 1 : std::max(1, std::min(num_windows, thread_budget()));
+    const int threads_per_window = std::max(1, thread_budget() / window_threads);
+#pragma omp parallel for schedule(dynamic) num_threads(window_threads)
+    for (int k = 0; k < num_windows; k++) {
+        trace::Scope window_scope("Rec_Window", k);
+        ncnn::Extractor ex = ppocrv5_rec.create_extractor();
+        ex.set_num_threads(threads_per_window);
+        ex.input("in0", inputs[k]);
+        extract_output(ppocrv5_rec, ex, m_rec_profile, outputs[k]);
+    }
+    STAGE_END(Rec_Inference, stats ? &stats->inference : nullptr);
 
-        if (last_token == index) continue; // CTC Merge
-        last_token = index;
-
-        if (index <= 0) continue; // Blank token
+    STAGE_START(Rec_Decode);
+    int last_token = 0;
+    int cut_begin = 0; // in line coordinates
+    for (int k = 0; k < num_windows; k++) {
+        const ncnn::Mat& out = outputs[k];
+        const int win_w = inputs[k].w;
+        int cut_end = line_w;
+        if (k + 1 < num_windows) {
+            cut_end = (starts[k + 1] + starts[k] + win_w) / 2;
+        }
 
-        Character ch;
-        ch.id = index - 1;
-        ch.prob = max_score;
-        object.text.push_back(ch);
+        int t_begin = (int)((long long)(cut_begin - starts[k]) * out.h / win_w);
+        int t_end = (int)((long long)(cut_end - starts[k]) * out.h / win_w);
+        t_begin = std::max(0, std::min(t_begin, out.h));
+        t_end = std::max(t_begin, std::min(t_end, out.h));
+        decode_ctc(out, t_begin, t_end, object.text, &last_token);
+        cut_begin = cut_end;
     }
-    PROFILE_END_ACCUM(Rec_Decode, (stats ? &stats->decode : nullptr));
+    STAGE_END(Rec_Decode, stats ? &stats->decode : nullptr);
+
+    LOG_DEBUG("Recognized " << line_w << "px line in " << num_windows << " windows");
 }
 
-std::string OCREngine::detect(unsigned char* rgba_data, int width, int height)
+void OCREngine::recognize_packed(const unsigned char* rgba_data, int img_w, int img_h, std::vector<Object>& objects,
+    const std::vector<size_t>& indices, RecStats* stats)
 {
-    PROFILE_START(Total_Pipeline);
-    if (width <= 0 || height <= 0 || !rgba_data) return "{}";
+    // Short boxes are laid side by side in one wide input, separated by gutters.
+    // Offsets are aligned to the rec net's horizontal stride so every box starts
+    // on a timestep boundary, and the gutter spans two timesteps so CTC can emit
+    // a blank between neighbours.
+    const int stride = 8;
+    const int gutter = 2 * stride;
+
+    size_t begin = 0;
+    while (begin < indices.size() && !cancelled()) {
+        trace::Scope pack_scope("Rec_Pack", (int)indices[begin]);
+        STAGE_START(Rec_Preprocess);
+        // Greedily take boxes until the next one would overflow the canvas
+        std::vector<int> offsets;
+        std::vector<int> widths;
+        int canvas_w = 0;
+        size_t end = begin;
+        for (; end < indices.size(); end++) {
+            int w = get_rec_input_width(objects[indices[end]].rrect);
+            int x = offsets.empty() ? 0 : (canvas_w + gutter + stride - 1) / stride * stride;
+            if (!offsets.empty() && x + w > m_rec_pack_width) break;
+            offsets.push_back(x);
+            widths.push_back(w);
+            canvas_w = x + w;
+        }
 
-    LOG_DEBUG("Input: " << width << "x" << height << " RGBA");
+        ncnn::Mat canvas(canvas_w, REC_INPUT_HEIGHT, 3);
+        for (size_t k = 0; k < offsets.size(); k++) {
+            ncnn::Mat roi = crop_and_warp_roi(rgba_data, img_w, img_h, objects[indices[begin + k]], 2048, stats);
+            for (int c = 0; c < 3; c++) {
+                for (int y = 0; y < REC_INPUT_HEIGHT; y++) {
+                    memcpy(canvas.channel(c).row(y) + offsets[k], roi.channel(c).row(y), widths[k] * sizeof(float));
+                }
+            }
+        }
 
-    std::vector<Object> objects;
-    detect_text(rgba_data, width, height, objects);
-    LOG_DEBUG("Detection found " << objects.size() << " text regions");
+        // Fill gutters by replicating the edge columns of the neighbouring crops,
+        // which keeps them looking like background rather than a vertical stroke
+        for (size_t k = 0; k + 1 < offsets.size(); k++) {
+            int gap_begin = offsets[k] + widths[k];
+            int gap_end = offsets[k + 1];
+            int gap_mid = (gap_begin + gap_end) / 2;
+            for (int c = 0; c < 3; c++) {
+                for (int y = 0; y < REC_INPUT_HEIGHT; y++) {
+                    float* row = canvas.channel(c).row(y);
+                    for (int x = gap_begin; x < gap_mid; x++) row[x] = row[gap_begin - 1];
+                    for (int x = gap_mid; x < gap_end; x++) row[x] = row[gap_end];
+                }
+            }
+        }
+
+        STAGE_END(Rec_Preprocess, stats ? &stats->preprocess : nullptr);
+
+        STAGE_START(Rec_Inference);
+        ncnn::Extractor ex = ppocrv5_rec.create_extractor();
+        ex.input("in0", canvas);
+        ncnn::Mat out;
+        extract_output(ppocrv5_rec, ex, m_rec_profile, out);
+        STAGE_END(Rec_Inference, stats ? &stats->inference : nullptr);
+
+        STAGE_START(Rec_Decode);
+        // Split the timesteps back per box using the known pixel offsets
+        const int steps = out.h;
+        for (size_t k = 0; k < offsets.size(); k++) {
+            int t_begin = (int)((long long)offsets[k] * steps / canvas_w);
+            int t_end = (int)(((long long)(offsets[k] + widths[k]) * steps + canvas_w - 1) / canvas_w);
+            t_end = std::min(t_end, steps);
+            decode_ctc(out, t_begin, t_end, objects[indices[begin + k]].text);
+        }
+        STAGE_END(Rec_Decode, stats ? &stats->decode : nullptr);
 
+        LOG_DEBUG("Packed " << offsets.size() << " boxes into one " << canvas_w << "px rec input");
+        begin = end;
+    }
+}
+
+void OCREngine::recognize_objects(const unsigned char* rgba_data, int width, int height, std::vector<Object>& objects)
+{
     // Recognize each text box (no full-image BGR allocation)
     // NCNN's light mode (enabled by default) automatically recycles intermediate
     // blobs
@@ -768,9 +1191,30 @@ std::string OCREngine::detect(unsigned char* rgba_data, int width, int height)
 
     RecStats rec_stats; // Accumulator for recognition steps
 
-    for (size_t i = 0; i < objects.size(); i++) {
+    // Boxes narrow enough to share a rec input are collected for packing
+    std::vector<size_t> packed_indices;
+    for (size_t i = 0; i < objects.size() && !cancelled(); i++) {
+        if (m_rec_pack_width > 0 && get_rec_input_width(objects[i].rrect) * 2 <= m_rec_pack_width) {
+            packed_indices.push_back(i);
+            continue;
+        }
+        trace::Scope box_scope("Rec_Box", (int)i);
+        if (m_rec_chunk_width > 0
+            && get_rec_input_width(objects[i].rrect, REC_MAX_CHUNKED_WIDTH) > m_rec_chunk_width) {
+            recognize_chunked(rgba_data, width, height, objects[i], &rec_stats);
+            continue;
+        }
         recognize_text(rgba_data, width, height, objects[i], &rec_stats);
+    }
+    m_stats.boxes_per_image.record((double)objects.size());
+    for (const Object& obj : objects) {
+        m_stats.rec_width.record(get_rec_input_width(obj.rrect, REC_MAX_CHUNKED_WIDTH));
+    }
+    if (!packed_indices.empty()) {
+        recognize_packed(rgba_data, width, height, objects, packed_indices, &rec_stats);
+    }
 
+    for (size_t i = 0; i < objects.size(); i++) {
         // Calculate average text confidence
         float sum_prob = 0.f;
         int count = 0;
@@ -786,10 +1230,44 @@ std::string OCREngine::detect(unsigned char* rgba_data, int width, int height)
     }
     PROFILE_END(Rec_Loop_Total);
 
+    m_timings.rec_preprocess += rec_stats.preprocess;
+    m_timings.rec_inference += rec_stats.inference;
+    m_timings.rec_decode += rec_stats.decode;
+    m_timings.boxes += (int)objects.size();
+
     LOG_DEBUG("[Profile] Rec_Preprocess (Total): " << rec_stats.preprocess << " ms");
     LOG_DEBUG("[Profile] Rec_Inference  (Total): " << rec_stats.inference << " ms");
     LOG_DEBUG("[Profile] Rec_Decode     (Total): " << rec_stats.decode << " ms");
+#ifdef DEBUG
+    if (rec_stats.warp_axis_aligned > 0 && rec_stats.warp_affine > 0) {
+        double fast_per_box = rec_stats.warp_axis_aligned_time / rec_stats.warp_axis_aligned;
+        double affine_per_box = rec_stats.warp_affine_time / rec_stats.warp_affine;
+        LOG_DEBUG("[Profile] Rec_Warp per box: axis-aligned " << fast_per_box << " ms (" << rec_stats.warp_axis_aligned
+                                                              << " boxes), affine " << affine_per_box << " ms ("
+                                                              << rec_stats.warp_affine << " boxes), speedup "
+                                                              << affine_per_box / (fast_per_box + 1e-9) << "x");
+    }
+#endif
+}
+
+void OCREngine::apply_layout(std::vector<Object>& objects)
+{
+    STAGE_START(Layout);
+    // Drop low-confidence boxes first so they cannot bridge lines or paragraphs
+    objects.erase(std::remove_if(objects.begin(), objects.end(),
+                      [&](const Object& obj) { return obj.prob < m_text_score_threshold; }),
+        objects.end());
+
+    std::vector<size_t> order = assemble_layout(objects);
+    std::vector<Object> ordered;
+    ordered.reserve(objects.size());
+    for (size_t i : order) ordered.push_back(std::move(objects[i]));
+    objects.swap(ordered);
+    STAGE_END(Layout, &m_timings.layout);
+}
 
+std::string OCREngine::objects_to_json(const std::vector<Object>& objects) const
+{
     // JSON Build
     std::stringstream ss;
     ss << "[";
@@ -812,14 +1290,7 @@ std::string OCREngine::detect(unsigned char* rgba_data, int width, int height)
         ss << "],";
 
         ss << "\"text\":\"";
-        std::string text_str = "";
-        for (const auto& ch : obj.text) {
-            if (ch.id < character_dict_size) {
-                text_str += character_dict[ch.id];
-            }
-        }
-
-        for (char c : text_str) {
+        for (char c : decode_text(obj.text)) {
             if (c == '"')
                 ss << "\\\"";
             else if (c == '\\')
@@ -834,11 +1305,497 @@ std::string OCREngine::detect(unsigned char* rgba_data, int width, int height)
                 ss << c;
         }
         ss << "\",";
-        ss << "\"prob\":" << obj.prob;
+        ss << "\"prob\":" << obj.prob << ",";
+        ss << "\"line\":" << obj.line_id << ",";
+        ss << "\"paragraph\":" << obj.paragraph_id;
         ss << "}";
     }
     ss << "]";
+    return ss.str();
+}
 
-    PROFILE_END(Total_Pipeline);
+std::string OCREngine::detect(unsigned char* rgba_data, int width, int height)
+{
+    if (width <= 0 || height <= 0 || !rgba_data) return "{}";
+    std::vector<Object> objects = detect_objects(rgba_data, width, height);
+    std::string json = objects_to_json(objects);
+
+    // Kept for index_last_result, with the same boxes as the JSON
+    m_last_result.clear();
+    for (Object& obj : objects) {
+        if (obj.prob >= m_text_score_threshold) m_last_result.push_back(std::move(obj));
+    }
+    return json;
+}
+
+std::vector<Object> OCREngine::detect_objects(const unsigned char* rgba_data, int width, int height)
+{
+    m_timings = StageTimings();
+    std::vector<Object> objects;
+    if (width <= 0 || height <= 0 || !rgba_data) return objects;
+
+    STAGE_START(Total_Pipeline);
+    LOG_DEBUG("Input: " << width << "x" << height << " RGBA");
+
+    uint64_t store_key = 0;
+    const bool store_hit = lookup_result(rgba_data, width, height, store_key, objects);
+    if (store_hit) {
+        // The next frame of a sequence diffs against this one
+        if (m_sequence_mode) {
+            m_tile_diff.update(rgba_data, width, height);
+            m_prev_objects = objects;
+            m_have_prev_frame = true;
+        }
+    } else {
+        if (!m_sequence_mode || !detect_changed(rgba_data, width, height, objects)) {
+            detect_text(rgba_data, width, height, objects);
+            LOG_DEBUG("Detection found " << objects.size() << " text regions");
+
+            if (!cancelled()) recognize_objects(rgba_data, width, height, objects);
+        }
+        if (cancelled()) {
+            // Boxes may lack text, so none of this call is kept
+            LOG_INFO("[OCREngine] Detect cancelled");
+            objects.clear();
+            reset_sequence();
+            return objects;
+        }
+        if (m_sequence_mode) {
+            m_prev_objects = objects;
+            m_have_prev_frame = true;
+        }
+        apply_layout(objects);
+        store_result(store_key, objects);
+    }
+
+    m_timings.images = 1;
+    STAGE_END(Total_Pipeline, &m_timings.total);
+    log_timings();
+    record_latency_stats();
+    if (m_capture.is_open()) capture_call(rgba_data, width, height, (int)objects.size(), store_hit);
+    return objects;
+}
+
+// Pixel bounds of a box, clamped to the image
+static PixelRect box_bounds(const RotatedRect& rrect, int width, int height)
+{
+    Point pts[4];
+    rrect.points(pts);
+    float min_x = pts[0].x, max_x = pts[0].x, min_y = pts[0].y, max_y = pts[0].y;
+    for (int k = 1; k < 4; k++) {
+        min_x = std::min(min_x, pts[k].x);
+        max_x = std::max(max_x, pts[k].x);
+        min_y = std::min(min_y, pts[k].y);
+        max_y = std::max(max_y, pts[k].y);
+    }
+    const int x0 = std::max(0, (int)std::floor(min_x));
+    const int y0 = std::max(0, (int)std::floor(min_y));
+    const int x1 = std::min(width, (int)std::ceil(max_x) + 1);
+    const int y1 = std::min(height, (int)std::ceil(max_y) + 1);
+    return { x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0) };
+}
+
+bool OCREngine::detect_changed(const unsigned char* rgba_data, int width, int height, std::vector<Object>& objects)
+{
+    STAGE_START(Frame_Diff);
+    const bool comparable = m_tile_diff.update(rgba_data, width, height) && m_have_prev_frame;
+    m_timings.tiles = m_tile_diff.tiles();
+    m_timings.tiles_changed = m_tile_diff.changed_tiles();
+    if (!comparable) {
+        STAGE_END(Frame_Diff, &m_timings.frame_diff);
+        return false;
+    }
+
+    // A previous box touching a changed region is redone with it, so a line
+    // that runs out of the region is detected whole instead of being cut at the
+    // region edge. Growing a region can reach more boxes, hence the loop.
+    std::vector<PixelRect> regions = m_tile_diff.changed_regions(m_sequence_margin);
+    std::vector<unsigned char> redo(m_prev_objects.size(), 0);
+    bool grown = !regions.empty();
+    while (grown) {
+        grown = false;
+        for (size_t i = 0; i < m_prev_objects.size(); i++) {
+            if (redo[i]) continue;
+            const PixelRect box = box_bounds(m_prev_objects[i].rrect, width, height);
+            for (const PixelRect& r : regions) {
+                if (!box.intersects(r)) continue;
+                regions.push_back(grow_rect(box, m_sequence_margin, width, height));
+                redo[i] = 1;
+                grown = true;
+                break;
+            }
+        }
+        if (grown) merge_rects(regions);
+    }
+
+    size_t area = 0;
+    for (const PixelRect& r : regions) area += (size_t)r.w * r.h;
+    STAGE_END(Frame_Diff, &m_timings.frame_diff);
+    if (area > (size_t)width * height * SEQUENCE_FULL_RUN_AREA) {
+        LOG_DEBUG("Sequence: " << m_timings.tiles_changed << "/" << m_timings.tiles << " tiles changed, running in full");
+        return false;
+    }
+
+    // Regions are detected at the scale a full-frame run would use, so boxes
+    // come out the same wherever the frame changed
+    const float det_scale = std::min(1.f, (float)DET_TARGET_SIZE / std::max(width, height));
+    std::vector<Object> fresh;
+    std::vector<unsigned char> crop;
+    for (const PixelRect& r : regions) {
+        crop.resize((size_t)r.w * r.h * 4);
+        for (int y = 0; y < r.h; y++) {
+            memcpy(crop.data() + (size_t)y * r.w * 4, rgba_data + ((size_t)(r.y + y) * width + r.x) * 4,
+                (size_t)r.w * 4);
+        }
+        std::vector<Object> found;
+        detect_text(crop.data(), r.w, r.h, found, det_scale);
+        for (Object& obj : found) {
+            obj.rrect.center.x += r.x;
+            obj.rrect.center.y += r.y;
+            fresh.push_back(obj);
+        }
+    }
+    if (!fresh.empty()) recognize_objects(rgba_data, width, height, fresh);
+
+    objects.clear();
+    for (size_t i = 0; i < m_prev_objects.size(); i++) {
+        if (!redo[i]) objects.push_back(m_prev_objects[i]);
+    }
+    m_timings.boxes_reused = (int)objects.size();
+    objects.insert(objects.end(), fresh.begin(), fresh.end());
+    LOG_DEBUG("Sequence: " << m_timings.tiles_changed << "/" << m_timings.tiles << " tiles changed, "
+                           << regions.size() << " regions, " << fresh.size() << " boxes recognized, "
+                           << m_timings.boxes_reused << " reused");
+    return true;
+}
+
+void OCREngine::set_sequence_mode(int tile_size, int margin)
+{
+    m_sequence_mode = tile_size > 0;
+    m_sequence_margin = std::max(0, margin);
+    if (m_sequence_mode) m_tile_diff.set_tile_size(tile_size);
+    reset_sequence();
+    if (m_sequence_mode)
+        LOG_INFO("[OCREngine] Sequence mode enabled: " << m_tile_diff.tile_size() << " px tiles, " << m_sequence_margin
+                                                       << " px margin");
+    else
+        LOG_INFO("[OCREngine] Sequence mode disabled");
+}
+
+void OCREngine::reset_sequence()
+{
+    m_tile_diff.reset();
+    m_prev_objects.clear();
+    m_have_prev_frame = false;
+}
+
+void OCREngine::log_timings() const
+{
+    LOG_DEBUG("[Profile] Det_Preprocess: " << m_timings.det_preprocess << " ms");
+    LOG_DEBUG("[Profile] Det_Inference: " << m_timings.det_inference << " ms");
+    LOG_DEBUG("[Profile] Det_Postprocess: " << m_timings.det_postprocess << " ms");
+    LOG_DEBUG("[Profile] Layout: " << m_timings.layout << " ms");
+    if (m_sequence_mode) LOG_DEBUG("[Profile] Frame_Diff: " << m_timings.frame_diff << " ms");
+    LOG_DEBUG("[Profile] Total: " << m_timings.total << " ms for " << m_timings.images << " image(s), "
+                                  << m_timings.boxes << " boxes");
+}
+
+void OCREngine::record_latency_stats()
+{
+    if (m_layer_profiling) return; // layer-by-layer calls are not representative
+    m_stats.det_preprocess.record(m_timings.det_preprocess);
+    m_stats.det_inference.record(m_timings.det_inference);
+    m_stats.det_postprocess.record(m_timings.det_postprocess);
+    m_stats.rec_preprocess.record(m_timings.rec_preprocess);
+    m_stats.rec_inference.record(m_timings.rec_inference);
+    m_stats.rec_decode.record(m_timings.rec_decode);
+    m_stats.layout.record(m_timings.layout);
+    m_stats.total.record(m_timings.total);
+}
+
+std::string OCREngine::latency_stats_json() const
+{
+    std::stringstream ss;
+    ss << "{\"total_ms\":" << m_stats.total.to_json();
+    ss << ",\"stages_ms\":{";
+    ss << "\"det_preprocess\":" << m_stats.det_preprocess.to_json();
+    ss << ",\"det_inference\":" << m_stats.det_inference.to_json();
+    ss << ",\"det_postprocess\":" << m_stats.det_postprocess.to_json();
+    ss << ",\"rec_preprocess\":" << m_stats.rec_preprocess.to_json();
+    ss << ",\"rec_inference\":" << m_stats.rec_inference.to_json();
+    ss << ",\"rec_decode\":" << m_stats.rec_decode.to_json();
+    ss << ",\"layout\":" << m_stats.layout.to_json();
+    ss << "},\"queue_ms\":" << m_stats.queue.to_json();
+    ss << ",\"boxes_per_image\":" << m_stats.boxes_per_image.to_json();
+    ss << ",\"rec_width_px\":" << m_stats.rec_width.to_json();
+    ss << "}";
+    return ss.str();
+}
+
+void OCREngine::reset_latency_stats()
+{
+    m_stats = LatencyStats();
+    LOG_INFO("[OCREngine] Latency statistics reset");
+}
+
+bool OCREngine::start_capture(const char* path, bool store_pixels, int max_side)
+{
+    if (!m_capture.open(path, store_pixels, max_side)) {
+        LOG_ERROR("Cannot open capture file " << path);
+        return false;
+    }
+    LOG_INFO("[OCREngine] Capturing detect calls to " << path << (store_pixels ? "" : " (pixel hashes only)"));
+    return true;
+}
+
+void OCREngine::stop_capture()
+{
+    if (!m_capture.is_open()) return;
+    m_capture.close();
+    LOG_INFO("[OCREngine] Capture stopped");
+}
+
+void OCREngine::capture_call(const unsigned char* rgba_data, int width, int height, int boxes, bool store_hit)
+{
+    CaptureRecord record;
+    record.width = width;
+    record.height = height;
+    record.text_score_threshold = m_text_score_threshold;
+    record.rec_pack_width = m_rec_pack_width;
+    record.rec_chunk_width = m_rec_chunk_width;
+    record.axis_aligned_tolerance = m_axis_aligned_tolerance;
+    record.rec_pyramid = m_rec_pyramid ? 1 : 0;
+    record.postprocess_threads = m_postprocess_threads;
+    record.num_threads = m_num_threads;
+    if (m_sequence_mode) {
+        record.sequence_tile = m_tile_diff.tile_size();
+        record.sequence_margin = m_sequence_margin;
+    }
+    record.total_ms = m_timings.total;
+    record.boxes = boxes;
+    record.store_hit = store_hit ? 1 : 0;
+    if (!m_capture.write(record, rgba_data)) LOG_ERROR("Capture write failed");
+}
+
+bool OCREngine::open_result_store(const char* path)
+{
+    if (!m_result_store.open(path, model_fingerprint())) return false;
+    m_result_store_path = path;
+    return true;
+}
+
+void OCREngine::close_result_store()
+{
+    if (!m_result_store.is_open()) return;
+    m_result_store.close();
+    LOG_INFO("[OCREngine] Result store closed");
+}
+
+void OCREngine::flush_result_store() { m_result_store.flush(); }
+
+bool OCREngine::compact_result_store(double budget_ms) { return m_result_store.compact_step(budget_ms); }
+
+std::string OCREngine::result_store_stats_json() const
+{
+    std::stringstream ss;
+    ss << "{\"open\":" << (m_result_store.is_open() ? "true" : "false") << ",\"results\":" << m_result_store.records()
+       << ",\"log_bytes\":" << m_result_store.log_bytes() << ",\"live_bytes\":" << m_result_store.live_bytes()
+       << ",\"hits\":" << m_result_store.hits() << ",\"misses\":" << m_result_store.misses() << "}";
     return ss.str();
 }
+
+void OCREngine::index_last_result(uint32_t image_id)
+{
+    m_text_index.remove(image_id);
+    std::vector<int> ids;
+    for (size_t box = 0; box < m_last_result.size(); box++) {
+        ids.clear();
+        for (const Character& ch : m_last_result[box].text) ids.push_back(ch.id);
+        m_text_index.add(image_id, (uint32_t)box, ids.data(), ids.size());
+    }
+}
+
+size_t OCREngine::remove_indexed_image(uint32_t image_id) { return m_text_index.remove(image_id); }
+
+void OCREngine::clear_text_index() { m_text_index.clear(); }
+
+std::string OCREngine::search_text_json(const char* utf8, size_t limit) const
+{
+    std::vector<int> ids;
+    std::vector<TextHit> hits;
+    if (utf8 && encode_text(utf8, ids)) hits = m_text_index.search(ids.data(), ids.size(), limit);
+
+    std::stringstream ss;
+    ss << "[";
+    for (size_t i = 0; i < hits.size(); i++) {
+        if (i > 0) ss << ",";
+        ss << "{\"image\":" << hits[i].image_id << ",\"box\":" << hits[i].box_id << ",\"pos\":" << hits[i].position
+           << "}";
+    }
+    ss << "]";
+    return ss.str();
+}
+
+std::string OCREngine::text_index_stats_json() const { return m_text_index.stats_json(); }
+
+uint64_t OCREngine::model_fingerprint()
+{
+    if (m_model_fingerprint == 0) {
+        uint64_t h = ResultStore::FORMAT_VERSION;
+        for (const std::string& file : m_model_files) h = hash_file(file.c_str(), h);
+        m_model_fingerprint = h ? h : 1;
+    }
+    return m_model_fingerprint;
+}
+
+bool OCREngine::lookup_result(
+    const unsigned char* rgba_data, int width, int height, uint64_t& key, std::vector<Object>& objects)
+{
+    if (!m_result_store.is_open()) return false;
+    STAGE_START(Result_Store);
+    // Everything besides the pixels that changes the result; thread counts do not
+    const int32_t size[2] = { width, height };
+    const float tuning[2] = { m_text_score_threshold, m_axis_aligned_tolerance };
+    const int32_t rec[3] = { m_rec_pack_width, m_rec_chunk_width, m_rec_pyramid ? 1 : 0 };
+    uint64_t options = hash_bytes(size, sizeof(size), 0);
+    options = hash_bytes(tuning, sizeof(tuning), options);
+    options = hash_bytes(rec, sizeof(rec), options);
+    key = hash_bytes(rgba_data, (size_t)width * height * 4, options);
+    const bool hit = m_result_store.get(key, objects);
+    STAGE_END(Result_Store, &m_timings.result_store);
+    if (hit) m_timings.stored++;
+    return hit;
+}
+
+void OCREngine::store_result(uint64_t key, const std::vector<Object>& objects)
+{
+    if (!m_result_store.is_open()) return;
+    STAGE_START(Result_Store);
+    if (!m_result_store.put(key, objects)) LOG_WARN("Result not stored");
+    STAGE_END(Result_Store, &m_timings.result_store);
+}
+
+// Placement of one small image inside a mosaic detection canvas
+struct MosaicTile {
+    int index;
+    int x;
+    int y;
+};
+
+std::string OCREngine::detect_batch(unsigned char* const* rgba_data, const int* widths, const int* heights, int count)
+{
+    m_timings = StageTimings();
+    if (count <= 0 || !rgba_data || !widths || !heights) return "[]";
+
+    STAGE_START(Total_Batch_Pipeline);
+
+    // Small images share det canvases laid out by a shelf packer; the guard band
+    // between them is wide enough that the det receptive field and the unclip
+    // enlargement do not merge boxes across tiles.
+    const int canvas_size = 960;
+    const int guard = 32;
+    const int max_tile_size = canvas_size / 2;
+
+    std::vector<std::vector<Object>> results(count);
+    std::vector<uint64_t> store_keys(count, 0);
+    std::vector<unsigned char> stored(count, 0);
+    std::vector<int> packable;
+    for (int i = 0; i < count; i++) {
+        if (!rgba_data[i] || widths[i] <= 0 || heights[i] <= 0) continue;
+        if (lookup_result(rgba_data[i], widths[i], heights[i], store_keys[i], results[i])) {
+            stored[i] = 1;
+            continue;
+        }
+        if (std::max(widths[i], heights[i]) <= max_tile_size) {
+            packable.push_back(i);
+        } else {
+            detect_text(rgba_data[i], widths[i], heights[i], results[i]);
+        }
+    }
+
+    // Tallest first keeps shelves dense
+    std::stable_sort(packable.begin(), packable.end(), [&](int a, int b) { return heights[a] > heights[b]; });
+
+    std::vector<std::vector<MosaicTile>> canvases;
+    std::vector<MosaicTile> tiles;
+    int cursor_x = 0, shelf_y = 0, shelf_h = 0;
+    for (int index : packable) {
+        if (cursor_x > 0 && cursor_x + widths[index] > canvas_size) {
+            shelf_y += shelf_h + guard;
+            cursor_x = 0;
+            shelf_h = 0;
+        }
+        if (shelf_y > 0 && shelf_y + heights[index] > canvas_size) {
+            canvases.push_back(tiles);
+            tiles.clear();
+            shelf_y = 0;
+            cursor_x = 0;
+            shelf_h = 0;
+        }
+        tiles.push_back({ index, cursor_x, shelf_y });
+        cursor_x += widths[index] + guard;
+        shelf_h = std::max(shelf_h, heights[index]);
+    }
+    if (!tiles.empty()) canvases.push_back(tiles);
+
+    for (const auto& canvas_tiles : canvases) {
+        int canvas_w = 0, canvas_h = 0;
+        for (const auto& t : canvas_tiles) {
+            canvas_w = std::max(canvas_w, t.x + widths[t.index]);
+            canvas_h = std::max(canvas_h, t.y + heights[t.index]);
+        }
+
+        // Compose, using the same gray as the det padding for the guard bands
+        std::vector<unsigned char> canvas((size_t)canvas_w * canvas_h * 4);
+        for (size_t i = 0; i < canvas.size(); i += 4) {
+            canvas[i] = canvas[i + 1] = canvas[i + 2] = 114;
+            canvas[i + 3] = 255;
+        }
+        for (const auto& t : canvas_tiles) {
+            const int w = widths[t.index];
+            for (int y = 0; y < heights[t.index]; y++) {
+                memcpy(canvas.data() + ((size_t)(t.y + y) * canvas_w + t.x) * 4,
+                    rgba_data[t.index] + (size_t)y * w * 4, (size_t)w * 4);
+            }
+        }
+
+        std::vector<Object> objects;
+        detect_text(canvas.data(), canvas_w, canvas_h, objects);
+
+        // Route each box to the tile containing its center and remap it
+        for (auto& obj : objects) {
+            for (const auto& t : canvas_tiles) {
+                float local_x = obj.rrect.center.x - t.x;
+                float local_y = obj.rrect.center.y - t.y;
+                if (local_x >= 0 && local_y >= 0 && local_x < widths[t.index] && local_y < heights[t.index]) {
+                    obj.rrect.center.x = local_x;
+                    obj.rrect.center.y = local_y;
+                    results[t.index].push_back(obj);
+                    break;
+                }
+            }
+        }
+    }
+    LOG_DEBUG("Batch: " << packable.size() << " of " << count << " images packed into " << canvases.size()
+                        << " det canvases");
+
+    std::string json = "[";
+    for (int i = 0; i < count; i++) {
+        if (i > 0) json += ",";
+        if (rgba_data[i] && widths[i] > 0 && heights[i] > 0) {
+            if (!stored[i]) {
+                recognize_objects(rgba_data[i], widths[i], heights[i], results[i]);
+                apply_layout(results[i]);
+                store_result(store_keys[i], results[i]);
+            }
+            m_timings.images++;
+        }
+        json += objects_to_json(results[i]);
+    }
+    json += "]";
+
+    STAGE_END(Total_Batch_Pipeline, &m_timings.total);
+    log_timings();
+    record_latency_stats();
+    return json;
+}
@@ -1,11 +1,18 @@
 #ifndef OCR_ENGINE_H
 #define OCR_ENGINE_H
 
+#include <atomic>
 #include <cmath>
 #include <string>
 #include <vector>
 
+#include "capture.h"
+#include "frame_diff.h"
+#include "histogram.h"
+#include "layer_profiler.h"
 #include "net.h"
+#include "result_store.h"
+#include "text_index.h"
 
 // 自定义几何结构体，替代 OpenCV 类型
 struct Point {
@@ -36,14 +43,73 @@ struct Object {
     int orientation;
     float prob;
     std::vector<Character> text;
+    int line_id = -1; // assigned by the layout stage, in reading order
+    int paragraph_id = -1;
 };
 
 struct RecStats {
     double preprocess = 0.0;
     double inference = 0.0;
     double decode = 0.0;
+    int warp_axis_aligned = 0; // boxes that took the direct resize path
+    int warp_affine = 0;
+    double warp_axis_aligned_time = 0.0;
+    double warp_affine_time = 0.0;
 };
 
+// Wall time per pipeline stage of the last detect()/detect_batch() call (ms).
+// Rec stages are summed over boxes; windows of a chunked line overlap in time.
+struct StageTimings {
+    double det_preprocess = 0.0;
+    double det_inference = 0.0;
+    double det_postprocess = 0.0;
+    double rec_preprocess = 0.0;
+    double rec_inference = 0.0;
+    double rec_decode = 0.0;
+    double layout = 0.0;
+    double frame_diff = 0.0; // sequence mode: tile hashing and region search
+    double result_store = 0.0; // input hashing, lookup and append
+    double total = 0.0;
+    int images = 0;
+    int boxes = 0; // recognized in this call
+    int boxes_reused = 0; // sequence mode: carried over from the previous frame
+    int tiles = 0; // sequence mode: tile grid size and tiles that changed
+    int tiles_changed = 0;
+    int stored = 0; // images answered from the result store
+};
+
+// Time spent in load_model() for both nets (ms). `pipeline` is the part of
+// ncnn's load_model that is not reading weights: weight transforms and
+// create_pipeline.
+struct LoadTimings {
+    double param_parse = 0.0;
+    double weight_read = 0.0;
+    double pipeline = 0.0;
+};
+
+// Rolling distributions over recent calls. Stage and total times are per
+// detect()/detect_batch() call (ms); boxes are per image; rec widths are the
+// natural rec input width of every recognized box (px); queue is the time each
+// async job waited before it started (ms).
+struct LatencyStats {
+    RollingHistogram det_preprocess { 0.001 };
+    RollingHistogram det_inference { 0.001 };
+    RollingHistogram det_postprocess { 0.001 };
+    RollingHistogram rec_preprocess { 0.001 };
+    RollingHistogram rec_inference { 0.001 };
+    RollingHistogram rec_decode { 0.001 };
+    RollingHistogram layout { 0.001 };
+    RollingHistogram total { 0.001 };
+    RollingHistogram queue { 0.001 };
+    RollingHistogram boxes_per_image;
+    RollingHistogram rec_width;
+};
+
+// UTF-8 text of recognized characters
+std::string decode_text(const std::vector<Character>& text);
+// Character ids of UTF-8 text; false if it holds a character the model cannot output
+bool encode_text(const std::string& utf8, std::vector<int>& ids);
+
 class OCREngine {
 public:
     OCREngine();
@@ -51,15 +117,150 @@ public:
 
     void load_model(const char* det_param, const char* det_bin, const char* rec_param, const char* rec_bin);
     std::string detect(unsigned char* rgba_data, int width, int height);
+    // detect() without the JSON step: recognized boxes in reading order
+    std::vector<Object> detect_objects(const unsigned char* rgba_data, int width, int height);
+    // Detects several images at once, packing small ones into shared det canvases.
+    // Returns a JSON array holding one result array per input image.
+    std::string detect_batch(unsigned char* const* rgba_data, const int* widths, const int* heights, int count);
     void warmup();
     void set_text_score_threshold(float threshold);
+    // Pack short boxes side by side into rec inputs up to `width` px wide (0 disables packing)
+    void set_rec_pack_width(int width);
+    // Recognize lines wider than `width` px in overlapping windows (0 disables chunking)
+    void set_rec_chunk_width(int width);
+    // Boxes within `degrees` of 0/90 are resized directly instead of warped (negative disables)
+    void set_axis_aligned_tolerance(float degrees);
+    // Box-filter tall crops down by 2x/4x before warping so the warp samples near 1:1
+    void set_rec_pyramid(bool enabled);
+    // Threads for det postprocessing in threads builds (0 = the whole thread budget)
+    void set_postprocess_threads(int num_threads);
+    // Thread budget shared by ncnn inference and engine-side kernels in threads
+    // builds (0 = all OpenMP threads). Must not exceed the pthread pool size.
+    void set_num_threads(int num_threads);
+    const StageTimings& last_timings() const { return m_timings; }
+    const LoadTimings& load_timings() const { return m_load_timings; }
+    const LatencyStats& latency_stats() const { return m_stats; }
+    // Percentiles of every LatencyStats histogram as JSON
+    std::string latency_stats_json() const;
+    void reset_latency_stats();
+    // Called by the job queue with each job's waiting time
+    void record_queue_delay(double ms) { m_stats.queue.record(ms); }
+    // Time det/rec inference layer by layer (slower; chunk windows run serially)
+    void set_layer_profiling(bool enabled);
+    // Accumulated per-type and per-layer times for both nets, sorted, as JSON
+    std::string layer_profile_json() const;
+    void reset_layer_profile();
+    // Sequence mode for successive frames of one scene (screenshots of a window,
+    // re-runs after small edits). Each detect()/detect_objects() call hashes
+    // `tile_size` px tiles and diffs them against the previous call; det reruns
+    // on the changed regions grown by `margin` px and rec only on the boxes found
+    // there, while other boxes keep their previous text. 0 disables.
+    void set_sequence_mode(int tile_size, int margin);
+    // Forgets the previous frame, so the next call runs in full
+    void reset_sequence();
+    // Persistent results (see result_store.h). While a store is open, every
+    // detect()/detect_objects()/detect_batch() image that was seen before with
+    // the same model and result-affecting options is answered from it, and new
+    // results are appended. The host persists <path> and <path>.idx itself.
+    bool open_result_store(const char* path);
+    void close_result_store();
+    // Writes pending records and the index back to the files
+    void flush_result_store();
+    // Compacts for about `budget_ms`; true while work remains
+    bool compact_result_store(double budget_ms);
+    std::string result_store_stats_json() const;
+    // Phrase search over recognized text (see text_index.h). Indexes the boxes
+    // of the last detect() call under `image_id`, replacing that image's earlier
+    // boxes; box ids are positions in the JSON array detect() returned. Only
+    // meaningful right after a synchronous detect(): queued jobs run detect()
+    // too, so with jobs in flight "last" is whichever one finished last.
+    void index_last_result(uint32_t image_id);
+    size_t remove_indexed_image(uint32_t image_id);
+    void clear_text_index();
+    // Indexed boxes containing the UTF-8 phrase as JSON [{"image","box","pos"}],
+    // at most `limit` (0 = all)
+    std::string search_text_json(const char* utf8, size_t limit) const;
+    std::string text_index_stats_json() const;
+    // While set, detect calls check *flag between stages and rec inputs and
+    // give up once it is true: no boxes, nothing stored, sequence state reset
+    void set_cancel_flag(const std::atomic<bool>* flag) { m_cancel = flag; }
+    // Appends every detect()/detect_objects() call (input, options, timing) to a
+    // capture file for tests/bench/replay. store_pixels = false keeps only a
+    // hash of the input; max_side > 0 downscales the stored pixels.
+    bool start_capture(const char* path, bool store_pixels, int max_side);
+    void stop_capture();
+
+    // Times det input preparation (resize, border, normalize) with `num_threads` (ms per iteration)
+    double benchmark_det_preprocess(
+        const unsigned char* rgba_data, int width, int height, int num_threads, int iterations) const;
+    // Runs det once, then times postprocess_det alone with `num_threads` (ms per iteration)
+    double benchmark_det_postprocess(
+        const unsigned char* rgba_data, int width, int height, int num_threads, int iterations);
 
 private:
-    void detect_text(const unsigned char* rgba_data, int img_w, int img_h, std::vector<Object>& objects);
+    // det_scale > 0 resizes by that factor instead of fitting the det target size
+    void detect_text(const unsigned char* rgba_data, int img_w, int img_h, std::vector<Object>& objects,
+        float det_scale = 0.f);
+    ncnn::Mat prepare_det_input(const unsigned char* rgba_data, int img_w, int img_h, float& scale, int& wpad,
+        int& hpad, int num_threads, float det_scale = 0.f) const;
+    ncnn::Mat infer_det(const unsigned char* rgba_data, int img_w, int img_h, float& scale, int& wpad, int& hpad,
+        float det_scale = 0.f);
+    // Sequence mode: det and rec on the changed regions only, reusing the rest
+    // of the previous result. Returns false when the call must run in full.
+    bool detect_changed(const unsigned char* rgba_data, int width, int height, std::vector<Object>& objects);
+    // Key of an input under the current options; fills `objects` on a store hit
+    bool lookup_result(
+        const unsigned char* rgba_data, int width, int height, uint64_t& key, std::vector<Object>& objects);
+    void store_result(uint64_t key, const std::vector<Object>& objects);
+    // Hash of the loaded model files, computed on first use
+    uint64_t model_fingerprint();
+    void postprocess_det(ncnn::Mat& out, float scale, int wpad, int hpad, std::vector<Object>& objects) const;
+    void recognize_objects(const unsigned char* rgba_data, int width, int height, std::vector<Object>& objects);
+    // ex.extract("out0"), or layer by layer into `profiler` while profiling
+    int extract_output(const ncnn::Net& net, ncnn::Extractor& ex, LayerProfiler& profiler, ncnn::Mat& out);
+    // Threads available to any one stage (1 without OpenMP)
+    int thread_budget() const;
+    bool cancelled() const { return m_cancel && m_cancel->load(std::memory_order_relaxed); }
+    void apply_layout(std::vector<Object>& objects);
+    void log_timings() const;
+    void record_latency_stats();
+    void capture_call(const unsigned char* rgba_data, int width, int height, int boxes, bool store_hit);
+    std::string objects_to_json(const std::vector<Object>& objects) const;
     void recognize_text(const unsigned char* rgba_data, int img_w, int img_h, Object& object, RecStats* stats = nullptr);
-    ncnn::Mat crop_and_warp_roi(const unsigned char* rgba_data, int img_w, int img_h, const Object& object);
+    void recognize_packed(const unsigned char* rgba_data, int img_w, int img_h, std::vector<Object>& objects,
+        const std::vector<size_t>& indices, RecStats* stats = nullptr);
+    void recognize_chunked(const unsigned char* rgba_data, int img_w, int img_h, Object& object, RecStats* stats = nullptr);
+    // Returns the normalized 48xW rec input for a box
+    ncnn::Mat crop_and_warp_roi(
+        const unsigned char* rgba_data, int img_w, int img_h, const Object& object, int max_width = 2048,
+        RecStats* stats = nullptr);
 
     float m_text_score_threshold = 0.5f;
+    int m_rec_pack_width = 0;
+    int m_rec_chunk_width = 0;
+    float m_axis_aligned_tolerance = 0.5f;
+    bool m_rec_pyramid = true;
+    int m_postprocess_threads = 0;
+    int m_num_threads = 0; // 0 = all OpenMP threads
+    StageTimings m_timings;
+    LoadTimings m_load_timings;
+    LatencyStats m_stats;
+    bool m_layer_profiling = false;
+    const std::atomic<bool>* m_cancel = nullptr;
+    LayerProfiler m_det_profile;
+    LayerProfiler m_rec_profile;
+    CaptureWriter m_capture;
+    bool m_sequence_mode = false;
+    int m_sequence_margin = 0;
+    TileDiff m_tile_diff;
+    bool m_have_prev_frame = false;
+    std::vector<Object> m_prev_objects; // before layout, so threshold changes still apply
+    ResultStore m_result_store;
+    std::string m_result_store_path;
+    std::string m_model_files[4];
+    uint64_t m_model_fingerprint = 0;
+    TextIndex m_text_index;
+    std::vector<Object> m_last_result; // boxes of the last detect() JSON
 
     ncnn::Net ppocrv5_det;
     ncnn::Net ppocrv5_rec;
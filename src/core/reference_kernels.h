@@ -0,0 +1,27 @@
+#ifndef REFERENCE_KERNELS_H
+#define REFERENCE_KERNELS_H
+
+#include <vector>
+
+#include "kernels.h"
+
+// Frozen, single-threaded copies of the kernels in kernels.h as they were when
+// the conformance harness (tests/bench/conformance.cpp) was added. They are the
+// oracle for tolerance and equivalence checks: optimize kernels.cpp, never
+// this file. Not linked into the plugin.
+namespace reference {
+
+void warp_affine_bilinear(const ncnn::Mat& src, ncnn::Mat& dst, const Matrix2x3& M, int dst_w, int dst_h,
+    const float* mean_vals, const float* norm_vals);
+
+void label_components(
+    const float* pred_data, int w, int h, float threshold, std::vector<std::vector<IntPoint>>& contours);
+
+void get_min_area_rect(const std::vector<IntPoint>& contour, RotatedRect& out_rect);
+
+void decode_ctc(
+    const ncnn::Mat& out, int t_begin, int t_end, std::vector<Character>& text, int* last_token_state = nullptr);
+
+} // namespace reference
+
+#endif // REFERENCE_KERNELS_H
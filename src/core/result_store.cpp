@@ -0,0 +1,527 @@
+#include "result_store.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "ocr_engine.h"
+
+namespace {
+
+const char DATA_MAGIC[8] = { 'O', 'C', 'R', 'S', 'T', 'O', 'R', 'E' };
+const char INDEX_MAGIC[8] = { 'O', 'C', 'R', 'S', 'I', 'D', 'X', '1' };
+const uint64_t DATA_HEADER_SIZE = 8 + 4 + 4 + 8 + 8;
+const uint32_t MIN_CAPACITY = 1024;
+// Compaction waits until at least this much of the log is dead
+const uint64_t MIN_COMPACT_BYTES = 64 * 1024;
+// Fixed part of a serialized object and of a record body (key + object count)
+const size_t OBJECT_FIXED_SIZE = 6 * 4 + 3 * 4 + 4;
+const size_t BODY_FIXED_SIZE = 8 + 4;
+
+template <typename T>
+void put_value(std::vector<unsigned char>& buf, T value)
+{
+    unsigned char bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+    buf.insert(buf.end(), bytes, bytes + sizeof(T));
+}
+
+// Bounds-checked reads over a record body
+struct Cursor {
+    const unsigned char* p;
+    const unsigned char* end;
+
+    template <typename T>
+    bool get(T& value)
+    {
+        if ((size_t)(end - p) < sizeof(T)) return false;
+        memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+};
+
+uint64_t new_log_id(uint64_t seed)
+{
+    const int64_t now = std::chrono::system_clock::now().time_since_epoch().count();
+    const int64_t tick = std::chrono::steady_clock::now().time_since_epoch().count();
+    const int64_t parts[2] = { now, tick };
+    return hash_bytes(parts, sizeof(parts), seed) | 1;
+}
+
+bool write_data_header(FILE* f, uint64_t model_fingerprint, uint64_t log_id)
+{
+    std::vector<unsigned char> buf(DATA_MAGIC, DATA_MAGIC + sizeof(DATA_MAGIC));
+    put_value<uint32_t>(buf, ResultStore::FORMAT_VERSION);
+    put_value<uint32_t>(buf, 0);
+    put_value<uint64_t>(buf, model_fingerprint);
+    put_value<uint64_t>(buf, log_id);
+    return fseek(f, 0, SEEK_SET) == 0 && fwrite(buf.data(), 1, buf.size(), f) == buf.size();
+}
+
+// Log offsets are u64, but long is 32 bits on wasm32. off_t is 64 bits there,
+// so seek with fseeko, and refuse offsets off_t cannot hold rather than wrap.
+bool seek_to(FILE* f, uint64_t offset)
+{
+    if (offset > (uint64_t)std::numeric_limits<off_t>::max()) return false;
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+}
+
+uint64_t file_size(FILE* f)
+{
+    if (fseeko(f, 0, SEEK_END) != 0) return 0;
+    const off_t size = ftello(f);
+    return size > 0 ? (uint64_t)size : 0;
+}
+
+} // namespace
+
+uint64_t hash_file(const char* path, uint64_t seed)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    std::vector<unsigned char> buf(1 << 16);
+    uint64_t h = seed;
+    size_t n;
+    while ((n = fread(buf.data(), 1, buf.size(), f)) > 0) h = hash_bytes(buf.data(), n, h);
+    fclose(f);
+    return h;
+}
+
+struct ResultStore::IndexHeader {
+    char magic[8];
+    uint32_t capacity;
+    uint32_t count;
+    uint64_t log_id;
+    uint64_t data_size;
+    uint64_t live_bytes;
+};
+
+struct ResultStore::Slot {
+    uint64_t key;
+    uint64_t offset;
+};
+
+ResultStore::~ResultStore() { close(); }
+
+ResultStore::IndexHeader* ResultStore::header() const { return (IndexHeader*)m_index; }
+
+ResultStore::Slot* ResultStore::slots() const { return (Slot*)(m_index + sizeof(IndexHeader)); }
+
+bool ResultStore::open(const char* path, uint64_t model_fingerprint)
+{
+    close();
+    m_path = path;
+    m_model_fingerprint = model_fingerprint;
+    m_hits = m_misses = 0;
+
+    uint64_t log_id = 0;
+    m_data = fopen(path, "r+b");
+    if (m_data) {
+        unsigned char head[DATA_HEADER_SIZE];
+        Cursor c = { head + sizeof(DATA_MAGIC), head + sizeof(head) };
+        uint32_t version = 0, reserved = 0;
+        uint64_t fingerprint = 0;
+        const bool valid = fread(head, 1, sizeof(head), m_data) == sizeof(head)
+            && memcmp(head, DATA_MAGIC, sizeof(DATA_MAGIC)) == 0 && c.get(version) && c.get(reserved)
+            && c.get(fingerprint) && c.get(log_id);
+        if (!valid || version != FORMAT_VERSION || fingerprint != model_fingerprint) {
+            LOG_INFO("[ResultStore] " << path << " was written by another "
+                                      << (valid && version == FORMAT_VERSION ? "model" : "format version")
+                                      << ", starting over");
+            fclose(m_data);
+            m_data = nullptr;
+        }
+    }
+    if (!m_data) {
+        m_data = fopen(path, "w+b");
+        log_id = new_log_id(model_fingerprint);
+        if (!m_data || !write_data_header(m_data, model_fingerprint, log_id)) {
+            LOG_ERROR("[ResultStore] Cannot create " << path);
+            close();
+            return false;
+        }
+        fflush(m_data);
+    }
+    m_data_size = file_size(m_data);
+
+    if (load_index(log_id) && header()->data_size <= m_data_size) {
+        if (header()->data_size < m_data_size && !scan_log(header()->data_size)) {
+            close();
+            return false;
+        }
+    } else {
+        unmap_index();
+        if (!create_index(MIN_CAPACITY, log_id) || !scan_log(DATA_HEADER_SIZE)) {
+            close();
+            return false;
+        }
+    }
+    LOG_INFO("[ResultStore] Opened " << path << ": " << records() << " results, " << m_data_size << " bytes");
+    return true;
+}
+
+void ResultStore::close()
+{
+    abort_compaction();
+    if (m_data) {
+        flush();
+        fclose(m_data);
+        m_data = nullptr;
+    }
+    unmap_index();
+    m_data_size = 0;
+}
+
+void ResultStore::flush()
+{
+    if (m_data) fflush(m_data);
+    if (m_index) msync(m_index, m_index_bytes, MS_SYNC);
+}
+
+bool ResultStore::load_index(uint64_t log_id)
+{
+    const std::string idx_path = m_path + ".idx";
+    m_index_fd = ::open(idx_path.c_str(), O_RDWR);
+    if (m_index_fd < 0) return false;
+
+    IndexHeader h;
+    const off_t size = lseek(m_index_fd, 0, SEEK_END);
+    const bool valid = size >= (off_t)sizeof(IndexHeader) && pread(m_index_fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h)
+        && memcmp(h.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 && h.log_id == log_id && h.capacity >= MIN_CAPACITY
+        && (h.capacity & (h.capacity - 1)) == 0 && h.count <= h.capacity / 2
+        && (uint64_t)size == sizeof(IndexHeader) + (uint64_t)h.capacity * sizeof(Slot);
+    if (!valid) {
+        unmap_index();
+        return false;
+    }
+
+    void* p = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, m_index_fd, 0);
+    if (p == MAP_FAILED) {
+        unmap_index();
+        return false;
+    }
+    m_index = (unsigned char*)p;
+    m_index_bytes = (size_t)size;
+    return true;
+}
+
+bool ResultStore::create_index(uint32_t capacity, uint64_t log_id)
+{
+    const std::string idx_path = m_path + ".idx";
+    m_index_fd = ::open(idx_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    const size_t bytes = sizeof(IndexHeader) + (size_t)capacity * sizeof(Slot);
+    // A fresh file extended by ftruncate reads back as zeros: every slot empty
+    if (m_index_fd < 0 || ftruncate(m_index_fd, (off_t)bytes) != 0) {
+        LOG_ERROR("[ResultStore] Cannot create " << idx_path);
+        unmap_index();
+        return false;
+    }
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_index_fd, 0);
+    if (p == MAP_FAILED) {
+        LOG_ERROR("[ResultStore] Cannot map " << idx_path);
+        unmap_index();
+        return false;
+    }
+    m_index = (unsigned char*)p;
+    m_index_bytes = bytes;
+    memset(m_index, 0, bytes);
+
+    IndexHeader* h = header();
+    memcpy(h->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    h->capacity = capacity;
+    h->log_id = log_id;
+    h->data_size = DATA_HEADER_SIZE;
+    return true;
+}
+
+void ResultStore::unmap_index()
+{
+    if (m_index) {
+        msync(m_index, m_index_bytes, MS_SYNC);
+        munmap(m_index, m_index_bytes);
+    }
+    if (m_index_fd >= 0) ::close(m_index_fd);
+    m_index = nullptr;
+    m_index_bytes = 0;
+    m_index_fd = -1;
+}
+
+ResultStore::Slot* ResultStore::find_slot(uint64_t key) const
+{
+    const uint32_t mask = header()->capacity - 1;
+    Slot* table = slots();
+    for (uint32_t i = (uint32_t)key & mask;; i = (i + 1) & mask) {
+        if (table[i].key == key) return &table[i];
+        if (table[i].key == 0) return nullptr;
+    }
+}
+
+bool ResultStore::insert(uint64_t key, uint64_t offset, uint64_t record_bytes)
+{
+    IndexHeader* h = header();
+    if ((uint64_t)(h->count + 1) * 2 > h->capacity) {
+        // Grow: collect the slots, map a table twice the size, reinsert
+        std::vector<Slot> old(slots(), slots() + h->capacity);
+        const uint32_t capacity = h->capacity * 2;
+        const uint64_t log_id = h->log_id, data_size = h->data_size, live_bytes = h->live_bytes;
+        unmap_index();
+        if (!create_index(capacity, log_id)) return false;
+        h = header();
+        h->data_size = data_size;
+        h->live_bytes = live_bytes;
+        const uint32_t mask = capacity - 1;
+        for (const Slot& s : old) {
+            if (s.key == 0) continue;
+            uint32_t i = (uint32_t)s.key & mask;
+            while (slots()[i].key != 0) i = (i + 1) & mask;
+            slots()[i] = s;
+            h->count++;
+        }
+    }
+
+    const uint32_t mask = h->capacity - 1;
+    Slot* table = slots();
+    uint32_t i = (uint32_t)key & mask;
+    while (table[i].key != 0 && table[i].key != key) i = (i + 1) & mask;
+    if (table[i].key == key) {
+        // The old record is dead now; its size field says how much
+        uint32_t old_size = 0;
+        if (seek_to(m_data, table[i].offset) && fread(&old_size, sizeof(old_size), 1, m_data) == 1)
+            h->live_bytes -= std::min<uint64_t>(h->live_bytes, 4 + (uint64_t)old_size);
+    } else {
+        table[i].key = key;
+        h->count++;
+    }
+    table[i].offset = offset;
+    h->live_bytes += record_bytes;
+    return true;
+}
+
+bool ResultStore::read_record(FILE* f, uint64_t offset, uint64_t size, std::vector<unsigned char>& body) const
+{
+    uint32_t head[2]; // size, checksum
+    if (offset + sizeof(head) > size || !seek_to(f, offset) || fread(head, sizeof(head), 1, f) != 1)
+        return false;
+    if (head[0] < 4 + BODY_FIXED_SIZE || offset + 4 + head[0] > size) return false;
+    body.resize(head[0] - 4);
+    if (fread(body.data(), 1, body.size(), f) != body.size()) return false;
+    return (uint32_t)hash_bytes(body.data(), body.size(), 0) == head[1];
+}
+
+bool ResultStore::scan_log(uint64_t from)
+{
+    std::vector<unsigned char> body;
+    uint64_t offset = from;
+    while (offset < m_data_size) {
+        if (!read_record(m_data, offset, m_data_size, body)) {
+            LOG_WARN("[ResultStore] Cutting off " << (m_data_size - offset) << " bytes of torn records");
+            fflush(m_data);
+            if (ftruncate(fileno(m_data), (off_t)offset) != 0) return false;
+            m_data_size = offset;
+            break;
+        }
+        uint64_t key;
+        memcpy(&key, body.data(), sizeof(key));
+        if (!insert(key, offset, 8 + body.size())) return false;
+        offset += 8 + body.size();
+    }
+    header()->data_size = m_data_size;
+    return true;
+}
+
+bool ResultStore::get(uint64_t key, std::vector<Object>& objects)
+{
+    if (!is_open()) return false;
+    key = key ? key : 1;
+    const Slot* slot = find_slot(key);
+    std::vector<unsigned char> body;
+    if (!slot || !read_record(m_data, slot->offset, m_data_size, body)) {
+        m_misses++;
+        return false;
+    }
+
+    Cursor c = { body.data(), body.data() + body.size() };
+    uint64_t stored_key = 0;
+    uint32_t count = 0;
+    if (!c.get(stored_key) || stored_key != key || !c.get(count) || count > body.size() / OBJECT_FIXED_SIZE) {
+        m_misses++;
+        return false;
+    }
+    std::vector<Object> out(count);
+    for (Object& obj : out) {
+        int32_t orientation, line_id, paragraph_id;
+        uint32_t chars;
+        bool ok = c.get(obj.rrect.center.x) && c.get(obj.rrect.center.y) && c.get(obj.rrect.size.width)
+            && c.get(obj.rrect.size.height) && c.get(obj.rrect.angle) && c.get(obj.prob) && c.get(orientation)
+            && c.get(line_id) && c.get(paragraph_id) && c.get(chars) && chars <= (size_t)(c.end - c.p) / 4;
+        if (!ok) {
+            m_misses++;
+            return false;
+        }
+        obj.orientation = orientation;
+        obj.line_id = line_id;
+        obj.paragraph_id = paragraph_id;
+        obj.text.resize(chars);
+        for (Character& ch : obj.text) {
+            uint16_t id = 0, prob = 0;
+            c.get(id);
+            c.get(prob);
+            ch.id = id;
+            ch.prob = prob / 65535.f;
+        }
+    }
+    objects.swap(out);
+    m_hits++;
+    return true;
+}
+
+bool ResultStore::put(uint64_t key, const std::vector<Object>& objects)
+{
+    if (!is_open()) return false;
+    key = key ? key : 1;
+
+    std::vector<unsigned char> body;
+    put_value<uint64_t>(body, key);
+    put_value<uint32_t>(body, (uint32_t)objects.size());
+    for (const Object& obj : objects) {
+        put_value<float>(body, obj.rrect.center.x);
+        put_value<float>(body, obj.rrect.center.y);
+        put_value<float>(body, obj.rrect.size.width);
+        put_value<float>(body, obj.rrect.size.height);
+        put_value<float>(body, obj.rrect.angle);
+        put_value<float>(body, obj.prob);
+        put_value<int32_t>(body, obj.orientation);
+        put_value<int32_t>(body, obj.line_id);
+        put_value<int32_t>(body, obj.paragraph_id);
+        put_value<uint32_t>(body, (uint32_t)obj.text.size());
+        for (const Character& ch : obj.text) {
+            if (ch.id < 0 || ch.id > 0xFFFF) return false; // needs a wider format
+            put_value<uint16_t>(body, (uint16_t)ch.id);
+            put_value<uint16_t>(body, (uint16_t)(std::min(std::max(ch.prob, 0.f), 1.f) * 65535.f + 0.5f));
+        }
+    }
+
+    std::vector<unsigned char> record;
+    record.reserve(8 + body.size());
+    put_value<uint32_t>(record, (uint32_t)(4 + body.size()));
+    put_value<uint32_t>(record, (uint32_t)hash_bytes(body.data(), body.size(), 0));
+    record.insert(record.end(), body.begin(), body.end());
+
+    const uint64_t offset = m_data_size;
+    if (!seek_to(m_data, offset) || fwrite(record.data(), 1, record.size(), m_data) != record.size()) {
+        LOG_ERROR("[ResultStore] Write failed");
+        return false;
+    }
+    m_data_size += record.size();
+    if (!insert(key, offset, record.size())) return false;
+    header()->data_size = m_data_size;
+    return true;
+}
+
+size_t ResultStore::records() const { return m_index ? header()->count : 0; }
+
+uint64_t ResultStore::live_bytes() const { return m_index ? header()->live_bytes : 0; }
+
+void ResultStore::abort_compaction()
+{
+    if (!m_compact) return;
+    fclose(m_compact);
+    m_compact = nullptr;
+    remove((m_path + ".compact").c_str());
+    m_compact_offsets.clear();
+}
+
+bool ResultStore::compact_step(double budget_ms)
+{
+    if (!is_open()) return false;
+    const auto start = std::chrono::steady_clock::now();
+
+    if (!m_compact) {
+        const uint64_t live = live_bytes();
+        const uint64_t dead = m_data_size - DATA_HEADER_SIZE - std::min(live, m_data_size - DATA_HEADER_SIZE);
+        if (dead <= live || dead < MIN_COMPACT_BYTES) return false;
+        m_compact = fopen((m_path + ".compact").c_str(), "w+b");
+        m_compact_log_id = new_log_id(m_model_fingerprint);
+        if (!m_compact || !write_data_header(m_compact, m_model_fingerprint, m_compact_log_id)) {
+            LOG_ERROR("[ResultStore] Cannot start compaction");
+            abort_compaction();
+            return false;
+        }
+        m_compact_cursor = DATA_HEADER_SIZE;
+        m_compact_size = DATA_HEADER_SIZE;
+        m_compact_offsets.clear();
+    }
+
+    std::vector<unsigned char> body;
+    int copied = 0;
+    while (m_compact_cursor < m_data_size) {
+        if (!read_record(m_data, m_compact_cursor, m_data_size, body)) {
+            LOG_ERROR("[ResultStore] Compaction stopped at an unreadable record");
+            abort_compaction();
+            return false;
+        }
+        uint64_t key;
+        memcpy(&key, body.data(), sizeof(key));
+        const uint64_t bytes = 8 + body.size();
+        const Slot* slot = find_slot(key);
+        if (slot && slot->offset == m_compact_cursor) {
+            const uint32_t head[2] = { (uint32_t)(4 + body.size()), (uint32_t)hash_bytes(body.data(), body.size(), 0) };
+            if (fwrite(head, sizeof(head), 1, m_compact) != 1
+                || fwrite(body.data(), 1, body.size(), m_compact) != body.size()) {
+                LOG_ERROR("[ResultStore] Compaction write failed");
+                abort_compaction();
+                return false;
+            }
+            m_compact_offsets.push_back(key);
+            m_compact_offsets.push_back(m_compact_size);
+            m_compact_offsets.push_back(bytes);
+            m_compact_size += bytes;
+        }
+        m_compact_cursor += bytes;
+        if (++copied % 16 == 0
+            && std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budget_ms)
+            return true;
+    }
+    finish_compaction();
+    return false;
+}
+
+bool ResultStore::finish_compaction()
+{
+    const uint64_t old_size = m_data_size;
+    const uint32_t capacity = header()->capacity;
+    fflush(m_compact);
+    fclose(m_compact);
+    m_compact = nullptr;
+    fclose(m_data);
+    m_data = nullptr;
+    unmap_index();
+
+    const std::string compact_path = m_path + ".compact";
+    if (rename(compact_path.c_str(), m_path.c_str()) != 0) {
+        LOG_ERROR("[ResultStore] Cannot replace " << m_path << " after compaction");
+        remove(compact_path.c_str());
+        m_compact_offsets.clear();
+        return open(m_path.c_str(), m_model_fingerprint);
+    }
+    m_data = fopen(m_path.c_str(), "r+b");
+    m_data_size = m_compact_size;
+    bool ok = m_data && create_index(capacity, m_compact_log_id);
+    // Appending order: a key rewritten during compaction ends at its newest copy
+    for (size_t i = 0; ok && i < m_compact_offsets.size(); i += 3)
+        ok = insert(m_compact_offsets[i], m_compact_offsets[i + 1], m_compact_offsets[i + 2]);
+    m_compact_offsets.clear();
+    if (!ok) {
+        close();
+        return false;
+    }
+    header()->data_size = m_data_size;
+    LOG_INFO("[ResultStore] Compacted " << old_size << " -> " << m_data_size << " bytes, " << records() << " results");
+    return true;
+}
@@ -0,0 +1,110 @@
+#ifndef RESULT_STORE_H
+#define RESULT_STORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "hash.h"
+
+struct Object;
+
+// Hash of a whole file, 0 if it cannot be read
+uint64_t hash_file(const char* path, uint64_t seed);
+
+// Persistent OCR results keyed by a 64-bit content key. Two files:
+//
+// <path>      append-only record log, all little-endian
+//   header:   8-byte magic "OCRSTORE", u32 format version, u32 reserved,
+//             u64 model fingerprint, u64 log id (new for every rewrite)
+//   record:   u32 size (bytes after this field), u32 checksum (of the same bytes),
+//             u64 key, u32 object count, then per object
+//               f32 center x/y, width, height, angle, prob
+//               i32 orientation, line id, paragraph id
+//               u32 char count, then per char u16 id, u16 prob (x 65535)
+//
+// <path>.idx  open-addressing hash table (linear probing, load <= 1/2) that is
+//             memory-mapped and updated in place; key 0 marks an empty slot
+//   header:   8-byte magic "OCRSIDX1", u32 capacity, u32 count, u64 log id,
+//             u64 covered log size, u64 live record bytes
+//   slot:     u64 key, u64 record offset
+//
+// Rewriting a key appends a new record and repoints its slot. The dead records
+// are dropped by compaction, which runs in bounded steps so the host can
+// spread it over idle time. A log written by another format version or model
+// is discarded on open. An index that is missing or belongs to another log is
+// rebuilt from the log, one that is behind it catches up, and a torn record at
+// the tail is cut off.
+class ResultStore {
+public:
+    ~ResultStore();
+
+    bool open(const char* path, uint64_t model_fingerprint);
+    void close();
+    bool is_open() const { return m_data != nullptr; }
+
+    // O(1): one probe sequence in the mapped index and one read from the log
+    bool get(uint64_t key, std::vector<Object>& objects);
+    bool put(uint64_t key, const std::vector<Object>& objects);
+
+    // Writes buffered records and the mapped index back to their files, so the
+    // host can copy them
+    void flush();
+
+    // Runs compaction for about `budget_ms`; returns true while work remains.
+    // Starts only once dead records outweigh live ones.
+    bool compact_step(double budget_ms);
+
+    size_t records() const;
+    uint64_t log_bytes() const { return m_data_size; }
+    uint64_t live_bytes() const;
+    // Lookups since open
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+
+    static const uint32_t FORMAT_VERSION = 1;
+
+private:
+    struct IndexHeader;
+    struct Slot;
+
+    IndexHeader* header() const;
+    Slot* slots() const;
+    // Maps an existing index of this log; false if there is none or it does not match
+    bool load_index(uint64_t log_id);
+    // Maps a new, empty index with `capacity` slots (a power of two)
+    bool create_index(uint32_t capacity, uint64_t log_id);
+    void unmap_index();
+    Slot* find_slot(uint64_t key) const;
+    bool insert(uint64_t key, uint64_t offset, uint64_t record_bytes);
+    // Reads the record at `offset`; false if it is truncated or corrupt
+    bool read_record(FILE* f, uint64_t offset, uint64_t file_size, std::vector<unsigned char>& body) const;
+    // Indexes log records from `from` to the end, cutting off a torn tail
+    bool scan_log(uint64_t from);
+    void abort_compaction();
+    bool finish_compaction();
+
+    std::string m_path;
+    uint64_t m_model_fingerprint = 0;
+    FILE* m_data = nullptr;
+    uint64_t m_data_size = 0;
+
+    int m_index_fd = -1;
+    unsigned char* m_index = nullptr; // mapped header + slots
+    size_t m_index_bytes = 0;
+
+    // Incremental compaction: live records are copied into <path>.compact, and
+    // their new offsets are collected until the copy reaches the end of the log
+    // (records appended meanwhile included); then the files are swapped.
+    FILE* m_compact = nullptr;
+    uint64_t m_compact_log_id = 0;
+    uint64_t m_compact_cursor = 0;
+    uint64_t m_compact_size = 0;
+    std::vector<uint64_t> m_compact_offsets; // key, new offset, record bytes
+
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+};
+
+#endif // RESULT_STORE_H
@@ -0,0 +1,375 @@
+#include "text_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+static const size_t INITIAL_TABLE_SIZE = 1024;
+static const int MAX_BLOCK_LEVEL = 5; // 512-byte blocks
+static const uint32_t BLOCK_HEADER = 4; // u32 offset of the next block, 0 = last
+static const size_t REBUILD_MIN_DEAD = 1024;
+static const uint16_t NO_CHAR = 0xFFFF;
+static const uint32_t SINGLE_LINE = 0x80000000u; // slot value holds the line id itself
+
+static inline uint64_t bigram_key(uint16_t a, uint16_t b)
+{
+    return (2ULL << 60) | ((uint64_t)a << 16) | b;
+}
+
+static inline uint64_t trigram_key(uint16_t a, uint16_t b, uint16_t c)
+{
+    return (3ULL << 60) | ((uint64_t)a << 32) | ((uint64_t)b << 16) | c;
+}
+
+static inline size_t slot_hash(uint64_t key)
+{
+    uint64_t h = key * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(h ^ (h >> 32));
+}
+
+static inline uint32_t block_bytes(int level)
+{
+    return 16u << level;
+}
+
+namespace {
+
+// Walks a posting list. Values are varints of the gap to the previous line id
+// (the first one is line id + 1), so every value is >= 1 and a zero byte marks
+// the unused end of a block. A value never straddles two blocks.
+class ListReader {
+public:
+    ListReader(const uint8_t* arena, uint32_t head)
+        : m_arena(arena)
+        , m_block(head)
+    {
+        enter_block();
+    }
+
+    bool next(uint32_t& line)
+    {
+        while (m_p == m_end || !*m_p) {
+            uint32_t next_block;
+            memcpy(&next_block, m_arena + m_block, sizeof(next_block));
+            if (!next_block) return false;
+            m_block = next_block;
+            m_level = std::min(m_level + 1, MAX_BLOCK_LEVEL);
+            enter_block();
+        }
+        uint32_t v = 0;
+        int shift = 0;
+        uint8_t b;
+        do {
+            b = *m_p++;
+            v |= (uint32_t)(b & 0x7F) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        m_line += v;
+        line = m_line;
+        return true;
+    }
+
+private:
+    void enter_block()
+    {
+        m_p = m_arena + m_block + BLOCK_HEADER;
+        m_end = m_arena + m_block + block_bytes(m_level);
+    }
+
+    const uint8_t* m_arena;
+    uint32_t m_block;
+    int m_level = 0;
+    const uint8_t* m_p = nullptr;
+    const uint8_t* m_end = nullptr;
+    uint32_t m_line = UINT32_MAX; // wraps to the first line id
+};
+
+} // namespace
+
+TextIndex::TextIndex()
+{
+    clear();
+}
+
+void TextIndex::clear()
+{
+    std::vector<Line>().swap(m_lines);
+    std::vector<uint8_t>().swap(m_dead);
+    std::vector<uint16_t>().swap(m_text);
+    m_image_lines.clear();
+    m_live_lines = 0;
+    std::vector<uint64_t>(INITIAL_TABLE_SIZE, 0).swap(m_keys);
+    std::vector<uint32_t>(INITIAL_TABLE_SIZE, 0).swap(m_values);
+    m_grams = 0;
+    std::vector<PostingList>().swap(m_lists);
+    std::vector<uint8_t>(BLOCK_HEADER, 0).swap(m_arena);
+    m_postings = 0;
+}
+
+bool TextIndex::find_gram(uint64_t key, uint32_t& value) const
+{
+    const size_t mask = m_keys.size() - 1;
+    for (size_t i = slot_hash(key) & mask; m_keys[i]; i = (i + 1) & mask) {
+        if (m_keys[i] == key) {
+            value = m_values[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+void TextIndex::grow_table()
+{
+    std::vector<uint64_t> keys(m_keys.size() * 2, 0);
+    std::vector<uint32_t> values(keys.size(), 0);
+    const size_t mask = keys.size() - 1;
+    for (size_t s = 0; s < m_keys.size(); s++) {
+        if (!m_keys[s]) continue;
+        size_t i = slot_hash(m_keys[s]) & mask;
+        while (keys[i]) i = (i + 1) & mask;
+        keys[i] = m_keys[s];
+        values[i] = m_values[s];
+    }
+    m_keys.swap(keys);
+    m_values.swap(values);
+}
+
+uint32_t TextIndex::alloc_block(int level)
+{
+    const uint32_t offset = (uint32_t)m_arena.size();
+    m_arena.resize(m_arena.size() + block_bytes(level), 0);
+    return offset;
+}
+
+void TextIndex::post(uint64_t key, uint32_t line)
+{
+    if ((m_grams + 1) * 4 > m_keys.size() * 3) grow_table();
+    const size_t mask = m_keys.size() - 1;
+    size_t i = slot_hash(key) & mask;
+    while (m_keys[i] && m_keys[i] != key) i = (i + 1) & mask;
+
+    if (!m_keys[i]) {
+        m_keys[i] = key;
+        m_values[i] = SINGLE_LINE | line;
+        m_grams++;
+        m_postings++;
+        return;
+    }
+    if (m_values[i] & SINGLE_LINE) {
+        // Second line of this gram: move both into a list
+        const uint32_t first = m_values[i] & ~SINGLE_LINE;
+        if (first == line) return;
+        const uint32_t block = alloc_block(0);
+        m_values[i] = (uint32_t)m_lists.size();
+        m_lists.push_back({ block, block, 0, 0, 0, 0 });
+        append(m_lists.back(), first);
+        m_postings--;
+    }
+    append(m_lists[m_values[i]], line);
+}
+
+void TextIndex::append(PostingList& list, uint32_t line)
+{
+    if (list.count && list.last_line == line) return; // gram repeats within the line
+
+    uint32_t v = list.count ? line - list.last_line : line + 1;
+    uint8_t buf[5];
+    size_t n = 0;
+    do {
+        const uint8_t b = v & 0x7F;
+        v >>= 7;
+        buf[n++] = b | (v ? 0x80 : 0);
+    } while (v);
+
+    if (list.tail_used + n > block_bytes(list.tail_level) - BLOCK_HEADER) {
+        const int level = std::min(list.tail_level + 1, MAX_BLOCK_LEVEL);
+        const uint32_t block = alloc_block(level);
+        memcpy(&m_arena[list.tail], &block, sizeof(block));
+        list.tail = block;
+        list.tail_level = (uint16_t)level;
+        list.tail_used = 0;
+    }
+    memcpy(&m_arena[list.tail + BLOCK_HEADER + list.tail_used], buf, n);
+    list.tail_used += (uint16_t)n;
+    list.last_line = line;
+    list.count++;
+    m_postings++;
+}
+
+uint32_t TextIndex::gram_lines(uint32_t value) const
+{
+    return value & SINGLE_LINE ? 1 : m_lists[value].count;
+}
+
+void TextIndex::decode(uint32_t value, std::vector<uint32_t>& lines) const
+{
+    lines.clear();
+    if (value & SINGLE_LINE) {
+        lines.push_back(value & ~SINGLE_LINE);
+        return;
+    }
+    lines.reserve(m_lists[value].count);
+    ListReader reader(m_arena.data(), m_lists[value].head);
+    uint32_t line;
+    while (reader.next(line)) lines.push_back(line);
+}
+
+void TextIndex::intersect(uint32_t value, std::vector<uint32_t>& lines) const
+{
+    if (value & SINGLE_LINE) {
+        const uint32_t only = value & ~SINGLE_LINE;
+        const bool found = std::binary_search(lines.begin(), lines.end(), only);
+        lines.assign(found ? 1 : 0, only);
+        return;
+    }
+    ListReader reader(m_arena.data(), m_lists[value].head);
+    size_t kept = 0, i = 0;
+    uint32_t line;
+    while (i < lines.size() && reader.next(line)) {
+        while (i < lines.size() && lines[i] < line) i++;
+        if (i < lines.size() && lines[i] == line) lines[kept++] = lines[i++];
+    }
+    lines.resize(kept);
+}
+
+void TextIndex::index_line(uint32_t line)
+{
+    const Line& l = m_lines[line];
+    const uint16_t* t = m_text.data() + l.text_offset;
+    for (uint32_t i = 0; i + 1 < l.length; i++) {
+        if (t[i] == NO_CHAR || t[i + 1] == NO_CHAR) continue;
+        post(bigram_key(t[i], t[i + 1]), line);
+        if (i + 2 < l.length && t[i + 2] != NO_CHAR) post(trigram_key(t[i], t[i + 1], t[i + 2]), line);
+    }
+}
+
+void TextIndex::add(uint32_t image_id, uint32_t box_id, const int* ids, size_t count)
+{
+    const uint32_t line = (uint32_t)m_lines.size();
+    m_lines.push_back({ image_id, box_id, (uint32_t)m_text.size(), (uint32_t)count });
+    for (size_t i = 0; i < count; i++) m_text.push_back(ids[i] >= 0 && ids[i] < NO_CHAR ? (uint16_t)ids[i] : NO_CHAR);
+    m_dead.push_back(0);
+    m_image_lines[image_id].push_back(line);
+    m_live_lines++;
+    index_line(line);
+}
+
+size_t TextIndex::remove(uint32_t image_id)
+{
+    auto it = m_image_lines.find(image_id);
+    if (it == m_image_lines.end()) return 0;
+    const size_t removed = it->second.size();
+    for (uint32_t line : it->second) m_dead[line] = 1;
+    m_image_lines.erase(it);
+    m_live_lines -= removed;
+
+    const size_t dead = m_lines.size() - m_live_lines;
+    if (dead > m_live_lines && dead >= REBUILD_MIN_DEAD) rebuild();
+    return removed;
+}
+
+void TextIndex::rebuild()
+{
+    std::vector<Line> lines;
+    std::vector<uint8_t> dead;
+    std::vector<uint16_t> text;
+    lines.swap(m_lines);
+    dead.swap(m_dead);
+    text.swap(m_text);
+    clear();
+
+    // Live lines keep their order, so search results keep theirs
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (dead[i]) continue;
+        Line l = lines[i];
+        const uint32_t line = (uint32_t)m_lines.size();
+        const uint16_t* t = text.data() + l.text_offset;
+        l.text_offset = (uint32_t)m_text.size();
+        m_text.insert(m_text.end(), t, t + l.length);
+        m_lines.push_back(l);
+        m_dead.push_back(0);
+        m_image_lines[l.image_id].push_back(line);
+        m_live_lines++;
+        index_line(line);
+    }
+}
+
+bool TextIndex::match(uint32_t line, const uint16_t* phrase, size_t count, uint32_t& position) const
+{
+    const Line& l = m_lines[line];
+    const uint16_t* begin = m_text.data() + l.text_offset;
+    const uint16_t* end = begin + l.length;
+    const uint16_t* found = std::search(begin, end, phrase, phrase + count);
+    if (found == end) return false;
+    position = (uint32_t)(found - begin);
+    return true;
+}
+
+std::vector<TextHit> TextIndex::search(const int* ids, size_t count, size_t limit) const
+{
+    std::vector<TextHit> hits;
+    if (count == 0) return hits;
+    std::vector<uint16_t> phrase(count);
+    for (size_t i = 0; i < count; i++) {
+        if (ids[i] < 0 || ids[i] >= NO_CHAR) return hits;
+        phrase[i] = (uint16_t)ids[i];
+    }
+
+    // false once the limit is reached
+    auto emit = [&](uint32_t line) {
+        uint32_t position;
+        if (m_dead[line] || !match(line, phrase.data(), count, position)) return true;
+        hits.push_back({ m_lines[line].image_id, m_lines[line].box_id, position });
+        return limit == 0 || hits.size() < limit;
+    };
+
+    if (count == 1) {
+        for (uint32_t line = 0; line < (uint32_t)m_lines.size(); line++) {
+            if (!emit(line)) break;
+        }
+        return hits;
+    }
+
+    std::vector<uint32_t> grams;
+    for (size_t i = 0; i == 0 || i + 2 < count; i++) {
+        const uint64_t key
+            = count == 2 ? bigram_key(phrase[0], phrase[1]) : trigram_key(phrase[i], phrase[i + 1], phrase[i + 2]);
+        uint32_t value;
+        if (!find_gram(key, value)) return hits;
+        grams.push_back(value);
+    }
+    std::sort(grams.begin(), grams.end(), [this](uint32_t a, uint32_t b) {
+        const uint32_t na = gram_lines(a), nb = gram_lines(b);
+        return na != nb ? na < nb : a < b;
+    });
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+    // Three lists narrow the candidates enough; the phrase check does the rest
+    std::vector<uint32_t> candidates;
+    decode(grams[0], candidates);
+    for (size_t k = 1; k < std::min<size_t>(3, grams.size()) && !candidates.empty(); k++) {
+        intersect(grams[k], candidates);
+    }
+    for (uint32_t line : candidates) {
+        if (!emit(line)) break;
+    }
+    return hits;
+}
+
+size_t TextIndex::memory_bytes() const
+{
+    size_t bytes = m_lines.capacity() * sizeof(Line) + m_dead.capacity() + m_text.capacity() * sizeof(uint16_t)
+        + m_keys.capacity() * sizeof(uint64_t) + m_values.capacity() * sizeof(uint32_t)
+        + m_lists.capacity() * sizeof(PostingList) + m_arena.capacity();
+    for (const auto& entry : m_image_lines) bytes += sizeof(entry) + entry.second.capacity() * sizeof(uint32_t);
+    return bytes;
+}
+
+std::string TextIndex::stats_json() const
+{
+    std::ostringstream ss;
+    ss << "{\"lines\":" << m_live_lines << ",\"dead_lines\":" << (m_lines.size() - m_live_lines)
+       << ",\"images\":" << m_image_lines.size() << ",\"grams\":" << m_grams << ",\"postings\":" << m_postings
+       << ",\"posting_bytes\":" << m_arena.size() << ",\"memory_bytes\":" << memory_bytes() << "}";
+    return ss.str();
+}
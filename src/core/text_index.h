@@ -0,0 +1,99 @@
+#ifndef TEXT_INDEX_H
+#define TEXT_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One phrase occurrence: the box's position in its image's result array and
+// the character offset of the first match in it
+struct TextHit {
+    uint32_t image_id;
+    uint32_t box_id;
+    uint32_t position;
+};
+
+// Phrase search over recognized lines, keyed by character id so CJK text
+// needs neither tokenizing nor UTF-8. Every line is posted under each of its
+// character bigrams and trigrams. A posting list holds the ids of the lines
+// that contain the gram, in ascending order, as varint deltas.
+//
+// A gram found in a single line keeps that line id in its hash slot. Longer
+// lists live in one arena as chains of blocks that double in size up to 512
+// bytes, so appending never copies. Lines get increasing ids, so adding is
+// append-only. Removing marks lines dead; once dead lines outnumber live
+// ones, the index is rebuilt from the live ones.
+//
+// A query is answered from the rarest of its grams (the bigram for two
+// characters, up to three trigrams otherwise), then each candidate line is
+// checked for the whole phrase. One-character queries scan the line texts.
+class TextIndex {
+public:
+    TextIndex();
+
+    // Ids must be below 0xFFFF; others are kept but never match
+    void add(uint32_t image_id, uint32_t box_id, const int* ids, size_t count);
+    // Removes every line of the image; returns how many there were
+    size_t remove(uint32_t image_id);
+    void clear();
+
+    // Occurrences of the phrase, at most one per line, in the order the lines
+    // were added. Stops after `limit` hits (0 = no limit).
+    std::vector<TextHit> search(const int* ids, size_t count, size_t limit = 0) const;
+
+    size_t lines() const { return m_live_lines; }
+    size_t images() const { return m_image_lines.size(); }
+    size_t grams() const { return m_grams; }
+    // Heap bytes of the text, posting lists and tables
+    size_t memory_bytes() const;
+    std::string stats_json() const;
+
+private:
+    struct Line {
+        uint32_t image_id;
+        uint32_t box_id;
+        uint32_t text_offset;
+        uint32_t length;
+    };
+
+    struct PostingList {
+        uint32_t head; // arena offset of the first block
+        uint32_t tail;
+        uint32_t last_line; // most recent line id appended
+        uint32_t count;
+        uint16_t tail_used; // payload bytes used in the tail block
+        uint16_t tail_level; // the tail block holds 16 << level bytes
+    };
+
+    // Slot value of `key`: a list index, or SINGLE_LINE | line id
+    bool find_gram(uint64_t key, uint32_t& value) const;
+    void post(uint64_t key, uint32_t line);
+    void grow_table();
+    uint32_t alloc_block(int level);
+    void append(PostingList& list, uint32_t line);
+    uint32_t gram_lines(uint32_t value) const;
+    void decode(uint32_t value, std::vector<uint32_t>& lines) const;
+    // Keeps the entries of `lines` that are also posted under `value`
+    void intersect(uint32_t value, std::vector<uint32_t>& lines) const;
+    void index_line(uint32_t line);
+    bool match(uint32_t line, const uint16_t* phrase, size_t count, uint32_t& position) const;
+    void rebuild();
+
+    std::vector<Line> m_lines; // indexed by line id
+    std::vector<uint8_t> m_dead; // per line id
+    std::vector<uint16_t> m_text; // character ids of every line, back to back
+    std::unordered_map<uint32_t, std::vector<uint32_t>> m_image_lines;
+    size_t m_live_lines = 0;
+
+    // Open addressing over gram keys (0 = empty), load <= 3/4
+    std::vector<uint64_t> m_keys;
+    std::vector<uint32_t> m_values;
+    size_t m_grams = 0;
+    std::vector<PostingList> m_lists;
+    std::vector<uint8_t> m_arena; // offset 0 is reserved as "no block"
+    uint64_t m_postings = 0;
+};
+
+#endif // TEXT_INDEX_H
@@ -0,0 +1,14 @@
+// Pre-js for the threads variants: sizes the pthread pool from the host's
+// core count unless the module factory was given `pthreadPoolSize`. The pool
+// cannot grow while a thread blocks on it, so the engine's thread budget
+// (`_set_num_threads`) must stay within this size. The detect job thread
+// (`_submit_detect`) takes one slot of its own.
+if (!Module['pthreadPoolSize']) {
+  var hostCores = (typeof navigator !== 'undefined' && navigator.hardwareConcurrency) || 0;
+  if (!hostCores && typeof process === 'object' && process.versions && process.versions.node) {
+    hostCores = require('os').cpus().length;
+  }
+  hostCores = hostCores || 4;
+  // Every pool worker instantiates the module, so very wide hosts are capped
+  Module['pthreadPoolSize'] = Math.max(1, Math.min(hostCores, 8));
+}
@@ -0,0 +1,92 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace trace {
+
+std::atomic<bool> g_enabled { false };
+
+namespace {
+
+    struct Event {
+        const char* name;
+        Clock::time_point begin;
+        Clock::time_point end;
+        int tid;
+        int arg;
+    };
+
+    std::vector<Event> g_events;
+    std::atomic<unsigned long long> g_next { 0 };
+    std::atomic<int> g_next_tid { 0 };
+    Clock::time_point g_origin;
+    int g_engine_tid = 0;
+
+    // Small stable ids in order of first use; OpenMP thread numbers are per team
+    int thread_id()
+    {
+        thread_local int tid = g_next_tid.fetch_add(1, std::memory_order_relaxed);
+        return tid;
+    }
+
+} // namespace
+
+void start(size_t capacity)
+{
+    g_enabled.store(false, std::memory_order_relaxed);
+    g_events.assign(std::max<size_t>(capacity, 1), Event());
+    g_next.store(0, std::memory_order_relaxed);
+    g_origin = Clock::now();
+    g_engine_tid = thread_id();
+    g_enabled.store(true, std::memory_order_release);
+}
+
+void stop() { g_enabled.store(false, std::memory_order_release); }
+
+void record(const char* name, Clock::time_point begin, Clock::time_point end, int arg)
+{
+    if (g_events.empty()) return;
+    unsigned long long slot = g_next.fetch_add(1, std::memory_order_relaxed) % g_events.size();
+    g_events[slot] = { name, begin, end, thread_id(), arg };
+}
+
+std::string export_json()
+{
+    const unsigned long long written = g_next.load(std::memory_order_acquire);
+    const size_t count = (size_t)std::min<unsigned long long>(written, g_events.size());
+
+    std::vector<const Event*> events;
+    events.reserve(count);
+    for (size_t i = 0; i < count; i++) events.push_back(&g_events[i]);
+    std::sort(events.begin(), events.end(), [](const Event* a, const Event* b) { return a->begin < b->begin; });
+
+    auto us = [](Clock::duration d) { return std::chrono::duration<double, std::micro>(d).count(); };
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":" << (written - count) << "},\"traceEvents\":[";
+    int max_tid = -1;
+    bool first = true;
+    for (const Event* e : events) {
+        if (!first) ss << ",";
+        first = false;
+        ss << "{\"name\":\"" << e->name << "\",\"cat\":\"ocr\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e->tid
+           << ",\"ts\":" << us(e->begin - g_origin) << ",\"dur\":" << us(e->end - e->begin);
+        if (e->arg >= 0) ss << ",\"args\":{\"index\":" << e->arg << "}";
+        ss << "}";
+        max_tid = std::max(max_tid, e->tid);
+    }
+    for (int tid = 0; tid <= max_tid; tid++) {
+        if (!first) ss << ",";
+        first = false;
+        ss << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":\""
+           << (tid == g_engine_tid ? "engine" : "worker " + std::to_string(tid)) << "\"}}";
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+} // namespace trace
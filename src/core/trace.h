@@ -0,0 +1,57 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// Chrome/Perfetto trace-event recording. Each event is a complete ("X")
+// begin/end pair tagged with the recording thread, written to a fixed-size
+// ring buffer that overwrites its oldest entries. While tracing is off a scope
+// costs one relaxed atomic load. Start, stop and export from the thread that
+// drives the engine, between calls.
+namespace trace {
+
+using Clock = std::chrono::steady_clock;
+
+extern std::atomic<bool> g_enabled;
+
+inline bool enabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+// Clears the buffer and starts recording into `capacity` events
+void start(size_t capacity = 1 << 16);
+void stop();
+// `name` must outlive the trace (string literals). `arg` >= 0 is exported as args.index.
+void record(const char* name, Clock::time_point begin, Clock::time_point end, int arg = -1);
+// Trace-event JSON for chrome://tracing or ui.perfetto.dev
+std::string export_json();
+
+class Scope {
+public:
+    explicit Scope(const char* name, int arg = -1)
+        : m_name(name)
+        , m_arg(arg)
+        , m_active(enabled())
+    {
+        if (m_active) m_begin = Clock::now();
+    }
+
+    ~Scope()
+    {
+        if (m_active) record(m_name, m_begin, Clock::now(), m_arg);
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* m_name;
+    int m_arg;
+    bool m_active;
+    Clock::time_point m_begin;
+};
+
+} // namespace trace
+
+#endif // TRACE_H
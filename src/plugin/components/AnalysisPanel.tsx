@@ -1,5 +1,6 @@
 import React, { useState, useRef } from 'react';
 import { Header } from './Header';
+import { LatencyStats } from './LatencyStats';
 import { ImagePreview } from './ImagePreview';
 import { ResultList } from './ResultList';
 
@@ -48,6 +49,7 @@ export const AnalysisPanel: React.FC = () => {
       }}
     >
       <Header />
+      <LatencyStats />
 
       {/* Top Pane: Image Preview */}
       <div style={{ flex: 1, position: 'relative', overflow: 'hidden' }}>
@@ -0,0 +1,83 @@
+import React from 'react';
+import { useAnalysisStore } from '../models/store';
+import type { LatencySummary } from '../services/OcrEngine';
+
+const STAGES: [string, string][] = [
+  ['det_preprocess', 'Det pre'],
+  ['det_inference', 'Det infer'],
+  ['det_postprocess', 'Det post'],
+  ['rec_preprocess', 'Rec pre'],
+  ['rec_inference', 'Rec infer'],
+  ['rec_decode', 'Rec decode'],
+  ['layout', 'Layout'],
+];
+
+function fmt(value: number, digits = 1): string {
+  return value.toFixed(value >= 100 ? 0 : digits);
+}
+
+// Debug view: session p50/p99 reported by the engine's rolling histograms
+export const LatencyStats: React.FC = () => {
+  const { showLatencyStats, latencyStats } = useAnalysisStore();
+  if (!showLatencyStats || !latencyStats || latencyStats.total_ms.count === 0)
+    return null;
+
+  const rows: [string, LatencySummary, string][] = [
+    ['Total', latencyStats.total_ms, 'ms'],
+    // Only jobs queue; synchronous detect calls record nothing here
+    ...(latencyStats.queue_ms?.count
+      ? [['Queue wait', latencyStats.queue_ms, 'ms'] as [
+          string,
+          LatencySummary,
+          string,
+        ]]
+      : []),
+    ...STAGES.filter(([key]) => latencyStats.stages_ms[key]).map(
+      ([key, label]): [string, LatencySummary, string] => [
+        label,
+        latencyStats.stages_ms[key],
+        'ms',
+      ],
+    ),
+    ['Boxes / image', latencyStats.boxes_per_image, ''],
+    ['Rec width', latencyStats.rec_width_px, 'px'],
+  ];
+
+  return (
+    <div
+      className="ocr-latency-stats"
+      style={{
+        padding: '0 10px 10px 10px',
+        fontSize: '0.75em',
+        color: 'var(--text-muted)',
+      }}
+    >
+      <table style={{ width: '100%', borderCollapse: 'collapse' }}>
+        <thead>
+          <tr>
+            <th style={{ textAlign: 'left' }}>
+              {latencyStats.total_ms.count} calls
+            </th>
+            <th style={{ textAlign: 'right' }}>p50</th>
+            <th style={{ textAlign: 'right' }}>p99</th>
+          </tr>
+        </thead>
+        <tbody>
+          {rows.map(([label, summary, unit]) => (
+            <tr key={label}>
+              <td>{label}</td>
+              <td style={{ textAlign: 'right' }}>
+                {fmt(summary.p50)}
+                {unit}
+              </td>
+              <td style={{ textAlign: 'right' }}>
+                {fmt(summary.p99)}
+                {unit}
+              </td>
+            </tr>
+          ))}
+        </tbody>
+      </table>
+    </div>
+  );
+};
@@ -14,7 +14,10 @@ function processResults(
 
   let sorted = [...results];
 
-  if (!disableSort) {
+  // The engine already returns boxes in reading order with paragraph ids
+  const hasLayout = results.every((r) => r.paragraph !== undefined);
+
+  if (!disableSort && !hasLayout) {
     // 1. Robust Sort (Y-banding then X)
     let totalH = 0;
     results.forEach((r) => {
@@ -57,7 +60,9 @@ function processResults(
     const isList = /^[-*•]\s/.test(curr.text) || /^\d+\.\s/.test(curr.text);
 
     let isGap = false;
-    if (!disableSort) {
+    if (!disableSort && hasLayout) {
+      isGap = curr.paragraph !== prev.paragraph;
+    } else if (!disableSort) {
       const prevBottom = Math.max(...prev.box.map((p) => p[1]));
       const currTop = Math.min(...curr.box.map((p) => p[1]));
       const h =
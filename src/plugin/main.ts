@@ -10,10 +10,14 @@ export default class OcrPlugin extends Plugin {
   public ocrEngine: OcrEngine | null = null;
   settings: OcrSettings;
   private lastPasteTime = 0;
+  public isCapturing = false;
 
   async onload() {
     await this.loadSettings();
     useAnalysisStore.getState().setMergeLines(this.settings.autoMergeLines);
+    useAnalysisStore
+      .getState()
+      .setShowLatencyStats(this.settings.showLatencyStats);
 
     this.ocrEngine = new OcrEngine(this.app, this.manifest.dir);
     // Apply initial settings (threshold)
@@ -306,6 +310,13 @@ export default class OcrPlugin extends Plugin {
             ocrResults: results,
           });
           processedCount++;
+
+          if (this.settings.showLatencyStats) {
+            void this.ocrEngine
+              .getStats()
+              .then((stats) => store.setLatencyStats(stats))
+              .catch((err) => console.error('[OcrPlugin] Stats error:', err));
+          }
         } catch (e) {
           console.error(e);
           store.updateItem(currentItem.id, {
@@ -539,11 +550,42 @@ export default class OcrPlugin extends Plugin {
   }
 
   async applySettings() {
+    useAnalysisStore
+      .getState()
+      .setShowLatencyStats(this.settings.showLatencyStats);
     if (this.ocrEngine) {
       await this.ocrEngine.setThreshold(this.settings.textConfidenceThreshold);
     }
   }
 
+  async startCapture() {
+    if (!this.ocrEngine) throw new Error('OCR engine not available');
+    const mode = this.settings.capturePixels;
+    await this.ocrEngine.startCapture(
+      mode !== 'hash',
+      mode === 'downscaled' ? 1024 : 0,
+    );
+    this.isCapturing = true;
+  }
+
+  // Writes the capture into <plugin dir>/captures and returns its path
+  async stopCapture(): Promise<string> {
+    if (!this.ocrEngine) throw new Error('OCR engine not available');
+    const data = await this.ocrEngine.stopCapture();
+    this.isCapturing = false;
+
+    const dir = `${this.manifest.dir}/captures`;
+    const adapter = this.app.vault.adapter;
+    if (!(await adapter.exists(dir))) await adapter.mkdir(dir);
+    const stamp = new Date().toISOString().replace(/[:.]/g, '-');
+    const path = `${dir}/capture-${stamp}.ocrcap`;
+    await adapter.writeBinary(
+      path,
+      data.buffer.slice(data.byteOffset, data.byteOffset + data.byteLength),
+    );
+    return path;
+  }
+
   async activateView() {
     const { workspace } = this.app;
 
@@ -562,6 +604,7 @@ export default class OcrPlugin extends Plugin {
   }
 
   onunload() {
-    // Cleanup if needed
+    // Flushes the result store before the worker stops
+    void this.ocrEngine?.terminate();
   }
 }
@@ -1,6 +1,6 @@
 import { create } from 'zustand';
 import type { TFile } from 'obsidian';
-import { OcrResultItem } from '../services/OcrEngine';
+import { EngineLatencyStats, OcrResultItem } from '../services/OcrEngine';
 
 export interface SelectionAnchor {
   boxIndex: number;
@@ -25,6 +25,10 @@ interface AnalysisState {
   activeRange: { start: SelectionAnchor; end: SelectionAnchor } | null;
   mergeLines: boolean;
 
+  // Debug: engine latency percentiles, shown when enabled in settings
+  showLatencyStats: boolean;
+  latencyStats: EngineLatencyStats | null;
+
   // Caching
   resultsCache: Map<string, AnalysisItem[]>;
   sourceId: string | null;
@@ -40,6 +44,8 @@ interface AnalysisState {
   ) => void;
   clearSelection: () => void;
   setMergeLines: (merge: boolean) => void;
+  setShowLatencyStats: (show: boolean) => void;
+  setLatencyStats: (stats: EngineLatencyStats | null) => void;
 
   setSourceId: (id: string | null) => void;
   saveToCache: (sourceId: string, items: AnalysisItem[]) => void;
@@ -56,6 +62,8 @@ export const useAnalysisStore = create<AnalysisState>((set, get) => ({
   selectedIndices: [],
   activeRange: null,
   mergeLines: false,
+  showLatencyStats: false,
+  latencyStats: null,
   resultsCache: new Map(),
   sourceId: null,
 
@@ -110,6 +118,10 @@ export const useAnalysisStore = create<AnalysisState>((set, get) => ({
 
   setMergeLines: (merge) => set({ mergeLines: merge }),
 
+  setShowLatencyStats: (show) => set({ showLatencyStats: show }),
+
+  setLatencyStats: (stats) => set({ latencyStats: stats }),
+
   setSourceId: (id) => set({ sourceId: id }),
 
   saveToCache: (sourceId, items) =>
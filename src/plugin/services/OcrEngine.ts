@@ -1,15 +1,54 @@
 import { App, requestUrl } from 'obsidian';
 // @ts-ignore
 import workerCode from 'worker:ocr';
-import type { WorkerResponse } from '../worker/ocr-worker';
+import type {
+  DetectPriority,
+  StoreFiles,
+  WorkerResponse,
+} from '../worker/ocr-worker';
 
 const GITHUB_ORG = 'Kuro96';
 const GITHUB_REPO = 'obsidian-wasm-ocr';
 
+// Results of earlier detect calls, kept next to the models
+const RESULT_STORE_FILE = 'results.ocrstore';
+// Quiet time after the last detect call before the store is written back
+const RESULT_STORE_SAVE_DELAY_MS = 10000;
+
 export interface OcrResultItem {
   box: [[number, number], [number, number], [number, number], [number, number]];
   text: string;
   prob: number;
+  // Reading-order line / paragraph ids assigned by the engine's layout stage
+  line?: number;
+  paragraph?: number;
+}
+
+// Rolling distribution reported by the engine (see get_latency_stats)
+export interface LatencySummary {
+  count: number;
+  mean: number;
+  min: number;
+  p50: number;
+  p90: number;
+  p99: number;
+  max: number;
+}
+
+export interface EngineLatencyStats {
+  total_ms: LatencySummary;
+  stages_ms: Record<string, LatencySummary>;
+  // Time async jobs waited before starting (threads builds only)
+  queue_ms: LatencySummary;
+  boxes_per_image: LatencySummary;
+  rec_width_px: LatencySummary;
+}
+
+function toArrayBuffer(data: Uint8Array): ArrayBuffer {
+  return data.buffer.slice(
+    data.byteOffset,
+    data.byteOffset + data.byteLength,
+  ) as ArrayBuffer;
 }
 
 export class OcrEngine {
@@ -24,6 +63,27 @@ export class OcrEngine {
     number,
     { resolve: (res: OcrResultItem[]) => void; reject: (err: Error) => void }
   >();
+  private pendingStats = new Map<
+    number,
+    {
+      resolve: (stats: EngineLatencyStats) => void;
+      reject: (err: Error) => void;
+    }
+  >();
+  private pendingCaptures = new Map<
+    number,
+    { resolve: (data: Uint8Array) => void; reject: (err: Error) => void }
+  >();
+  private pendingCaptureStarts = new Map<
+    number,
+    { resolve: () => void; reject: (err: Error) => void }
+  >();
+  private pendingStores = new Map<
+    number,
+    { resolve: (store: StoreFiles) => void; reject: (err: Error) => void }
+  >();
+  private storeSaveTimer: number | null = null;
+  private storeSave: Promise<void> | null = null; // save in flight
   private nextRequestId = 1;
 
   constructor(app: App, manifestDir: string) {
@@ -61,12 +121,59 @@ export class OcrEngine {
                 req.resolve(msg.results);
                 this.pendingRequests.delete(msg.id);
               }
+              this.scheduleStoreSave();
             } else if (msg.type === 'detect-error') {
               const req = this.pendingRequests.get(msg.id);
               if (req) {
                 req.reject(new Error(msg.error));
                 this.pendingRequests.delete(msg.id);
               }
+            } else if (msg.type === 'stats-success') {
+              const req = this.pendingStats.get(msg.id);
+              if (req) {
+                req.resolve(msg.stats);
+                this.pendingStats.delete(msg.id);
+              }
+            } else if (msg.type === 'stats-error') {
+              const req = this.pendingStats.get(msg.id);
+              if (req) {
+                req.reject(new Error(msg.error));
+                this.pendingStats.delete(msg.id);
+              }
+            } else if (msg.type === 'capture-started') {
+              const req = this.pendingCaptureStarts.get(msg.id);
+              if (req) {
+                req.resolve();
+                this.pendingCaptureStarts.delete(msg.id);
+              }
+            } else if (msg.type === 'capture-data') {
+              const req = this.pendingCaptures.get(msg.id);
+              if (req) {
+                req.resolve(msg.data);
+                this.pendingCaptures.delete(msg.id);
+              }
+            } else if (msg.type === 'capture-error') {
+              // Start and stop requests share the error reply
+              const req =
+                this.pendingCaptures.get(msg.id) ??
+                this.pendingCaptureStarts.get(msg.id);
+              if (req) {
+                req.reject(new Error(msg.error));
+                this.pendingCaptures.delete(msg.id);
+                this.pendingCaptureStarts.delete(msg.id);
+              }
+            } else if (msg.type === 'store-data') {
+              const req = this.pendingStores.get(msg.id);
+              if (req) {
+                req.resolve(msg.store);
+                this.pendingStores.delete(msg.id);
+              }
+            } else if (msg.type === 'store-error') {
+              const req = this.pendingStores.get(msg.id);
+              if (req) {
+                req.reject(new Error(msg.error));
+                this.pendingStores.delete(msg.id);
+              }
             }
           };
 
@@ -112,15 +219,21 @@ export class OcrEngine {
             }
           }
 
+          const store = await this.loadResultStore();
+
           // Send Init Message with Transfers
           // We need to collect buffers to transfer ownership
           const buffers = Object.values(loadedModels).map((arr) => arr.buffer);
+          if (store) {
+            buffers.push(store.data.buffer);
+            if (store.index) buffers.push(store.index.buffer);
+          }
 
           if (this.worker) {
             this.worker.postMessage(
               {
                 type: 'init',
-                payload: { models: loadedModels },
+                payload: { models: loadedModels, store },
               },
               buffers,
             ); // Transfer buffers!
@@ -202,13 +315,26 @@ export class OcrEngine {
     if (onProgress) onProgress('Download complete!');
   }
 
-  async detect(imageData: ImageData): Promise<OcrResultItem[]> {
+  // In threads builds the engine runs requests as jobs: `priority` orders them
+  // (default 'visible'), identical images in flight share one run, and
+  // aborting `signal` cancels the request, rejecting it with 'Cancelled'.
+  async detect(
+    imageData: ImageData,
+    options: { signal?: AbortSignal; priority?: DetectPriority } = {},
+  ): Promise<OcrResultItem[]> {
+    const { signal, priority } = options;
     await this.init();
     if (!this.worker) throw new Error('Worker failed to start');
+    if (signal?.aborted) throw new Error('Cancelled');
 
     return new Promise((resolve, reject) => {
       const id = this.nextRequestId++;
       this.pendingRequests.set(id, { resolve, reject });
+      signal?.addEventListener(
+        'abort',
+        () => this.worker?.postMessage({ type: 'cancel', id }),
+        { once: true },
+      );
 
       // Copy to ensure we have a clean buffer to transfer
       // NCNN expects RGBA.
@@ -222,6 +348,7 @@ export class OcrEngine {
             width: imageData.width,
             height: imageData.height,
             buffer: buffer,
+            priority,
           },
         },
         [buffer.buffer],
@@ -239,7 +366,119 @@ export class OcrEngine {
     });
   }
 
-  terminate() {
+  // Latency percentiles over the engine's recent calls in this session
+  async getStats(): Promise<EngineLatencyStats> {
+    await this.init();
+    if (!this.worker) throw new Error('Worker failed to start');
+
+    return new Promise((resolve, reject) => {
+      const id = this.nextRequestId++;
+      this.pendingStats.set(id, { resolve, reject });
+      this.worker.postMessage({ type: 'get-stats', id });
+    });
+  }
+
+  resetStats() {
+    if (!this.worker) return;
+    this.worker.postMessage({ type: 'reset-stats' });
+  }
+
+  // Record every detect call (input, options, timing) for offline replay.
+  // Pixels are stored downscaled to maxSide (0 = full size) or, with
+  // storePixels off, only as a hash.
+  // Resolves once the engine has opened the capture file.
+  async startCapture(storePixels: boolean, maxSide: number): Promise<void> {
+    await this.init();
+    if (!this.worker) throw new Error('Worker failed to start');
+
+    return new Promise((resolve, reject) => {
+      const id = this.nextRequestId++;
+      this.pendingCaptureStarts.set(id, { resolve, reject });
+      this.worker.postMessage({
+        type: 'start-capture',
+        id,
+        payload: { storePixels, maxSide },
+      });
+    });
+  }
+
+  // Ends the capture and returns the capture file contents
+  async stopCapture(): Promise<Uint8Array> {
+    await this.init();
+    if (!this.worker) throw new Error('Worker failed to start');
+
+    return new Promise((resolve, reject) => {
+      const id = this.nextRequestId++;
+      this.pendingCaptures.set(id, { resolve, reject });
+      this.worker.postMessage({ type: 'stop-capture', id });
+    });
+  }
+
+  // Reads the persisted result store, if any. A missing or stale index is
+  // rebuilt by the engine, so only the log itself is required.
+  private async loadResultStore(): Promise<StoreFiles | undefined> {
+    const adapter = this.app.vault.adapter;
+    const path = `${this.manifestDir}/${RESULT_STORE_FILE}`;
+    if (!(await adapter.exists(path))) return undefined;
+    const data = new Uint8Array(await adapter.readBinary(path));
+    const index = (await adapter.exists(path + '.idx'))
+      ? new Uint8Array(await adapter.readBinary(path + '.idx'))
+      : null;
+    return { data, index };
+  }
+
+  private scheduleStoreSave() {
+    if (this.storeSaveTimer !== null) window.clearTimeout(this.storeSaveTimer);
+    this.storeSaveTimer = window.setTimeout(() => {
+      this.storeSaveTimer = null;
+      this.saveResultStore().catch((e) =>
+        console.error('[OcrEngine] Saving result store failed:', e),
+      );
+    }, RESULT_STORE_SAVE_DELAY_MS);
+  }
+
+  // Compacts the engine's result store and writes it to the plugin directory
+  async saveResultStore(): Promise<void> {
+    if (!this.worker) return;
+    const save = this.writeResultStore(this.worker);
+    this.storeSave = save;
+    try {
+      await save;
+    } finally {
+      if (this.storeSave === save) this.storeSave = null;
+    }
+  }
+
+  private async writeResultStore(worker: Worker): Promise<void> {
+    const store = await new Promise<StoreFiles>((resolve, reject) => {
+      const id = this.nextRequestId++;
+      this.pendingStores.set(id, { resolve, reject });
+      worker.postMessage({ type: 'export-store', id });
+    });
+
+    const adapter = this.app.vault.adapter;
+    const path = `${this.manifestDir}/${RESULT_STORE_FILE}`;
+    await adapter.writeBinary(path, toArrayBuffer(store.data));
+    if (store.index)
+      await adapter.writeBinary(path + '.idx', toArrayBuffer(store.index));
+  }
+
+  // Saves results that are still waiting for the debounced save, and lets a
+  // save in flight finish, before stopping the worker
+  async terminate(): Promise<void> {
+    // The worker answers a store export once no detect job is in flight, so
+    // the detects still pending are cancelled rather than waited for
+    for (const id of this.pendingRequests.keys())
+      this.worker?.postMessage({ type: 'cancel', id });
+    if (this.storeSaveTimer !== null) {
+      window.clearTimeout(this.storeSaveTimer);
+      this.storeSaveTimer = null;
+      await this.saveResultStore().catch((e) =>
+        console.error('[OcrEngine] Saving result store failed:', e),
+      );
+    } else if (this.storeSave) {
+      await this.storeSave.catch(() => undefined);
+    }
     if (this.worker) {
       this.worker.terminate();
       this.worker = null;
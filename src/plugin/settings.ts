@@ -1,5 +1,6 @@
 import { App, PluginSettingTab, Setting, Notice } from 'obsidian';
 import OcrPlugin from './main';
+import { useAnalysisStore } from './models/store';
 
 export interface OcrSettings {
   autoOcrOnPaste: boolean;
@@ -7,6 +8,8 @@ export interface OcrSettings {
   autoOpenPanel: boolean;
   autoMergeLines: boolean;
   textConfidenceThreshold: number;
+  showLatencyStats: boolean;
+  capturePixels: 'full' | 'downscaled' | 'hash';
 }
 
 export const DEFAULT_SETTINGS: OcrSettings = {
@@ -15,6 +18,8 @@ export const DEFAULT_SETTINGS: OcrSettings = {
   autoOpenPanel: true,
   autoMergeLines: false,
   textConfidenceThreshold: 0.8,
+  showLatencyStats: false,
+  capturePixels: 'downscaled',
 };
 
 export class OcrSettingTab extends PluginSettingTab {
@@ -147,5 +152,69 @@ export class OcrSettingTab extends PluginSettingTab {
             await this.plugin.applySettings();
           }),
       );
+
+    new Setting(containerEl).setName('Debug').setHeading();
+    new Setting(containerEl)
+      .setName('Show latency statistics')
+      .setDesc(
+        'Show p50/p99 engine latency per stage for this session in the analysis panel.',
+      )
+      .addToggle((toggle) =>
+        toggle
+          .setValue(this.plugin.settings.showLatencyStats)
+          .onChange(async (value) => {
+            this.plugin.settings.showLatencyStats = value;
+            await this.plugin.saveSettings();
+          }),
+      )
+      .addButton((btn) =>
+        btn.setButtonText('Reset').onClick(() => {
+          this.plugin.ocrEngine?.resetStats();
+          useAnalysisStore.getState().setLatencyStats(null);
+          new Notice('Latency statistics reset');
+        }),
+      );
+
+    new Setting(containerEl)
+      .setName('Capture pixels')
+      .setDesc(
+        'What a recording keeps of each image. "Hash only" stores no image content.',
+      )
+      .addDropdown((dropdown) =>
+        dropdown
+          .addOption('full', 'Full size')
+          .addOption('downscaled', 'Downscaled (1024 px)')
+          .addOption('hash', 'Hash only')
+          .setValue(this.plugin.settings.capturePixels)
+          .onChange(async (value) => {
+            this.plugin.settings.capturePixels =
+              value as OcrSettings['capturePixels'];
+            await this.plugin.saveSettings();
+          }),
+      );
+
+    new Setting(containerEl)
+      .setName('Record analyze calls')
+      .setDesc(
+        'Record every analyze call (image, options, timing) to a capture file in the plugin folder, for reproducing slow images with the replay tool.',
+      )
+      .addToggle((toggle) =>
+        toggle
+          .setValue(this.plugin.isCapturing)
+          .onChange(async (value) => {
+            try {
+              if (value) {
+                await this.plugin.startCapture();
+                new Notice('Recording analyze calls');
+              } else {
+                const path = await this.plugin.stopCapture();
+                new Notice(`Capture saved to ${path}`);
+              }
+            } catch (e) {
+              new Notice('Capture failed: ' + String(e));
+              toggle.setValue(this.plugin.isCapturing);
+            }
+          }),
+      );
   }
 }
@@ -7,7 +7,55 @@ declare module 'ocr-wasm-engine' {
       rec_bin: number,
     ): number;
     _detect(ptr: number, width: number, height: number): number;
+    _detect_batch(
+      ptrs: number,
+      widths: number,
+      heights: number,
+      count: number,
+    ): number;
     _set_text_score_threshold(threshold: number): void;
+    _set_rec_pack_width(width: number): void;
+    _set_rec_chunk_width(width: number): void;
+    _set_axis_aligned_tolerance(degrees: number): void;
+    _set_rec_pyramid(enabled: number): void;
+    _set_postprocess_threads(numThreads: number): void;
+    _set_num_threads(numThreads: number): void;
+    _start_capture(path: number, storePixels: number, maxSide: number): number;
+    _stop_capture(): void;
+    _set_sequence_mode(tileSize: number, margin: number): void;
+    _reset_sequence(): void;
+    _open_result_store(path: number): number;
+    _close_result_store(): void;
+    _flush_result_store(): void;
+    _compact_result_store(budgetMs: number): number;
+    _get_result_store_stats(): number;
+    // Right after _detect only; a job ending in between replaces the result
+    _index_last_result(imageId: number): void;
+    _unindex_image(imageId: number): number;
+    _clear_text_index(): void;
+    _search_text(query: number, limit: number): number;
+    _get_text_index_stats(): number;
+    _start_trace(capacity: number): void;
+    _stop_trace(): void;
+    _export_trace(): number;
+    _get_latency_stats(): number;
+    _reset_latency_stats(): void;
+    _set_layer_profiling(enabled: number): void;
+    _get_layer_profile(): number;
+    _reset_layer_profile(): void;
+    _set_log_level(level: number): void;
+    _set_log_echo_level(level: number): void;
+    _get_logs(): number;
+    _submit_detect(
+      ptr: number,
+      width: number,
+      height: number,
+      priority: number,
+    ): number;
+    _poll_job(jobId: number): number;
+    _cancel_job(jobId: number): number;
+    _take_job_result(jobId: number): number;
+    _set_job_aging(ms: number): void;
     _warmup_model(): void;
     _cleanup_vfs(
       det_param: number,
@@ -26,6 +74,10 @@ declare module 'ocr-wasm-engine' {
       buffer: number,
     ): void;
     HEAPU8: Uint8Array;
+    // Threads variants only: size of the pthread pool
+    pthreadPoolSize?: number;
+    // Set by the host; called for every finished or cancelled _submit_detect job
+    onJobDone?: (jobId: number, state: number) => void;
     FS: {
       writeFile(
         path: string,
@@ -33,6 +85,8 @@ declare module 'ocr-wasm-engine' {
         opts?: Record<string, unknown>,
       ): void;
       mkdir(path: string, mode?: number): void;
+      readFile(path: string): Uint8Array;
+      unlink(path: string): void;
     };
   }
 
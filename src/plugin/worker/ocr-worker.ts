@@ -1,31 +1,94 @@
 import createOcrModule, { OcrModule } from 'ocr-wasm-engine';
 import ocrWasmBinary from 'ocr-wasm-engine/binary';
+import type { EngineLatencyStats } from '../services/OcrEngine';
 
 interface OcrResultItem {
   box: [[number, number], [number, number], [number, number], [number, number]];
   text: string;
   prob: number;
+  // Reading-order line / paragraph ids assigned by the engine's layout stage
+  line?: number;
+  paragraph?: number;
 }
 
 // Type definitions for messages (Simplified)
 export type WorkerMessage =
-  | { type: 'init'; payload: { models: Record<string, Uint8Array> } }
+  | {
+      type: 'init';
+      payload: { models: Record<string, Uint8Array>; store?: StoreFiles };
+    }
   | {
       type: 'detect';
-      payload: { width: number; height: number; buffer: Uint8Array };
+      payload: {
+        width: number;
+        height: number;
+        buffer: Uint8Array;
+        priority?: DetectPriority;
+      };
       id: number;
     }
-  | { type: 'set-threshold'; payload: { threshold: number } };
+  | { type: 'set-threshold'; payload: { threshold: number } }
+  | { type: 'get-stats'; id: number }
+  | { type: 'reset-stats' }
+  | {
+      type: 'start-capture';
+      payload: { storePixels: boolean; maxSide: number };
+      id: number;
+    }
+  | { type: 'stop-capture'; id: number }
+  | { type: 'export-store'; id: number }
+  | { type: 'cancel'; id: number };
 
 export type WorkerResponse =
   | { type: 'init-success' }
   | { type: 'init-error'; error: string }
   | { type: 'detect-success'; id: number; results: OcrResultItem[] }
   | { type: 'detect-error'; id: number; error: string }
-  | { type: 'set-threshold-success' };
+  | { type: 'set-threshold-success' }
+  | { type: 'stats-success'; id: number; stats: EngineLatencyStats }
+  | { type: 'stats-error'; id: number; error: string }
+  | { type: 'capture-started'; id: number }
+  | { type: 'capture-data'; id: number; data: Uint8Array }
+  | { type: 'capture-error'; id: number; error: string }
+  | { type: 'store-data'; id: number; store: StoreFiles }
+  | { type: 'store-error'; id: number; error: string };
+
+// Result store log and its index, as persisted by the host
+export interface StoreFiles {
+  data: Uint8Array;
+  index: Uint8Array | null;
+}
+
+const CAPTURE_PATH = '/capture.ocrcap';
+const STORE_PATH = '/results.ocrstore';
+// Time per compaction step. Steps run one per task, so messages (detects,
+// cancels) are handled in between.
+const STORE_COMPACT_BUDGET_MS = 20;
+// Wait before the next step while detect jobs are in flight
+const STORE_COMPACT_BUSY_DELAY_MS = 200;
+
+// Engine job states (see poll_job)
+const JOB_DONE = 2;
+
+export type DetectPriority = 'interactive' | 'visible' | 'background';
+// Engine job priorities (see submit_detect)
+const JOB_PRIORITY: Record<DetectPriority, number> = {
+  interactive: 0,
+  visible: 1,
+  background: 2,
+};
 
 let ocrModule: OcrModule | null = null;
 let isInitialized = false;
+// Threads builds run detect requests as engine jobs on a thread the module
+// owns, so this loop keeps taking messages (cancels) while they run
+let useJobs = false;
+const jobRequests = new Map<number, number>(); // job id -> detect request id
+const requestJobs = new Map<number, number>(); // detect request id -> job id
+let compactTimer: ReturnType<typeof setTimeout> | null = null;
+// Store exports wait for the engine, so they are answered once no job is in
+// flight instead of blocking this loop
+const deferredExports: number[] = [];
 
 // Helper to interact with VFS
 function writeToVFS(path: string, data: Uint8Array) {
@@ -46,6 +109,90 @@ function allocString(str: string): number {
   return ptr;
 }
 
+interface EngineLogRecord {
+  t: number;
+  level: 'debug' | 'info' | 'warn' | 'error';
+  file: string;
+  line: number;
+  msg: string;
+}
+
+// Forwards the engine's buffered log records to the console. The engine only
+// prints errors itself; everything else waits in its ring buffer until here.
+function flushEngineLogs() {
+  if (!ocrModule) return;
+  const records = JSON.parse(
+    ocrModule.UTF8ToString(ocrModule._get_logs()),
+  ) as EngineLogRecord[];
+  for (const r of records) {
+    const text = `[Worker Wasm] ${r.msg} (${r.file}:${r.line})`;
+    if (r.level === 'warn') console.warn(text);
+    else if (r.level === 'info') console.info(text);
+    else if (r.level === 'debug') console.debug(text);
+  }
+}
+
+// Continues result store compaction in the background, one budgeted step at a
+// time. A step waits for the engine, so it is put off while jobs run.
+function scheduleStoreCompaction(delayMs = 0) {
+  if (compactTimer !== null) return;
+  compactTimer = setTimeout(() => {
+    compactTimer = null;
+    if (!ocrModule || !isInitialized) return;
+    if (jobRequests.size > 0) {
+      scheduleStoreCompaction(STORE_COMPACT_BUSY_DELAY_MS);
+      return;
+    }
+    if (ocrModule._compact_result_store(STORE_COMPACT_BUDGET_MS))
+      scheduleStoreCompaction();
+  }, delayMs);
+}
+
+// Flushes the result store and sends both files to the export request `id`
+function exportStore(id: number) {
+  if (!ocrModule) return;
+  try {
+    // One compaction step per export; the rest runs in the background. The
+    // log stays complete until a compaction finishes, so a later export
+    // picks up the compacted one.
+    if (ocrModule._compact_result_store(STORE_COMPACT_BUDGET_MS))
+      scheduleStoreCompaction();
+    ocrModule._flush_result_store();
+    const data = ocrModule.FS.readFile(STORE_PATH);
+    const index = ocrModule.FS.readFile(STORE_PATH + '.idx');
+    self.postMessage({ type: 'store-data', id, store: { data, index } }, [
+      data.buffer,
+      index.buffer,
+    ]);
+  } catch (err) {
+    console.error('[Worker Error]', err);
+    const error = err instanceof Error ? err.message : String(err);
+    self.postMessage({ type: 'store-error', id, error });
+  }
+}
+
+// Module.onJobDone: answers the detect request that submitted the job
+function onJobDone(jobId: number, state: number) {
+  if (!ocrModule) return;
+  const json = ocrModule.UTF8ToString(ocrModule._take_job_result(jobId));
+  const requestId = jobRequests.get(jobId);
+  jobRequests.delete(jobId);
+  if (requestId === undefined) return;
+  requestJobs.delete(requestId);
+  if (state === JOB_DONE) {
+    self.postMessage({
+      type: 'detect-success',
+      id: requestId,
+      results: JSON.parse(json),
+    });
+  } else {
+    self.postMessage({ type: 'detect-error', id: requestId, error: 'Cancelled' });
+  }
+  if (jobRequests.size === 0)
+    for (const id of deferredExports.splice(0)) exportStore(id);
+  flushEngineLogs();
+}
+
 // Main Message Handler
 self.onmessage = async (e: MessageEvent<WorkerMessage>) => {
   const msg = e.data;
@@ -64,6 +211,8 @@ self.onmessage = async (e: MessageEvent<WorkerMessage>) => {
         print: (text: string) => console.debug('[Worker Wasm]: ' + text),
         printErr: (text: string) => console.error('[Worker Wasm Err]: ' + text),
       });
+      // Errors print immediately; the rest is forwarded by flushEngineLogs
+      ocrModule._set_log_echo_level(3);
 
       const models = msg.payload.models;
 
@@ -96,8 +245,38 @@ self.onmessage = async (e: MessageEvent<WorkerMessage>) => {
         ocrModule._free(p4);
       }
 
+      // One thread budget for ncnn and the engine's own kernels. Builds
+      // without threads report no pool and run single-threaded. The job
+      // thread takes one pool slot.
+      const poolSize = ocrModule.pthreadPoolSize ?? 0;
+      if (poolSize > 0) {
+        ocrModule._set_num_threads(
+          Math.max(
+            1,
+            Math.min(navigator.hardwareConcurrency || 1, poolSize - 1),
+          ),
+        );
+        useJobs = true;
+        ocrModule.onJobDone = onJobDone;
+      }
+
       ocrModule._warmup_model();
 
+      // Results from earlier sessions. The engine drops the log itself when
+      // the models or the format have changed since it was written.
+      const store = msg.payload.store;
+      if (store) {
+        writeToVFS(STORE_PATH, store.data);
+        if (store.index) writeToVFS(STORE_PATH + '.idx', store.index);
+      }
+      const storePtr = allocString(STORE_PATH);
+      try {
+        if (ocrModule._open_result_store(storePtr) !== 0)
+          console.warn('[Worker] Result store unavailable');
+      } finally {
+        ocrModule._free(storePtr);
+      }
+
       isInitialized = true;
       console.debug('[Worker] Init complete.');
       self.postMessage({ type: 'init-success' });
@@ -105,7 +284,7 @@ self.onmessage = async (e: MessageEvent<WorkerMessage>) => {
       if (!ocrModule || !isInitialized)
         throw new Error('Worker not initialized');
 
-      const { width, height, buffer } = msg.payload;
+      const { width, height, buffer, priority } = msg.payload;
       const numBytes = width * height * 4;
 
       const ptr = ocrModule._malloc(numBytes);
@@ -116,6 +295,20 @@ self.onmessage = async (e: MessageEvent<WorkerMessage>) => {
           ocrModule.writeArrayToMemory(buffer, ptr);
         }
 
+        if (useJobs) {
+          // The job copies the pixels; onJobDone answers the request
+          const jobId = ocrModule._submit_detect(
+            ptr,
+            width,
+            height,
+            JOB_PRIORITY[priority ?? 'visible'],
+          );
+          if (jobId < 0) throw new Error('Cannot submit detect job');
+          jobRequests.set(jobId, msg.id);
+          requestJobs.set(msg.id, jobId);
+          return;
+        }
+
         const resPtr = ocrModule._detect(ptr, width, height);
         const jsonStr = ocrModule.UTF8ToString(resPtr);
         const results = JSON.parse(jsonStr);
@@ -129,6 +322,49 @@ self.onmessage = async (e: MessageEvent<WorkerMessage>) => {
         throw new Error('Worker not initialized');
       ocrModule._set_text_score_threshold(msg.payload.threshold);
       self.postMessage({ type: 'set-threshold-success' });
+    } else if (msg.type === 'get-stats') {
+      if (!ocrModule || !isInitialized)
+        throw new Error('Worker not initialized');
+      const stats = JSON.parse(
+        ocrModule.UTF8ToString(ocrModule._get_latency_stats()),
+      );
+      self.postMessage({ type: 'stats-success', id: msg.id, stats });
+    } else if (msg.type === 'reset-stats') {
+      if (ocrModule && isInitialized) ocrModule._reset_latency_stats();
+    } else if (msg.type === 'start-capture') {
+      if (!ocrModule || !isInitialized)
+        throw new Error('Worker not initialized');
+      const pathPtr = allocString(CAPTURE_PATH);
+      try {
+        const res = ocrModule._start_capture(
+          pathPtr,
+          msg.payload.storePixels ? 1 : 0,
+          msg.payload.maxSide,
+        );
+        if (res !== 0) throw new Error('Cannot start capture');
+      } finally {
+        ocrModule._free(pathPtr);
+      }
+      self.postMessage({ type: 'capture-started', id: msg.id });
+    } else if (msg.type === 'stop-capture') {
+      if (!ocrModule || !isInitialized)
+        throw new Error('Worker not initialized');
+      ocrModule._stop_capture();
+      const data = ocrModule.FS.readFile(CAPTURE_PATH);
+      ocrModule.FS.unlink(CAPTURE_PATH);
+      self.postMessage({ type: 'capture-data', id: msg.id, data }, [
+        data.buffer,
+      ]);
+    } else if (msg.type === 'cancel') {
+      // Only job-based detects can be cancelled; a synchronous one has
+      // already answered by the time this arrives
+      const jobId = requestJobs.get(msg.id);
+      if (ocrModule && jobId !== undefined) ocrModule._cancel_job(jobId);
+    } else if (msg.type === 'export-store') {
+      if (!ocrModule || !isInitialized)
+        throw new Error('Worker not initialized');
+      if (jobRequests.size > 0) deferredExports.push(msg.id);
+      else exportStore(msg.id);
     }
   } catch (err) {
     console.error('[Worker Error]', err);
@@ -138,6 +374,14 @@ self.onmessage = async (e: MessageEvent<WorkerMessage>) => {
       self.postMessage({ type: 'init-error', error: errorMsg });
     } else if (msg.type === 'detect') {
       self.postMessage({ type: 'detect-error', id: msg.id, error: errorMsg });
+    } else if (msg.type === 'get-stats') {
+      self.postMessage({ type: 'stats-error', id: msg.id, error: errorMsg });
+    } else if (msg.type === 'start-capture' || msg.type === 'stop-capture') {
+      self.postMessage({ type: 'capture-error', id: msg.id, error: errorMsg });
+    } else if (msg.type === 'export-store') {
+      self.postMessage({ type: 'store-error', id: msg.id, error: errorMsg });
     }
+  } finally {
+    flushEngineLogs();
   }
 };
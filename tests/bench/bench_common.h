@@ -0,0 +1,189 @@
+#pragma once
+
+// Shared helpers for the command-line benchmark tools in tests/bench.
+// Every tool is a single translation unit linked with the engine sources, so
+// the stb_image implementation is compiled here.
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_HDR
+#define STBI_NO_LINEAR
+#include "stb_image.h"
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/heap.h>
+#else
+#include <sys/resource.h>
+#endif
+
+struct BenchImage {
+    std::string path;
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> rgba;
+};
+
+// Decodes any format stb_image understands into tightly packed RGBA
+inline bool load_image(const std::string& path, BenchImage& image)
+{
+    int w = 0, h = 0, c = 0;
+    unsigned char* data = stbi_load(path.c_str(), &w, &h, &c, 4);
+    if (!data) return false;
+    image.path = path;
+    image.width = w;
+    image.height = h;
+    image.rgba.assign(data, data + (size_t)w * h * 4);
+    stbi_image_free(data);
+    return true;
+}
+
+// Image files directly inside `dir`, sorted by name
+inline std::vector<std::string> list_images(const std::string& dir)
+{
+    static const char* extensions[] = { ".png", ".jpg", ".jpeg", ".bmp", ".tga", ".gif" };
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        if (!entry.is_regular_file()) continue;
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char ch) { return (char)std::tolower(ch); });
+        for (const char* e : extensions) {
+            if (ext == e) {
+                paths.push_back(entry.path().string());
+                break;
+            }
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+inline bool read_text_file(const std::string& path, std::string& text)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    text.clear();
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+inline double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Nearest-rank percentile, `p` in [0, 100]
+inline double percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)std::max(1.0, std::ceil(p / 100.0 * values.size()));
+    return values[std::min(rank, values.size()) - 1];
+}
+
+// Peak resident memory in KB. Wasm memory never shrinks, so the current heap
+// size is its peak.
+inline long peak_memory_kb()
+{
+#ifdef __EMSCRIPTEN__
+    return (long)(emscripten_get_heap_size() / 1024);
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// Build flavour, so results from different variants can be told apart
+inline std::string build_variant()
+{
+#ifdef __EMSCRIPTEN__
+    std::string name = "wasm";
+#ifdef __wasm_simd128__
+    name += "-simd";
+#endif
+#else
+    std::string name = "native";
+#endif
+#ifdef _OPENMP
+    name += "-threads";
+#endif
+    return name;
+}
+
+inline std::string json_escape(const std::string& s)
+{
+    std::string out;
+    for (char c : s) {
+        if (c == '"')
+            out += "\\\"";
+        else if (c == '\\')
+            out += "\\\\";
+        else if (c == '\n')
+            out += "\\n";
+        else if ((unsigned char)c < 0x20)
+            out += ' ';
+        else
+            out += c;
+    }
+    return out;
+}
+
+// Code points of a UTF-8 string, without whitespace (ASCII and U+3000)
+inline std::vector<unsigned int> to_codepoints(const std::string& s)
+{
+    std::vector<unsigned int> cps;
+    for (size_t i = 0; i < s.size();) {
+        unsigned char c = s[i];
+        unsigned int cp;
+        int len;
+        if (c < 0x80) {
+            cp = c;
+            len = 1;
+        } else if ((c >> 5) == 0x6) {
+            cp = c & 0x1F;
+            len = 2;
+        } else if ((c >> 4) == 0xE) {
+            cp = c & 0x0F;
+            len = 3;
+        } else {
+            cp = c & 0x07;
+            len = 4;
+        }
+        for (int k = 1; k < len && i + k < s.size(); k++) cp = (cp << 6) | (s[i + k] & 0x3F);
+        i += len;
+        if (cp == ' ' || cp == '\t' || cp == '\n' || cp == '\r' || cp == 0x3000) continue;
+        cps.push_back(cp);
+    }
+    return cps;
+}
+
+inline int edit_distance(const std::vector<unsigned int>& a, const std::vector<unsigned int>& b)
+{
+    std::vector<int> prev(b.size() + 1), cur(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); j++) prev[j] = (int)j;
+    for (size_t i = 1; i <= a.size(); i++) {
+        cur[0] = (int)i;
+        for (size_t j = 1; j <= b.size(); j++) {
+            int sub = prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+            cur[j] = std::min({ sub, prev[j] + 1, cur[j - 1] + 1 });
+        }
+        prev.swap(cur);
+    }
+    return prev[b.size()];
+}
@@ -0,0 +1,134 @@
+// Cold-start benchmark: time from an empty engine to the first result, split
+// into param parsing, weight reads, pipeline creation, the warmup forward and
+// the first detect (with a second detect as the steady-state reference).
+// Each run builds a fresh OCREngine; run 0 is the cold one within the process.
+// Module compile/instantiate only exists for Wasm and is measured by
+// tests/node/cold-start.cjs.
+//
+// Usage: cold-start [--models DIR] [--format text|bin] [--image FILE] [--runs N] [--out FILE]
+
+#include <cstdlib>
+#include <sstream>
+
+#include "bench_common.h"
+#include "ocr_engine.h"
+
+struct RunTimings {
+    double construct = 0.0;
+    LoadTimings load;
+    double load_total = 0.0;
+    double warmup = 0.0;
+    double first_detect = 0.0;
+    double second_detect = 0.0;
+
+    double to_first_result() const { return construct + load_total + warmup + first_detect; }
+};
+
+static void write_run(std::ostringstream& js, const RunTimings& r)
+{
+    js << "{\"construct\": " << r.construct << ", \"param_parse\": " << r.load.param_parse
+       << ", \"weight_read\": " << r.load.weight_read << ", \"pipeline\": " << r.load.pipeline
+       << ", \"load_total\": " << r.load_total << ", \"warmup\": " << r.warmup
+       << ", \"first_detect\": " << r.first_detect << ", \"second_detect\": " << r.second_detect
+       << ", \"to_first_result\": " << r.to_first_result() << "}";
+}
+
+int main(int argc, char** argv)
+{
+    std::string model_dir = "assets/models";
+    std::string format = "text";
+    std::string image_path = "tests/web/test.jpg";
+    std::string out_path;
+    int runs = 5;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc || arg.compare(0, 2, "--") != 0) {
+            fprintf(stderr, "Usage: cold-start [--models DIR] [--format text|bin] [--image FILE] [--runs N] [--out FILE]\n");
+            return 2;
+        }
+        if (arg == "--models")
+            model_dir = argv[++i];
+        else if (arg == "--format")
+            format = argv[++i];
+        else if (arg == "--image")
+            image_path = argv[++i];
+        else if (arg == "--runs")
+            runs = std::max(1, atoi(argv[++i]));
+        else if (arg == "--out")
+            out_path = argv[++i];
+        else {
+            fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return 2;
+        }
+    }
+
+    // text: *.ncnn.param, bin: *.ncnn.param.bin written by ncnn2mem
+    const std::string param_ext = format == "bin" ? ".ncnn.param.bin" : ".ncnn.param";
+    const std::string det_param = model_dir + "/PP_OCRv5_mobile_det" + param_ext;
+    const std::string det_bin = model_dir + "/PP_OCRv5_mobile_det.ncnn.bin";
+    const std::string rec_param = model_dir + "/PP_OCRv5_mobile_rec" + param_ext;
+    const std::string rec_bin = model_dir + "/PP_OCRv5_mobile_rec.ncnn.bin";
+    if (!std::filesystem::exists(det_param) || !std::filesystem::exists(rec_param)) {
+        fprintf(stderr, "Models not found: %s\n", det_param.c_str());
+        return 1;
+    }
+
+    BenchImage image;
+    if (!load_image(image_path, image)) {
+        fprintf(stderr, "Cannot read image %s\n", image_path.c_str());
+        return 1;
+    }
+
+    std::vector<RunTimings> results;
+    for (int run = 0; run < runs; run++) {
+        RunTimings r;
+        double t0 = now_ms();
+        OCREngine* engine = new OCREngine();
+        double t1 = now_ms();
+        engine->load_model(det_param.c_str(), det_bin.c_str(), rec_param.c_str(), rec_bin.c_str());
+        double t2 = now_ms();
+        engine->warmup();
+        double t3 = now_ms();
+        engine->detect_objects(image.rgba.data(), image.width, image.height);
+        double t4 = now_ms();
+        engine->detect_objects(image.rgba.data(), image.width, image.height);
+        double t5 = now_ms();
+
+        r.construct = t1 - t0;
+        r.load = engine->load_timings();
+        r.load_total = t2 - t1;
+        r.warmup = t3 - t2;
+        r.first_detect = t4 - t3;
+        r.second_detect = t5 - t4;
+        delete engine;
+
+        fprintf(stderr, "run %d: load %.1f ms, warmup %.1f ms, first detect %.1f ms -> first result %.1f ms\n", run,
+            r.load_total, r.warmup, r.first_detect, r.to_first_result());
+        results.push_back(r);
+    }
+
+    std::vector<double> warm_totals;
+    for (size_t i = 1; i < results.size(); i++) warm_totals.push_back(results[i].to_first_result());
+
+    std::ostringstream js;
+    js << "{\n  \"variant\": \"" << build_variant() << "\",\n  \"format\": \"" << json_escape(format) << "\",\n";
+    js << "  \"cold\": ";
+    write_run(js, results[0]);
+    js << ",\n  \"warm_median_to_first_result\": " << (warm_totals.empty() ? 0.0 : percentile(warm_totals, 50));
+    js << ",\n  \"peak_memory_kb\": " << peak_memory_kb() << ",\n  \"runs\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        js << (i ? ",\n    " : "\n    ");
+        write_run(js, results[i]);
+    }
+    js << "\n  ]\n}\n";
+
+    if (out_path.empty()) {
+        fputs(js.str().c_str(), stdout);
+    } else {
+        FILE* f = fopen(out_path.c_str(), "wb");
+        if (!f) return 1;
+        fputs(js.str().c_str(), f);
+        fclose(f);
+    }
+    return 0;
+}
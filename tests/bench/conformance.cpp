@@ -0,0 +1,550 @@
+// Conformance harness for the kernels in src/core/kernels.h. Every case runs
+// the optimized kernel and its frozen copy from reference_kernels.h on the same
+// input, checks that the results agree and times both:
+//   warp   max abs difference of the normalized output <= --tol
+//   label  identical components, pixel lists and pixel order included
+//   rect   center and size within 1e-3 px, angle within 1e-3 degrees
+//   ctc    identical character ids, probabilities within 1e-6; the optimized
+//          side decodes in random chunks to exercise the carried merge state
+//   crop   the area path of resize_region_rgba on tall striped boxes against
+//          an exact area average: mean abs difference <= 1 level. A 2-tap
+//          bilinear resize of the same boxes misses by several levels.
+// Inputs are --cases random cases per kernel plus, with --corpus, crops and
+// ink maps derived from every image in DIR. Components found by the label
+// cases are fed to the rect cases as well.
+// Exits with 1 when any case fails, so it can gate kernel changes.
+//
+// Usage: conformance [--corpus DIR] [--cases N] [--seed N] [--threads N] [--repeat N] [--tol X] [--out FILE]
+
+#include <cstdlib>
+#include <random>
+#include <sstream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "bench_common.h"
+#include "reference_kernels.h"
+
+const float REC_MEAN_VALS[3] = { 127.5f, 127.5f, 127.5f };
+const float REC_NORM_VALS[3] = { 1.0f / 127.5f, 1.0f / 127.5f, 1.0f / 127.5f };
+const float LABEL_THRESHOLD = 0.3f * 255.f; // same as the det postprocess
+const int CTC_CLASSES[] = { 97, 6625, 18385 };
+const int REC_HEIGHT = 48;
+const double CROP_TOL = 1.0; // 8-bit levels
+
+struct Options {
+    std::string corpus_dir;
+    std::string out_path;
+    int cases = 100;
+    unsigned seed = 1;
+    int threads = 1;
+    int repeat = 3;
+    double tol = 1e-4;
+};
+
+struct KernelReport {
+    std::string name;
+    int cases = 0;
+    int failures = 0;
+    double max_error = 0.0;
+    double ref_ms = 0.0;
+    double opt_ms = 0.0;
+    std::string first_failure;
+
+    explicit KernelReport(const char* kernel)
+        : name(kernel)
+    {
+    }
+
+    void add(bool ok, double error, double ref, double opt, const std::string& what)
+    {
+        cases++;
+        max_error = std::max(max_error, error);
+        ref_ms += ref;
+        opt_ms += opt;
+        if (!ok && failures++ == 0) first_failure = what;
+    }
+};
+
+// Best of `repeat` runs of each side, in ms. The side that goes first
+// alternates, so neither always runs on caches the other has just warmed.
+template <typename Ref, typename Opt>
+static void time_pair(int repeat, Ref ref, Opt opt, double& ref_ms, double& opt_ms)
+{
+    ref_ms = opt_ms = 1e300;
+    for (int i = 0; i < 2 * repeat; i++) {
+        const bool run_ref = (i & 1) == (i / 2 & 1);
+        const double t0 = now_ms();
+        if (run_ref)
+            ref();
+        else
+            opt();
+        double& best = run_ref ? ref_ms : opt_ms;
+        best = std::min(best, now_ms() - t0);
+    }
+}
+
+static std::string describe(const char* source, int w, int h)
+{
+    std::ostringstream ss;
+    ss << source << " " << w << "x" << h;
+    return ss.str();
+}
+
+// -------------------------------------------------------------------------
+// Inputs
+// -------------------------------------------------------------------------
+
+// Planar BGR in [0, 255], the layout crop_and_warp_roi warps from
+static ncnn::Mat rgba_to_planar(const BenchImage& image)
+{
+    ncnn::Mat m(image.width, image.height, 3);
+    for (int c = 0; c < 3; c++) {
+        float* dst = m.channel(c);
+        for (size_t i = 0; i < (size_t)image.width * image.height; i++) dst[i] = image.rgba[i * 4 + 2 - c];
+    }
+    return m;
+}
+
+// Random planar image: smooth gradients plus noise, so interpolation errors show
+static ncnn::Mat random_planar(std::mt19937& rng, int w, int h)
+{
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    ncnn::Mat m(w, h, 3);
+    for (int c = 0; c < 3; c++) {
+        const float fx = unit(rng) * 0.2f, fy = unit(rng) * 0.2f, noise = unit(rng) * 64.f;
+        float* p = m.channel(c);
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                float v = 127.5f + 100.f * std::sin(x * fx + y * fy) + noise * (unit(rng) - 0.5f);
+                *p++ = std::max(0.f, std::min(255.f, v));
+            }
+        }
+    }
+    return m;
+}
+
+// Text-like RGBA region for the crop cases: ink strokes every 3 to 6 output
+// rows, as thin as one source row, on a light background. The strokes are
+// coarse enough for any fair resize to keep and thin enough that a resize
+// skipping source rows loses or doubles them.
+static std::vector<unsigned char> striped_rgba(std::mt19937& rng, int w, int h)
+{
+    const double rows_per_output = (double)h / REC_HEIGHT;
+    const int period = std::max(2, (int)(rows_per_output * std::uniform_real_distribution<double>(3.0, 6.0)(rng)));
+    const int thick = std::uniform_int_distribution<int>(1, period / 2)(rng);
+    std::uniform_int_distribution<int> ink(0, 60);
+    const int paper = std::uniform_int_distribution<int>(200, 255)(rng);
+    std::vector<unsigned char> rgba((size_t)w * h * 4);
+    for (int y = 0; y < h; y++) {
+        const bool stroke = y % period < thick;
+        for (int x = 0; x < w; x++) {
+            unsigned char* px = &rgba[((size_t)y * w + x) * 4];
+            px[0] = px[1] = px[2] = (unsigned char)(stroke ? ink(rng) : paper);
+            px[3] = 255;
+        }
+    }
+    return rgba;
+}
+
+// Source-to-crop transform: rotation by `angle`, uniform `scale`, then a shift.
+// Crops may reach outside the source, which covers the clamped border path.
+static Matrix2x3 random_transform(std::mt19937& rng, int src_w, int src_h)
+{
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    const float angle = (unit(rng) - 0.5f) * 3.1415926535f;
+    const float scale = 0.25f + unit(rng) * 3.75f;
+    const float cx = unit(rng) * src_w, cy = unit(rng) * src_h;
+    Matrix2x3 M;
+    M.m[0] = scale * std::cos(angle);
+    M.m[1] = scale * std::sin(angle);
+    M.m[3] = -scale * std::sin(angle);
+    M.m[4] = scale * std::cos(angle);
+    M.m[2] = -(M.m[0] * cx + M.m[1] * cy);
+    M.m[5] = -(M.m[3] * cx + M.m[4] * cy);
+    return M;
+}
+
+// Det-like probability map in [0, 255]: filled rotated boxes of varying size
+// and aspect, plus specks of 1-12 pixels around the noise size filter
+static std::vector<float> random_map(std::mt19937& rng, int w, int h)
+{
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    std::vector<float> map(w * h);
+    for (float& v : map) v = unit(rng) * 60.f;
+
+    const int specks = w * h / 400;
+    for (int k = 0; k < specks; k++) {
+        int x = (int)(unit(rng) * w), y = (int)(unit(rng) * h);
+        const int steps = 1 + (int)(unit(rng) * 12);
+        for (int i = 0; i < steps; i++) {
+            map[y * w + x] = 255.f;
+            const int dir = (int)(unit(rng) * 4);
+            x = std::max(0, std::min(w - 1, x + (dir == 0) - (dir == 1)));
+            y = std::max(0, std::min(h - 1, y + (dir == 2) - (dir == 3)));
+        }
+    }
+
+    const int boxes = 1 + (int)(unit(rng) * 60);
+    for (int b = 0; b < boxes; b++) {
+        const float cx = unit(rng) * w, cy = unit(rng) * h;
+        const float hw = 2 + unit(rng) * w / 4, hh = 1 + unit(rng) * 12;
+        const float a = (unit(rng) - 0.5f) * 3.1415926535f;
+        const float ca = std::cos(a), sa = std::sin(a);
+        const float r = std::sqrt(hw * hw + hh * hh);
+        for (int y = std::max(0, (int)(cy - r)); y < std::min(h, (int)(cy + r) + 1); y++) {
+            for (int x = std::max(0, (int)(cx - r)); x < std::min(w, (int)(cx + r) + 1); x++) {
+                const float u = (x - cx) * ca + (y - cy) * sa;
+                const float v = -(x - cx) * sa + (y - cy) * ca;
+                if (std::abs(u) <= hw && std::abs(v) <= hh) map[y * w + x] = 150.f + unit(rng) * 105.f;
+            }
+        }
+    }
+    return map;
+}
+
+// Ink map of a page: dark pixels score high, like text in the det output
+static std::vector<float> ink_map(const BenchImage& image)
+{
+    std::vector<float> map((size_t)image.width * image.height);
+    for (size_t i = 0; i < map.size(); i++) {
+        const unsigned char* p = &image.rgba[i * 4];
+        map[i] = 255.f - (0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2]);
+    }
+    return map;
+}
+
+// Point cloud of a rotated rectangle, like the pixels of one text component
+static std::vector<IntPoint> random_cloud(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    const float cx = 50 + unit(rng) * 1000, cy = 50 + unit(rng) * 1000;
+    const float hw = 1 + unit(rng) * 200, hh = 1 + unit(rng) * 20;
+    const float a = (unit(rng) - 0.5f) * 3.1415926535f;
+    const int n = 6 + (int)(unit(rng) * 2000);
+    std::vector<IntPoint> cloud(n);
+    for (auto& p : cloud) {
+        const float u = (unit(rng) * 2 - 1) * hw, v = (unit(rng) * 2 - 1) * hh;
+        p.x = (int)std::lround(cx + u * std::cos(a) - v * std::sin(a));
+        p.y = (int)std::lround(cy + u * std::sin(a) + v * std::cos(a));
+    }
+    return cloud;
+}
+
+// Rec-like logits [T x C]: a random label path of blanks, repeats and
+// characters with a clear winner per step, over uniform noise
+static ncnn::Mat random_logits(std::mt19937& rng, int steps, int classes)
+{
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    ncnn::Mat out(classes, steps);
+    int token = 0;
+    for (int t = 0; t < steps; t++) {
+        float* row = out.row(t);
+        for (int j = 0; j < classes; j++) row[j] = unit(rng) * 0.5f;
+        const float r = unit(rng);
+        if (r < 0.4f)
+            token = 0;
+        else if (r < 0.7f)
+            token = std::uniform_int_distribution<int>(1, classes - 1)(rng);
+        row[token] = 0.5f + unit(rng) * 0.5f;
+    }
+    return out;
+}
+
+// -------------------------------------------------------------------------
+// Checks
+// -------------------------------------------------------------------------
+
+static void check_warp(const Options& opt, const ncnn::Mat& src, const Matrix2x3& M, int dst_w, int dst_h,
+    const std::string& what, KernelReport& report)
+{
+    ncnn::Mat ref, out;
+    double ref_ms, opt_ms;
+    time_pair(
+        opt.repeat,
+        [&] { reference::warp_affine_bilinear(src, ref, M, dst_w, dst_h, REC_MEAN_VALS, REC_NORM_VALS); },
+        [&] { warp_affine_bilinear(src, out, M, dst_w, dst_h, REC_MEAN_VALS, REC_NORM_VALS, opt.threads); },
+        ref_ms, opt_ms);
+
+    double err = 0.0;
+    for (int c = 0; c < 3; c++) {
+        const float* a = ref.channel(c);
+        const float* b = out.channel(c);
+        for (int i = 0; i < dst_w * dst_h; i++) err = std::max(err, (double)std::abs(a[i] - b[i]));
+    }
+    report.add(err <= opt.tol, err, ref_ms, opt_ms, what + " max error " + std::to_string(err));
+}
+
+// Every output pixel is the mean of the source area it covers, edge pixels
+// weighted by their covered fraction
+static void area_resize_rgba(const unsigned char* src, int w, int h, int dst_w, int dst_h, std::vector<float>& out)
+{
+    struct Tap {
+        int index;
+        float weight;
+    };
+    auto taps = [](int src_n, int dst_n) {
+        std::vector<std::vector<Tap>> all(dst_n);
+        const double scale = (double)src_n / dst_n;
+        for (int d = 0; d < dst_n; d++) {
+            const double a = d * scale, b = (d + 1) * scale;
+            for (int i = (int)a; i < std::min((double)src_n, std::ceil(b)); i++) {
+                const double cover = std::min(b, i + 1.0) - std::max(a, (double)i);
+                if (cover > 0) all[d].push_back({ i, (float)(cover / scale) });
+            }
+        }
+        return all;
+    };
+    const auto xs = taps(w, dst_w), ys = taps(h, dst_h);
+    out.assign((size_t)dst_w * dst_h * 4, 0.f);
+    for (int dy = 0; dy < dst_h; dy++) {
+        for (const Tap& ty : ys[dy]) {
+            const unsigned char* row = src + (size_t)ty.index * w * 4;
+            for (int dx = 0; dx < dst_w; dx++) {
+                float* o = &out[((size_t)dy * dst_w + dx) * 4];
+                for (const Tap& tx : xs[dx]) {
+                    const float wt = ty.weight * tx.weight;
+                    for (int c = 0; c < 4; c++) o[c] += wt * row[tx.index * 4 + c];
+                }
+            }
+        }
+    }
+}
+
+static void check_crop(const Options& opt, const std::vector<unsigned char>& rgba, int w, int h, const std::string& what,
+    KernelReport& report)
+{
+    const int dst_w = std::max(1, (int)std::lround((double)w * REC_HEIGHT / h));
+    std::vector<float> ref;
+    std::vector<unsigned char> out((size_t)dst_w * REC_HEIGHT * 4);
+    double ref_ms, opt_ms;
+    time_pair(
+        opt.repeat, [&] { area_resize_rgba(rgba.data(), w, h, dst_w, REC_HEIGHT, ref); },
+        [&] { resize_region_rgba(rgba.data(), w, 0, 0, w, h, out.data(), dst_w, REC_HEIGHT, true); }, ref_ms,
+        opt_ms);
+
+    double sum = 0.0;
+    for (size_t i = 0; i < out.size(); i++) sum += std::abs(ref[i] - out[i]);
+    const double err = sum / out.size();
+    report.add(err <= CROP_TOL, err, ref_ms, opt_ms, what + " mean error " + std::to_string(err));
+}
+
+static void check_label(const Options& opt, const std::vector<float>& map, int w, int h, const std::string& what,
+    KernelReport& report, std::vector<std::vector<IntPoint>>& components)
+{
+    std::vector<std::vector<IntPoint>> ref, out;
+    double ref_ms, opt_ms;
+    time_pair(
+        opt.repeat,
+        [&] {
+            ref.clear();
+            reference::label_components(map.data(), w, h, LABEL_THRESHOLD, ref);
+        },
+        [&] {
+            out.clear();
+            label_components(map.data(), w, h, LABEL_THRESHOLD, opt.threads, out);
+        },
+        ref_ms, opt_ms);
+
+    std::string mismatch;
+    if (ref.size() != out.size()) {
+        mismatch = std::to_string(out.size()) + " components, expected " + std::to_string(ref.size());
+    } else {
+        for (size_t i = 0; i < ref.size() && mismatch.empty(); i++) {
+            if (ref[i].size() != out[i].size()) {
+                mismatch = "component " + std::to_string(i) + " size differs";
+                break;
+            }
+            for (size_t k = 0; k < ref[i].size(); k++) {
+                if (ref[i][k].x != out[i][k].x || ref[i][k].y != out[i][k].y) {
+                    mismatch = "component " + std::to_string(i) + " differs at point " + std::to_string(k);
+                    break;
+                }
+            }
+        }
+    }
+    report.add(mismatch.empty(), mismatch.empty() ? 0.0 : 1.0, ref_ms, opt_ms, what + ": " + mismatch);
+
+    for (auto& c : ref) components.push_back(std::move(c));
+}
+
+static void check_rect(
+    const Options& opt, const std::vector<IntPoint>& contour, const std::string& what, KernelReport& report)
+{
+    RotatedRect ref, out;
+    double ref_ms, opt_ms;
+    time_pair(
+        opt.repeat, [&] { reference::get_min_area_rect(contour, ref); }, [&] { get_min_area_rect(contour, out); },
+        ref_ms, opt_ms);
+
+    const double pos_err = std::max({ std::abs(ref.center.x - out.center.x), std::abs(ref.center.y - out.center.y),
+        std::abs(ref.size.width - out.size.width), std::abs(ref.size.height - out.size.height) });
+    const double angle_err = std::abs(ref.angle - out.angle);
+    const bool ok = pos_err <= 1e-3 && angle_err <= 1e-3;
+    report.add(ok, std::max(pos_err, angle_err), ref_ms, opt_ms,
+        what + " error " + std::to_string(pos_err) + " px, " + std::to_string(angle_err) + " deg");
+}
+
+static void check_ctc(std::mt19937& rng, const Options& opt, const ncnn::Mat& logits, const std::string& what,
+    KernelReport& report)
+{
+    // Chunk borders for the optimized side, as used by the windowed rec path
+    std::vector<int> borders = { 0 };
+    while (borders.back() < logits.h)
+        borders.push_back(std::min(logits.h, borders.back() + std::uniform_int_distribution<int>(1, 64)(rng)));
+
+    std::vector<Character> ref, out;
+    double ref_ms, opt_ms;
+    time_pair(
+        opt.repeat,
+        [&] {
+            ref.clear();
+            reference::decode_ctc(logits, 0, logits.h, ref);
+        },
+        [&] {
+            out.clear();
+            int last_token = 0;
+            for (size_t i = 1; i < borders.size(); i++)
+                decode_ctc(logits, borders[i - 1], borders[i], out, &last_token);
+        },
+        ref_ms, opt_ms);
+
+    double err = 0.0;
+    bool ok = ref.size() == out.size();
+    for (size_t i = 0; ok && i < ref.size(); i++) {
+        ok = ref[i].id == out[i].id;
+        err = std::max(err, (double)std::abs(ref[i].prob - out[i].prob));
+    }
+    ok = ok && err <= 1e-6;
+    report.add(ok, err, ref_ms, opt_ms,
+        what + ": " + std::to_string(out.size()) + " characters, expected " + std::to_string(ref.size()));
+}
+
+// -------------------------------------------------------------------------
+
+static bool parse_args(int argc, char** argv, Options& opt)
+{
+#ifdef _OPENMP
+    opt.threads = omp_get_max_threads();
+#endif
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc || arg.compare(0, 2, "--") != 0) return false;
+        if (arg == "--corpus")
+            opt.corpus_dir = argv[++i];
+        else if (arg == "--cases")
+            opt.cases = std::max(0, atoi(argv[++i]));
+        else if (arg == "--seed")
+            opt.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--threads")
+            opt.threads = std::max(1, atoi(argv[++i]));
+        else if (arg == "--repeat")
+            opt.repeat = std::max(1, atoi(argv[++i]));
+        else if (arg == "--tol")
+            opt.tol = atof(argv[++i]);
+        else if (arg == "--out")
+            opt.out_path = argv[++i];
+        else
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        fprintf(stderr,
+            "Usage: conformance [--corpus DIR] [--cases N] [--seed N] [--threads N] [--repeat N] [--tol X] "
+            "[--out FILE]\n");
+        return 2;
+    }
+
+    std::mt19937 rng(opt.seed);
+    std::uniform_int_distribution<int> dim(16, 1024);
+    KernelReport warp("warp"), label("label"), rect("rect"), ctc("ctc"), crop("crop");
+    std::vector<std::vector<IntPoint>> components;
+
+    for (int i = 0; i < opt.cases; i++) {
+        const int w = dim(rng), h = dim(rng);
+        ncnn::Mat src = random_planar(rng, w, h);
+        const int dst_w = std::uniform_int_distribution<int>(16, 2048)(rng);
+        const int dst_h = i % 4 == 0 ? dim(rng) : 48; // mostly rec crops
+        check_warp(opt, src, random_transform(rng, w, h), dst_w, dst_h, describe("random", w, h), warp);
+
+        check_label(opt, random_map(rng, w, h), w, h, describe("random map", w, h), label, components);
+
+        check_rect(opt, random_cloud(rng), "random cloud " + std::to_string(i), rect);
+
+        const int steps = std::uniform_int_distribution<int>(1, 400)(rng);
+        const int classes = CTC_CLASSES[i % 3];
+        check_ctc(rng, opt, random_logits(rng, steps, classes), describe("random logits", classes, steps), ctc);
+
+        // Tall unrotated boxes, 2x to 8x the rec height
+        const int box_h = std::uniform_int_distribution<int>(2 * REC_HEIGHT, 8 * REC_HEIGHT)(rng);
+        const int box_w = std::uniform_int_distribution<int>(box_h / 2, 4 * box_h)(rng);
+        check_crop(opt, striped_rgba(rng, box_w, box_h), box_w, box_h, describe("striped box", box_w, box_h), crop);
+    }
+
+    std::vector<std::string> paths;
+    if (!opt.corpus_dir.empty()) {
+        paths = list_images(opt.corpus_dir);
+        if (paths.empty()) {
+            fprintf(stderr, "No images found in %s\n", opt.corpus_dir.c_str());
+            return 1;
+        }
+    }
+    for (const auto& path : paths) {
+        BenchImage image;
+        if (!load_image(path, image)) {
+            fprintf(stderr, "Cannot read image %s\n", path.c_str());
+            return 1;
+        }
+        const std::string name = std::filesystem::path(path).filename().string();
+        ncnn::Mat src = rgba_to_planar(image);
+        for (int k = 0; k < 8; k++) {
+            const int dst_w = std::uniform_int_distribution<int>(16, 2048)(rng);
+            check_warp(opt, src, random_transform(rng, image.width, image.height), dst_w, 48, name, warp);
+        }
+        check_label(opt, ink_map(image), image.width, image.height, name, label, components);
+        fprintf(stderr, "%s: done\n", name.c_str());
+    }
+
+    for (size_t i = 0; i < components.size(); i++)
+        check_rect(opt, components[i], "component " + std::to_string(i), rect);
+
+    const KernelReport* reports[] = { &warp, &label, &rect, &ctc, &crop };
+    int failures = 0;
+    printf("threads %d, seed %u, %zu corpus images\n\n", opt.threads, opt.seed, paths.size());
+    printf("%-6s %7s %8s %12s %10s %10s %8s\n", "Kernel", "Cases", "Failed", "Max error", "Ref ms", "Opt ms",
+        "Speedup");
+    for (const KernelReport* r : reports) {
+        printf("%-6s %7d %8d %12.3g %10.2f %10.2f %7.2fx\n", r->name.c_str(), r->cases, r->failures, r->max_error,
+            r->ref_ms, r->opt_ms, r->opt_ms > 0 ? r->ref_ms / r->opt_ms : 0.0);
+        if (r->failures) fprintf(stderr, "%s: first failure: %s\n", r->name.c_str(), r->first_failure.c_str());
+        failures += r->failures;
+    }
+
+    if (!opt.out_path.empty()) {
+        std::ostringstream js;
+        js << "{\n  \"variant\": \"" << build_variant() << "\",\n  \"threads\": " << opt.threads
+           << ",\n  \"seed\": " << opt.seed << ",\n  \"kernels\": [";
+        for (size_t i = 0; i < sizeof(reports) / sizeof(reports[0]); i++) {
+            const KernelReport* r = reports[i];
+            js << (i ? ",\n    " : "\n    ") << "{\"name\": \"" << r->name << "\", \"cases\": " << r->cases
+               << ", \"failures\": " << r->failures << ", \"max_error\": " << r->max_error
+               << ", \"ref_ms\": " << r->ref_ms << ", \"opt_ms\": " << r->opt_ms
+               << ", \"speedup\": " << (r->opt_ms > 0 ? r->ref_ms / r->opt_ms : 0.0)
+               << ", \"first_failure\": \"" << json_escape(r->first_failure) << "\"}";
+        }
+        js << "\n  ]\n}\n";
+        FILE* f = fopen(opt.out_path.c_str(), "wb");
+        if (!f) return 1;
+        fputs(js.str().c_str(), f);
+        fclose(f);
+    }
+
+    return failures ? 1 : 0;
+}
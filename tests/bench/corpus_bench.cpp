@@ -0,0 +1,246 @@
+// End-to-end corpus benchmark: runs OCREngine over a directory of images and
+// reports accuracy (CER against <image stem>.txt) together with latency
+// percentiles, per-stage times, throughput and peak memory as JSON.
+//
+// Native:  corpus-bench <image_dir> [options]
+// Wasm:    node corpus-bench.js <image_dir> [options]   (NODERAWFS build)
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include "bench_common.h"
+#include "ocr_engine.h"
+#include "trace.h"
+
+struct Options {
+    std::string image_dir;
+    std::string gt_dir; // defaults to image_dir
+    std::string model_dir = "assets/models";
+    std::string out_path; // stdout when empty
+    std::string trace_path; // Chrome trace of the timed iterations when set
+    std::string layers_path; // per-layer profile of one extra pass per image when set
+    int warmup = 2;
+    int iterations = 3;
+    int threads = 0; // 0 keeps the engine default
+};
+
+static void print_usage()
+{
+    fprintf(stderr,
+        "Usage: corpus-bench <image_dir> [--gt DIR] [--models DIR] [--warmup N] [--iterations N]\n"
+        "                    [--threads N] [--out FILE] [--trace FILE]\n"
+        "                    [--layers FILE]\n"
+        "Ground truth for foo.png is read from foo.txt; whitespace is ignored when scoring.\n");
+}
+
+static bool parse_args(int argc, char** argv, Options& opt)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--gt" && has_value)
+            opt.gt_dir = argv[++i];
+        else if (arg == "--models" && has_value)
+            opt.model_dir = argv[++i];
+        else if (arg == "--out" && has_value)
+            opt.out_path = argv[++i];
+        else if (arg == "--warmup" && has_value)
+            opt.warmup = std::max(0, atoi(argv[++i]));
+        else if (arg == "--iterations" && has_value)
+            opt.iterations = std::max(1, atoi(argv[++i]));
+        else if (arg == "--layers" && has_value)
+            opt.layers_path = argv[++i];
+        else if (arg == "--trace" && has_value)
+            opt.trace_path = argv[++i];
+        else if (arg == "--threads" && has_value)
+            opt.threads = std::max(0, atoi(argv[++i]));
+        else if (arg[0] != '-' && opt.image_dir.empty())
+            opt.image_dir = arg;
+        else
+            return false;
+    }
+    if (opt.gt_dir.empty()) opt.gt_dir = opt.image_dir;
+    return !opt.image_dir.empty();
+}
+
+struct ImageResult {
+    std::string name;
+    int width = 0;
+    int height = 0;
+    int boxes = 0;
+    int gt_chars = -1; // -1 = no ground truth
+    int edits = 0;
+    std::vector<double> latencies;
+};
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        print_usage();
+        return 2;
+    }
+
+    std::vector<std::string> paths = list_images(opt.image_dir);
+    if (paths.empty()) {
+        fprintf(stderr, "No images found in %s\n", opt.image_dir.c_str());
+        return 1;
+    }
+
+    OCREngine engine;
+    const std::string det_param = opt.model_dir + "/PP_OCRv5_mobile_det.ncnn.param";
+    const std::string det_bin = opt.model_dir + "/PP_OCRv5_mobile_det.ncnn.bin";
+    const std::string rec_param = opt.model_dir + "/PP_OCRv5_mobile_rec.ncnn.param";
+    const std::string rec_bin = opt.model_dir + "/PP_OCRv5_mobile_rec.ncnn.bin";
+    if (!std::filesystem::exists(det_param)) {
+        fprintf(stderr, "Models not found in %s (use --models)\n", opt.model_dir.c_str());
+        return 1;
+    }
+    engine.load_model(det_param.c_str(), det_bin.c_str(), rec_param.c_str(), rec_bin.c_str());
+    if (opt.threads > 0) engine.set_num_threads(opt.threads);
+    engine.warmup();
+
+    std::vector<ImageResult> results;
+    std::vector<double> all_latencies;
+    StageTimings stage_sum;
+    long total_boxes = 0;
+    double total_ms = 0.0;
+
+    for (const std::string& path : paths) {
+        BenchImage image;
+        if (!load_image(path, image)) {
+            fprintf(stderr, "Skipping unreadable image %s\n", path.c_str());
+            continue;
+        }
+
+        ImageResult r;
+        r.name = std::filesystem::path(path).filename().string();
+        r.width = image.width;
+        r.height = image.height;
+
+        for (int i = 0; i < opt.warmup; i++) engine.detect_objects(image.rgba.data(), image.width, image.height);
+
+        std::vector<Object> objects;
+        if (!opt.trace_path.empty() && !trace::enabled()) trace::start(1 << 20);
+        for (int i = 0; i < opt.iterations; i++) {
+            double t0 = now_ms();
+            objects = engine.detect_objects(image.rgba.data(), image.width, image.height);
+            double ms = now_ms() - t0;
+            r.latencies.push_back(ms);
+            all_latencies.push_back(ms);
+            total_ms += ms;
+            total_boxes += (long)objects.size();
+
+            const StageTimings& t = engine.last_timings();
+            stage_sum.det_preprocess += t.det_preprocess;
+            stage_sum.det_inference += t.det_inference;
+            stage_sum.det_postprocess += t.det_postprocess;
+            stage_sum.rec_preprocess += t.rec_preprocess;
+            stage_sum.rec_inference += t.rec_inference;
+            stage_sum.rec_decode += t.rec_decode;
+            stage_sum.layout += t.layout;
+            stage_sum.total += t.total;
+        }
+        r.boxes = (int)objects.size();
+
+        // Profiled pass outside the timed loop; layer-by-layer extraction is slower
+        if (!opt.layers_path.empty()) {
+            engine.set_layer_profiling(true);
+            engine.detect_objects(image.rgba.data(), image.width, image.height);
+            engine.set_layer_profiling(false);
+        }
+
+        std::string gt_text;
+        std::string gt_path = (std::filesystem::path(opt.gt_dir) / std::filesystem::path(path).stem()).string() + ".txt";
+        if (read_text_file(gt_path, gt_text)) {
+            std::string predicted;
+            for (const Object& obj : objects) predicted += decode_text(obj.text);
+            std::vector<unsigned int> gt = to_codepoints(gt_text);
+            r.gt_chars = (int)gt.size();
+            r.edits = edit_distance(to_codepoints(predicted), gt);
+        }
+
+        fprintf(stderr, "%s: %dx%d, %d boxes, p50 %.2f ms\n", r.name.c_str(), r.width, r.height, r.boxes,
+            percentile(r.latencies, 50));
+        results.push_back(r);
+    }
+
+    if (!opt.trace_path.empty()) {
+        trace::stop();
+        FILE* f = fopen(opt.trace_path.c_str(), "wb");
+        if (f) {
+            fputs(trace::export_json().c_str(), f);
+            fclose(f);
+            fprintf(stderr, "Wrote trace %s\n", opt.trace_path.c_str());
+        }
+    }
+
+    if (!opt.layers_path.empty()) {
+        FILE* f = fopen(opt.layers_path.c_str(), "wb");
+        if (f) {
+            fputs(engine.layer_profile_json().c_str(), f);
+            fclose(f);
+            fprintf(stderr, "Wrote layer profile %s\n", opt.layers_path.c_str());
+        }
+    }
+
+    long gt_chars = 0, edits = 0;
+    for (const auto& r : results) {
+        if (r.gt_chars < 0) continue;
+        gt_chars += r.gt_chars;
+        edits += r.edits;
+    }
+    const double runs = std::max<size_t>(all_latencies.size(), 1);
+
+    std::ostringstream js;
+    js << "{\n";
+    js << "  \"variant\": \"" << build_variant() << "\",\n";
+    js << "  \"threads\": " << opt.threads << ",\n";
+    js << "  \"images\": " << results.size() << ",\n";
+    js << "  \"iterations\": " << opt.iterations << ",\n";
+    if (gt_chars > 0)
+        js << "  \"cer\": " << (double)edits / gt_chars << ",\n";
+    else
+        js << "  \"cer\": null,\n";
+    js << "  \"gt_chars\": " << gt_chars << ",\n";
+    js << "  \"latency_ms\": {\"mean\": " << total_ms / runs << ", \"p50\": " << percentile(all_latencies, 50)
+       << ", \"p95\": " << percentile(all_latencies, 95) << ", \"p99\": " << percentile(all_latencies, 99)
+       << ", \"max\": " << percentile(all_latencies, 100) << "},\n";
+    js << "  \"stages_ms\": {\"det_preprocess\": " << stage_sum.det_preprocess / runs
+       << ", \"det_inference\": " << stage_sum.det_inference / runs
+       << ", \"det_postprocess\": " << stage_sum.det_postprocess / runs
+       << ", \"rec_preprocess\": " << stage_sum.rec_preprocess / runs
+       << ", \"rec_inference\": " << stage_sum.rec_inference / runs
+       << ", \"rec_decode\": " << stage_sum.rec_decode / runs << ", \"layout\": " << stage_sum.layout / runs
+       << ", \"total\": " << stage_sum.total / runs << "},\n";
+    js << "  \"boxes_per_second\": " << (total_ms > 0 ? total_boxes * 1000.0 / total_ms : 0.0) << ",\n";
+    js << "  \"peak_memory_kb\": " << peak_memory_kb() << ",\n";
+    js << "  \"per_image\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const ImageResult& r = results[i];
+        js << (i ? ",\n" : "\n") << "    {\"name\": \"" << json_escape(r.name) << "\", \"width\": " << r.width
+           << ", \"height\": " << r.height << ", \"boxes\": " << r.boxes << ", \"cer\": ";
+        if (r.gt_chars > 0)
+            js << (double)r.edits / r.gt_chars;
+        else
+            js << "null";
+        js << ", \"p50_ms\": " << percentile(r.latencies, 50) << "}";
+    }
+    js << "\n  ]\n}\n";
+
+    if (opt.out_path.empty()) {
+        fputs(js.str().c_str(), stdout);
+    } else {
+        FILE* f = fopen(opt.out_path.c_str(), "wb");
+        if (!f) {
+            fprintf(stderr, "Cannot write %s\n", opt.out_path.c_str());
+            return 1;
+        }
+        fputs(js.str().c_str(), f);
+        fclose(f);
+        fprintf(stderr, "Wrote %s\n", opt.out_path.c_str());
+    }
+    return 0;
+}
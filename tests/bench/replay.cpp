@@ -0,0 +1,193 @@
+// Replays a capture file written by OCREngine::start_capture(): every recorded
+// detect call is re-run with its original engine options, with timing,
+// tracing and per-layer profiling on. Calls captured without pixels are
+// listed (size, hash, original time) but cannot be re-run; calls captured
+// downscaled run at the stored size. Sequence-mode calls run once each, in
+// order, so every frame diffs against the one before it as when captured.
+// Calls answered from the result store are flagged; the replay recomputes
+// them (no store is open), so their captured time is a lookup.
+//
+// Usage: replay <capture> [--models DIR] [--iterations N] [--threads N]
+//               [--trace FILE] [--layers FILE] [--out FILE]
+
+#include <cinttypes>
+#include <cstdlib>
+#include <sstream>
+
+#include "bench_common.h"
+#include "capture.h"
+#include "ocr_engine.h"
+#include "trace.h"
+
+struct Options {
+    std::string capture_path;
+    std::string model_dir = "assets/models";
+    std::string out_path; // stdout when empty
+    std::string trace_path;
+    std::string layers_path;
+    int iterations = 3;
+    int threads = -1; // -1 keeps the captured thread budget
+};
+
+static bool parse_args(int argc, char** argv, Options& opt)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--models" && has_value)
+            opt.model_dir = argv[++i];
+        else if (arg == "--iterations" && has_value)
+            opt.iterations = std::max(1, atoi(argv[++i]));
+        else if (arg == "--threads" && has_value)
+            opt.threads = std::max(0, atoi(argv[++i]));
+        else if (arg == "--trace" && has_value)
+            opt.trace_path = argv[++i];
+        else if (arg == "--layers" && has_value)
+            opt.layers_path = argv[++i];
+        else if (arg == "--out" && has_value)
+            opt.out_path = argv[++i];
+        else if (arg[0] != '-' && opt.capture_path.empty())
+            opt.capture_path = arg;
+        else
+            return false;
+    }
+    return !opt.capture_path.empty();
+}
+
+// `prev` is the last call replayed, if any. The sequence settings are only
+// applied when they change, since applying them forgets the previous frame.
+static void apply_options(OCREngine& engine, const CaptureRecord& r, const CaptureRecord* prev, int threads_override)
+{
+    engine.set_text_score_threshold(r.text_score_threshold);
+    engine.set_rec_pack_width(r.rec_pack_width);
+    engine.set_rec_chunk_width(r.rec_chunk_width);
+    engine.set_axis_aligned_tolerance(r.axis_aligned_tolerance);
+    engine.set_rec_pyramid(r.rec_pyramid != 0);
+    engine.set_postprocess_threads(r.postprocess_threads);
+    engine.set_num_threads(threads_override >= 0 ? threads_override : r.num_threads);
+    if (!prev || prev->sequence_tile != r.sequence_tile || prev->sequence_margin != r.sequence_margin)
+        engine.set_sequence_mode(r.sequence_tile, r.sequence_margin);
+}
+
+static bool write_file(const std::string& path, const std::string& data)
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return false;
+    }
+    fputs(data.c_str(), f);
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        fprintf(stderr,
+            "Usage: replay <capture> [--models DIR] [--iterations N] [--threads N]\n"
+            "              [--trace FILE] [--layers FILE] [--out FILE]\n");
+        return 2;
+    }
+
+    CaptureReader reader;
+    if (!reader.open(opt.capture_path.c_str())) {
+        fprintf(stderr, "Not a capture file: %s\n", opt.capture_path.c_str());
+        return 1;
+    }
+
+    OCREngine engine;
+    const std::string det_param = opt.model_dir + "/PP_OCRv5_mobile_det.ncnn.param";
+    const std::string det_bin = opt.model_dir + "/PP_OCRv5_mobile_det.ncnn.bin";
+    const std::string rec_param = opt.model_dir + "/PP_OCRv5_mobile_rec.ncnn.param";
+    const std::string rec_bin = opt.model_dir + "/PP_OCRv5_mobile_rec.ncnn.bin";
+    if (!std::filesystem::exists(det_param)) {
+        fprintf(stderr, "Models not found in %s (use --models)\n", opt.model_dir.c_str());
+        return 1;
+    }
+    engine.load_model(det_param.c_str(), det_bin.c_str(), rec_param.c_str(), rec_bin.c_str());
+    engine.warmup();
+    if (!opt.trace_path.empty()) trace::start(1 << 20);
+
+    std::ostringstream js;
+    js << "{\n  \"variant\": \"" << build_variant() << "\",\n  \"capture\": \"" << json_escape(opt.capture_path)
+       << "\",\n  \"calls\": [";
+
+    CaptureRecord r, prev;
+    bool have_prev = false;
+    int index = 0, replayed = 0;
+    for (; reader.next(r); index++) {
+        char hash[17];
+        snprintf(hash, sizeof(hash), "%016" PRIx64, r.pixel_hash);
+        js << (index ? ",\n    " : "\n    ");
+        js << "{\"index\": " << index << ", \"width\": " << r.width << ", \"height\": " << r.height
+           << ", \"pixel_hash\": \"" << hash << "\", \"captured_ms\": " << r.total_ms
+           << ", \"captured_boxes\": " << r.boxes << ", \"options\": {\"text_score_threshold\": "
+           << r.text_score_threshold << ", \"rec_pack_width\": " << r.rec_pack_width
+           << ", \"rec_chunk_width\": " << r.rec_chunk_width << ", \"axis_aligned_tolerance\": "
+           << r.axis_aligned_tolerance << ", \"rec_pyramid\": " << r.rec_pyramid
+           << ", \"postprocess_threads\": " << r.postprocess_threads << ", \"num_threads\": " << r.num_threads
+           << ", \"sequence_tile\": " << r.sequence_tile << ", \"sequence_margin\": " << r.sequence_margin
+           << "}, \"captured_store_hit\": " << (r.store_hit ? "true" : "false");
+
+        if (r.rgb.empty()) {
+            fprintf(stderr, "call %d: %dx%d, pixels not captured (hash %s), captured %.1f ms\n", index, r.width,
+                r.height, hash, r.total_ms);
+            js << ", \"replay\": null}";
+            // The next sequence frame has nothing to diff against
+            engine.reset_sequence();
+            continue;
+        }
+
+        apply_options(engine, r, have_prev ? &prev : nullptr, opt.threads);
+        prev = r;
+        have_prev = true;
+        const std::vector<unsigned char> rgba = r.rgba();
+        const int iterations = r.sequence_tile > 0 ? 1 : opt.iterations;
+        std::vector<double> latencies;
+        StageTimings t;
+        size_t boxes = 0;
+        for (int i = 0; i < iterations; i++) {
+            double t0 = now_ms();
+            boxes = engine.detect_objects(rgba.data(), r.stored_width, r.stored_height).size();
+            latencies.push_back(now_ms() - t0);
+            t = engine.last_timings();
+        }
+        if (!opt.layers_path.empty() && r.sequence_tile == 0) {
+            engine.set_layer_profiling(true);
+            engine.detect_objects(rgba.data(), r.stored_width, r.stored_height);
+            engine.set_layer_profiling(false);
+        }
+        replayed++;
+
+        const double p50 = percentile(latencies, 50);
+        fprintf(stderr, "call %d: %dx%d%s%s, captured %.1f ms / %d boxes%s, replay p50 %.1f ms / %zu boxes\n", index,
+            r.stored_width, r.stored_height,
+            (r.stored_width != r.width || r.stored_height != r.height) ? " (downscaled)" : "",
+            r.sequence_tile > 0 ? " (sequence)" : "", r.total_ms, r.boxes, r.store_hit ? " (store hit)" : "", p50,
+            boxes);
+        js << ", \"replay\": {\"width\": " << r.stored_width << ", \"height\": " << r.stored_height
+           << ", \"p50_ms\": " << p50 << ", \"min_ms\": " << *std::min_element(latencies.begin(), latencies.end())
+           << ", \"boxes\": " << boxes << ", \"stages_ms\": {\"det_preprocess\": " << t.det_preprocess
+           << ", \"det_inference\": " << t.det_inference << ", \"det_postprocess\": " << t.det_postprocess
+           << ", \"rec_preprocess\": " << t.rec_preprocess << ", \"rec_inference\": " << t.rec_inference
+           << ", \"rec_decode\": " << t.rec_decode << ", \"layout\": " << t.layout << "}}}";
+    }
+    js << "\n  ],\n  \"latency_stats\": " << engine.latency_stats_json() << "\n}\n";
+    fprintf(stderr, "%d calls, %d replayed\n", index, replayed);
+
+    if (!opt.trace_path.empty()) {
+        trace::stop();
+        if (write_file(opt.trace_path, trace::export_json())) fprintf(stderr, "Wrote trace %s\n", opt.trace_path.c_str());
+    }
+    if (!opt.layers_path.empty() && write_file(opt.layers_path, engine.layer_profile_json())) {
+        fprintf(stderr, "Wrote layer profile %s\n", opt.layers_path.c_str());
+    }
+    if (opt.out_path.empty()) {
+        fputs(js.str().c_str(), stdout);
+    } else if (!write_file(opt.out_path, js.str())) {
+        return 1;
+    }
+    return 0;
+}
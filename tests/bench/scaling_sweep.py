@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""Stage-time scaling sweeps over synthetic pages.
+
+For every value of one page parameter, generates pages with synth_pages.py,
+runs corpus-bench on them and records the per-stage times. Writes
+<out>/<param>.csv, a plot <out>/<param>.png when matplotlib is available, and
+prints each stage's log-log slope so superlinear stages stand out (a slope
+well above 1 against `lines` means cost grows faster than the work).
+
+Usage:
+    python3 tests/bench/scaling_sweep.py --runner build/bench-native/corpus-bench \\
+        --param lines --values 1,10,100,1000,5000 --font-size 14
+    python3 tests/bench/scaling_sweep.py --runner "node build/bench-tools/simd/corpus-bench.js" \\
+        --param angle --values 0,5,15,30,45
+"""
+
+import argparse
+import csv
+import json
+import math
+import os
+import shlex
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import synth_pages  # noqa: E402
+
+STAGES = [
+    "det_preprocess",
+    "det_inference",
+    "det_postprocess",
+    "rec_preprocess",
+    "rec_inference",
+    "rec_decode",
+    "layout",
+    "total",
+]
+
+# Sweepable parameters and the synth_pages key they drive
+PARAMS = {
+    "lines": "lines",
+    "chars": "chars",
+    "font-size": "font_size",
+    "angle": "angle",
+    "noise": "noise",
+    "size": "size",
+}
+
+
+def run_point(args, value, base_params):
+    params = dict(base_params)
+    key = PARAMS[args.param]
+    params[key] = type(synth_pages.DEFAULTS[key])(value)
+    point_dir = os.path.join(args.out, f"{args.param}-{value}")
+    synth_pages.generate_set(point_dir, params, args.pages, args.font, args.seed)
+
+    result_path = os.path.join(point_dir, "result.json")
+    cmd = shlex.split(args.runner) + [
+        point_dir,
+        "--models", args.models,
+        "--warmup", str(args.warmup),
+        "--iterations", str(args.iterations),
+        "--out", result_path,
+    ]
+    if args.threads:
+        cmd += ["--threads", str(args.threads)]
+    subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL)
+    with open(result_path) as f:
+        return json.load(f)
+
+
+def loglog_slope(xs, ys):
+    """Least-squares slope of log(y) over log(x), using points with x, y > 0."""
+    pts = [(math.log(x), math.log(y)) for x, y in zip(xs, ys) if x > 0 and y > 0]
+    if len(pts) < 2:
+        return None
+    mx = sum(p[0] for p in pts) / len(pts)
+    my = sum(p[1] for p in pts) / len(pts)
+    den = sum((p[0] - mx) ** 2 for p in pts)
+    if den == 0:
+        return None
+    return sum((p[0] - mx) * (p[1] - my) for p in pts) / den
+
+
+def plot(args, values, rows):
+    try:
+        import matplotlib
+
+        matplotlib.use("Agg")
+        import matplotlib.pyplot as plt
+    except ImportError:
+        print("matplotlib not installed; skipping plot", file=sys.stderr)
+        return
+    fig, ax = plt.subplots(figsize=(8, 5))
+    for stage in STAGES:
+        ax.plot(values, [r[stage] for r in rows], marker="o", label=stage)
+    if args.param in ("lines", "chars", "size") and min(values) > 0:
+        ax.set_xscale("log")
+        ax.set_yscale("log")
+    ax.set_xlabel(args.param)
+    ax.set_ylabel("ms per image")
+    ax.set_title(f"Stage time vs {args.param}")
+    ax.grid(True, which="both", alpha=0.3)
+    ax.legend(fontsize=8)
+    path = os.path.join(args.out, f"{args.param}.png")
+    fig.savefig(path, dpi=120, bbox_inches="tight")
+    print(f"Wrote {path}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--runner", required=True, help="corpus-bench command (native binary or 'node corpus-bench.js')")
+    parser.add_argument("--param", required=True, choices=sorted(PARAMS))
+    parser.add_argument("--values", required=True, help="comma separated parameter values")
+    parser.add_argument("--out", default=os.path.join(synth_pages.ROOT_DIR, "build", "sweeps"))
+    parser.add_argument("--models", default=os.path.join(synth_pages.ROOT_DIR, "assets", "models"))
+    parser.add_argument("--pages", type=int, default=2, help="pages per point")
+    parser.add_argument("--warmup", type=int, default=1)
+    parser.add_argument("--iterations", type=int, default=3)
+    parser.add_argument("--threads", type=int, default=0)
+    synth_pages.add_page_args(parser)
+    args = parser.parse_args()
+
+    base_params = synth_pages.page_params(args)
+    values = [float(v) if "." in v else int(v) for v in args.values.split(",")]
+
+    rows = []
+    for value in values:
+        result = run_point(args, value, base_params)
+        row = dict(result["stages_ms"])
+        row["value"] = value
+        row["boxes"] = sum(img["boxes"] for img in result["per_image"]) / max(1, len(result["per_image"]))
+        row["cer"] = result["cer"]
+        rows.append(row)
+        print(f"{args.param}={value}: total {row['total']:.1f} ms, {row['boxes']:.0f} boxes, cer {row['cer']}")
+
+    os.makedirs(args.out, exist_ok=True)
+    csv_path = os.path.join(args.out, f"{args.param}.csv")
+    with open(csv_path, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=["value", "boxes", "cer"] + STAGES)
+        writer.writeheader()
+        writer.writerows(rows)
+    print(f"Wrote {csv_path}")
+
+    print(f"\nlog-log slope of stage time vs {args.param}:")
+    for stage in STAGES:
+        slope = loglog_slope(values, [r[stage] for r in rows])
+        if slope is None:
+            continue
+        flag = "  <- superlinear" if slope > 1.2 else ""
+        print(f"  {stage:16s} {slope:5.2f}{flag}")
+
+    plot(args, values, rows)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,218 @@
+// Sequence-mode benchmark: turns every corpus image into a run of frames where
+// each frame moves one block of the previous frame elsewhere (a scrolled or
+// edited window), then times the frames with full detect calls and with
+// sequence mode. Reports latency per share of changed pixels, the boxes
+// carried over and how far the sequence-mode text is from the full run.
+//
+// Usage: sequence-bench <image_dir> [--models DIR] [--frames N] [--change LIST]
+//                       [--tile N] [--margin N] [--seed N] [--threads N] [--out FILE]
+
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+
+#include "bench_common.h"
+#include "ocr_engine.h"
+
+struct Options {
+    std::string image_dir;
+    std::string model_dir = "assets/models";
+    std::string out_path; // stdout when empty
+    int frames = 8; // timed frames after the first one
+    std::vector<double> changes = { 0.0, 1.0, 5.0, 20.0 }; // % of the frame moved per step
+    int tile = 32;
+    int margin = 32;
+    unsigned seed = 1;
+    int threads = 0; // 0 keeps the engine default
+};
+
+static void print_usage()
+{
+    fprintf(stderr,
+        "Usage: sequence-bench <image_dir> [--models DIR] [--frames N] [--change 0,1,5,20]\n"
+        "                      [--tile N] [--margin N] [--seed N] [--threads N] [--out FILE]\n");
+}
+
+static bool parse_args(int argc, char** argv, Options& opt)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--models" && has_value) {
+            opt.model_dir = argv[++i];
+        } else if (arg == "--frames" && has_value) {
+            opt.frames = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--change" && has_value) {
+            opt.changes.clear();
+            std::stringstream ss(argv[++i]);
+            std::string item;
+            while (std::getline(ss, item, ',')) opt.changes.push_back(std::max(0.0, atof(item.c_str())));
+        } else if (arg == "--tile" && has_value) {
+            opt.tile = std::max(8, atoi(argv[++i]));
+        } else if (arg == "--margin" && has_value) {
+            opt.margin = std::max(0, atoi(argv[++i]));
+        } else if (arg == "--seed" && has_value) {
+            opt.seed = (unsigned)atoi(argv[++i]);
+        } else if (arg == "--threads" && has_value) {
+            opt.threads = std::max(0, atoi(argv[++i]));
+        } else if (arg == "--out" && has_value) {
+            opt.out_path = argv[++i];
+        } else if (arg[0] != '-' && opt.image_dir.empty()) {
+            opt.image_dir = arg;
+        } else {
+            return false;
+        }
+    }
+    return !opt.image_dir.empty() && !opt.changes.empty();
+}
+
+// Copies a 4:1 block covering `percent` of the frame to another random place
+static void move_block(std::vector<unsigned char>& rgba, int width, int height, double percent, std::mt19937& rng)
+{
+    const double area = width * (double)height * percent / 100.0;
+    const int bw = std::min(width, std::max(1, (int)std::sqrt(area * 4.0)));
+    const int bh = std::min(height, std::max(1, (int)(area / bw)));
+    std::uniform_int_distribution<int> xs(0, width - bw), ys(0, height - bh);
+    const int sx = xs(rng), sy = ys(rng), dx = xs(rng), dy = ys(rng);
+    std::vector<unsigned char> block((size_t)bw * bh * 4);
+    for (int y = 0; y < bh; y++) {
+        memcpy(block.data() + (size_t)y * bw * 4, rgba.data() + ((size_t)(sy + y) * width + sx) * 4, (size_t)bw * 4);
+    }
+    for (int y = 0; y < bh; y++) {
+        memcpy(rgba.data() + ((size_t)(dy + y) * width + dx) * 4, block.data() + (size_t)y * bw * 4, (size_t)bw * 4);
+    }
+}
+
+static std::string joined_text(const std::vector<Object>& objects)
+{
+    std::string text;
+    for (const Object& obj : objects) text += decode_text(obj.text);
+    return text;
+}
+
+struct ChangeResult {
+    double percent = 0.0;
+    std::vector<double> full_ms;
+    std::vector<double> sequence_ms;
+    long boxes = 0;
+    long boxes_reused = 0;
+    long full_chars = 0;
+    long edits = 0; // sequence-mode text vs full-run text
+};
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        print_usage();
+        return 2;
+    }
+
+    std::vector<std::string> paths = list_images(opt.image_dir);
+    if (paths.empty()) {
+        fprintf(stderr, "No images found in %s\n", opt.image_dir.c_str());
+        return 1;
+    }
+
+    OCREngine engine;
+    const std::string det_param = opt.model_dir + "/PP_OCRv5_mobile_det.ncnn.param";
+    const std::string det_bin = opt.model_dir + "/PP_OCRv5_mobile_det.ncnn.bin";
+    const std::string rec_param = opt.model_dir + "/PP_OCRv5_mobile_rec.ncnn.param";
+    const std::string rec_bin = opt.model_dir + "/PP_OCRv5_mobile_rec.ncnn.bin";
+    if (!std::filesystem::exists(det_param)) {
+        fprintf(stderr, "Models not found in %s (use --models)\n", opt.model_dir.c_str());
+        return 1;
+    }
+    engine.load_model(det_param.c_str(), det_bin.c_str(), rec_param.c_str(), rec_bin.c_str());
+    if (opt.threads > 0) engine.set_num_threads(opt.threads);
+    engine.warmup();
+
+    std::vector<ChangeResult> results(opt.changes.size());
+    for (size_t c = 0; c < opt.changes.size(); c++) results[c].percent = opt.changes[c];
+
+    for (const std::string& path : paths) {
+        BenchImage image;
+        if (!load_image(path, image)) {
+            fprintf(stderr, "Skipping unreadable image %s\n", path.c_str());
+            continue;
+        }
+
+        for (ChangeResult& r : results) {
+            std::mt19937 rng(opt.seed);
+            std::vector<std::vector<unsigned char>> frames(1, image.rgba);
+            for (int f = 0; f < opt.frames; f++) {
+                frames.push_back(frames.back());
+                if (r.percent > 0.0) move_block(frames.back(), image.width, image.height, r.percent, rng);
+            }
+
+            engine.set_sequence_mode(0, 0);
+            std::vector<std::string> full_text;
+            for (size_t f = 1; f < frames.size(); f++) {
+                const double t0 = now_ms();
+                std::vector<Object> objects = engine.detect_objects(frames[f].data(), image.width, image.height);
+                r.full_ms.push_back(now_ms() - t0);
+                full_text.push_back(joined_text(objects));
+            }
+
+            engine.set_sequence_mode(opt.tile, opt.margin);
+            engine.detect_objects(frames[0].data(), image.width, image.height);
+            for (size_t f = 1; f < frames.size(); f++) {
+                const double t0 = now_ms();
+                std::vector<Object> objects = engine.detect_objects(frames[f].data(), image.width, image.height);
+                r.sequence_ms.push_back(now_ms() - t0);
+
+                const StageTimings& t = engine.last_timings();
+                r.boxes += (long)objects.size();
+                r.boxes_reused += t.boxes_reused;
+                std::vector<unsigned int> reference = to_codepoints(full_text[f - 1]);
+                r.full_chars += (long)reference.size();
+                r.edits += edit_distance(to_codepoints(joined_text(objects)), reference);
+            }
+        }
+        fprintf(stderr, "%s: %dx%d done\n", std::filesystem::path(path).filename().string().c_str(), image.width,
+            image.height);
+    }
+    engine.set_sequence_mode(0, 0);
+
+    fprintf(stderr, "%-8s %10s %10s %8s %8s %10s\n", "Change", "Full p50", "Seq p50", "Speedup", "Reused", "Text diff");
+    for (const ChangeResult& r : results) {
+        const double full = percentile(r.full_ms, 50), seq = percentile(r.sequence_ms, 50);
+        fprintf(stderr, "%6.1f%% %8.2fms %8.2fms %7.2fx %7.1f%% %9.3f%%\n", r.percent, full, seq,
+            seq > 0 ? full / seq : 0.0, r.boxes ? 100.0 * r.boxes_reused / r.boxes : 0.0, r.full_chars ? 100.0 * r.edits / r.full_chars : 0.0);
+    }
+
+    std::ostringstream js;
+    js << "{\n";
+    js << "  \"variant\": \"" << build_variant() << "\",\n";
+    js << "  \"threads\": " << opt.threads << ",\n";
+    js << "  \"images\": " << paths.size() << ",\n";
+    js << "  \"frames\": " << opt.frames << ",\n";
+    js << "  \"tile\": " << opt.tile << ",\n";
+    js << "  \"margin\": " << opt.margin << ",\n";
+    js << "  \"changes\": [";
+    for (size_t c = 0; c < results.size(); c++) {
+        const ChangeResult& r = results[c];
+        js << (c ? ",\n" : "\n") << "    {\"percent\": " << r.percent
+           << ", \"full_ms\": {\"p50\": " << percentile(r.full_ms, 50) << ", \"p95\": " << percentile(r.full_ms, 95)
+           << "}, \"sequence_ms\": {\"p50\": " << percentile(r.sequence_ms, 50)
+           << ", \"p95\": " << percentile(r.sequence_ms, 95) << "}, \"boxes\": " << r.boxes
+           << ", \"boxes_reused\": " << r.boxes_reused
+           << ", \"text_diff\": " << (r.full_chars ? (double)r.edits / r.full_chars : 0.0) << "}";
+    }
+    js << "\n  ]\n}\n";
+
+    if (opt.out_path.empty()) {
+        fputs(js.str().c_str(), stdout);
+    } else {
+        FILE* f = fopen(opt.out_path.c_str(), "wb");
+        if (!f) {
+            fprintf(stderr, "Cannot write %s\n", opt.out_path.c_str());
+            return 1;
+        }
+        fputs(js.str().c_str(), f);
+        fclose(f);
+        fprintf(stderr, "Wrote %s\n", opt.out_path.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,234 @@
+#!/usr/bin/env python3
+"""Synthetic OCR pages for scaling tests.
+
+Renders pages of text lines from local font files with a controllable line
+count, line length (box aspect ratio), font size, rotation, noise and page
+size. Every page is written as:
+
+    <name>.png   the image
+    <name>.txt   the line texts in reading order (ground truth for corpus-bench)
+    <name>.json  page parameters and the rotated box of every line
+
+Lines are laid out column-major (top to bottom, then the next column) with
+wide column gaps, so the reading order is unambiguous at any line count.
+
+Usage:
+    python3 tests/bench/synth_pages.py --out build/synth/lines-1000 --lines 1000 --font-size 16
+Requires Pillow.
+"""
+
+import argparse
+import glob
+import json
+import math
+import os
+import random
+import re
+import sys
+
+from PIL import Image, ImageChops, ImageDraw, ImageFilter, ImageFont
+
+ROOT_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), "..", ".."))
+DICT_PATH = os.path.join(ROOT_DIR, "src", "core", "ppocrv5_dict.h")
+
+LATIN_CHARSET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"
+
+FONT_DIRS = [
+    "/usr/share/fonts",
+    "/usr/local/share/fonts",
+    os.path.expanduser("~/.fonts"),
+    "/System/Library/Fonts",
+    "/Library/Fonts",
+    "C:\\Windows\\Fonts",
+]
+
+DEFAULTS = {
+    "lines": 20,
+    "font_size": 24,
+    "chars": 16,
+    "chars_jitter": 0.3,
+    "angle": 0.0,
+    "angle_jitter": 0.0,
+    "noise": 0.0,
+    "blur": 0.0,
+    "size": 0,  # square page side in px, 0 = fit the text
+    "charset": "latin",
+}
+
+
+def find_fonts(paths):
+    """Font files given on the command line, or every TTF/OTF in the usual system directories."""
+    fonts = []
+    for p in paths or []:
+        if os.path.isdir(p):
+            fonts += sorted(glob.glob(os.path.join(p, "**", "*.[ot]tf"), recursive=True))
+        else:
+            fonts.append(p)
+    if not fonts:
+        for d in FONT_DIRS:
+            fonts += sorted(glob.glob(os.path.join(d, "**", "*.[ot]tf"), recursive=True))
+    if not fonts:
+        sys.exit("No font files found; pass --font <file or dir>")
+    return fonts
+
+
+def load_charset(name):
+    if name == "latin":
+        return LATIN_CHARSET
+    if name == "dict":
+        # Characters the rec model knows; needs a font that covers CJK
+        with open(DICT_PATH, encoding="utf-8") as f:
+            chars = re.findall(r'^\s*"(.*)",\s*$', f.read(), re.M)
+        return [c for c in chars if len(c) == 1 and not c.isspace() and c not in '\\"']
+    return name  # a literal character set
+
+
+def rotated_corners(w, h, angle):
+    """Corners (TL, TR, BR, BL) of a w x h box rotated counter-clockwise by `angle`
+    degrees about its center, relative to the center."""
+    a = math.radians(angle)
+    cos_a, sin_a = math.cos(a), math.sin(a)
+    pts = []
+    for dx, dy in ((-w / 2, -h / 2), (w / 2, -h / 2), (w / 2, h / 2), (-w / 2, h / 2)):
+        pts.append((dx * cos_a + dy * sin_a, -dx * sin_a + dy * cos_a))
+    return pts
+
+
+def render_line(text, font, angle):
+    """Returns (mask, text_w, text_h): an L mask of the rotated line and its unrotated size."""
+    left, top, right, bottom = font.getbbox(text)
+    w, h = right - left, bottom - top
+    mask = Image.new("L", (w, h), 0)
+    ImageDraw.Draw(mask).text((-left, -top), text, font=font, fill=255)
+    if angle:
+        mask = mask.rotate(angle, resample=Image.BICUBIC, expand=True)
+    return mask, w, h
+
+
+def generate_page(params, fonts, rng):
+    """Renders one page. Returns (image, lines) with lines as {text, box, angle}."""
+    p = dict(DEFAULTS, **params)
+    charset = load_charset(p["charset"])
+    font = ImageFont.truetype(rng.choice(fonts), int(p["font_size"]))
+
+    items = []
+    for _ in range(int(p["lines"])):
+        n = max(1, round(p["chars"] * (1 + rng.uniform(-p["chars_jitter"], p["chars_jitter"]))))
+        text = "".join(rng.choice(charset) for _ in range(n))
+        angle = p["angle"] + rng.uniform(-p["angle_jitter"], p["angle_jitter"])
+        mask, w, h = render_line(text, font, angle)
+        items.append((text, angle, mask, w, h))
+
+    # Column-major layout; the column count keeps the page roughly square
+    gap_y = int(p["font_size"] * 0.8)
+    gap_x = int(p["font_size"] * 3)
+    margin = int(p["font_size"] * 2)
+    col_w = max(m.width for _, _, m, _, _ in items)
+    total_h = sum(m.height + gap_y for _, _, m, _, _ in items)
+    cols = max(1, round(math.sqrt(total_h / (col_w + gap_x))))
+    if p["size"]:
+        cols = max(1, min(cols, (p["size"] - 2 * margin + gap_x) // (col_w + gap_x)))
+    per_col = math.ceil(len(items) / cols)
+
+    placements = []
+    x, y, col_bottom = margin, margin, margin
+    for i, (text, angle, mask, w, h) in enumerate(items):
+        if i > 0 and i % per_col == 0:
+            x += col_w + gap_x
+            y = margin
+        placements.append((x, y))
+        y += mask.height + gap_y
+        col_bottom = max(col_bottom, y)
+
+    page_w = max(x + col_w + margin, p["size"])
+    page_h = max(col_bottom + margin - gap_y, p["size"])
+    if p["size"] and (page_w > p["size"] or page_h > p["size"]):
+        print(f"warning: {len(items)} lines do not fit a {p['size']}px page; "
+              f"using {page_w}x{page_h}", file=sys.stderr)
+
+    page = Image.new("L", (page_w, page_h), 255)
+    ink = Image.new("L", (page_w, page_h), 0)
+    lines = []
+    for (text, angle, mask, w, h), (px, py) in zip(items, placements):
+        page.paste(ink.crop((0, 0, mask.width, mask.height)), (px, py), mask)
+        cx, cy = px + mask.width / 2, py + mask.height / 2
+        box = [[round(cx + dx, 1), round(cy + dy, 1)] for dx, dy in rotated_corners(w, h, angle)]
+        lines.append({"text": text, "box": box, "angle": round(angle, 2)})
+
+    if p["blur"] > 0:
+        page = page.filter(ImageFilter.GaussianBlur(p["blur"]))
+    if p["noise"] > 0:
+        noise = Image.effect_noise(page.size, p["noise"])
+        page = ImageChops.add(page, noise, 1.0, -128)
+    return page.convert("RGB"), lines
+
+
+def generate_set(out_dir, params, count=1, fonts=None, seed=0, prefix="page"):
+    """Writes `count` pages with the same parameters into `out_dir`; returns their paths."""
+    os.makedirs(out_dir, exist_ok=True)
+    fonts = find_fonts(fonts)
+    rng = random.Random(seed)
+    paths = []
+    for k in range(count):
+        image, lines = generate_page(params, fonts, rng)
+        stem = os.path.join(out_dir, f"{prefix}-{k:03d}")
+        image.save(stem + ".png")
+        with open(stem + ".txt", "w", encoding="utf-8") as f:
+            f.write("\n".join(line["text"] for line in lines) + "\n")
+        with open(stem + ".json", "w", encoding="utf-8") as f:
+            meta = {"width": image.width, "height": image.height, "params": dict(DEFAULTS, **params)}
+            json.dump(dict(meta, lines=lines), f, ensure_ascii=False)
+        paths.append(stem + ".png")
+    return paths
+
+
+def add_page_args(parser):
+    parser.add_argument("--lines", type=int, default=DEFAULTS["lines"], help="text lines per page (1-5000)")
+    parser.add_argument("--font-size", type=int, default=DEFAULTS["font_size"], help="font size in px")
+    parser.add_argument("--chars", type=int, default=DEFAULTS["chars"],
+                        help="characters per line, i.e. the aspect ratio of the line boxes")
+    parser.add_argument("--chars-jitter", type=float, default=DEFAULTS["chars_jitter"],
+                        help="relative random variation of the line length")
+    parser.add_argument("--angle", type=float, default=DEFAULTS["angle"], help="line rotation in degrees")
+    parser.add_argument("--angle-jitter", type=float, default=DEFAULTS["angle_jitter"],
+                        help="uniform random rotation added per line, in degrees")
+    parser.add_argument("--noise", type=float, default=DEFAULTS["noise"], help="gaussian noise sigma (0-255)")
+    parser.add_argument("--blur", type=float, default=DEFAULTS["blur"], help="gaussian blur radius in px")
+    parser.add_argument("--size", type=int, default=DEFAULTS["size"],
+                        help="square page side in px (0 = fit the text)")
+    parser.add_argument("--charset", default=DEFAULTS["charset"],
+                        help="'latin', 'dict' (rec dictionary, needs a CJK font) or literal characters")
+    parser.add_argument("--font", action="append", help="font file or directory (repeatable)")
+    parser.add_argument("--seed", type=int, default=0)
+
+
+def page_params(args):
+    return {
+        "lines": args.lines,
+        "font_size": args.font_size,
+        "chars": args.chars,
+        "chars_jitter": args.chars_jitter,
+        "angle": args.angle,
+        "angle_jitter": args.angle_jitter,
+        "noise": args.noise,
+        "blur": args.blur,
+        "size": args.size,
+        "charset": args.charset,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--out", required=True, help="output directory")
+    parser.add_argument("--count", type=int, default=1, help="pages to generate")
+    add_page_args(parser)
+    args = parser.parse_args()
+
+    if not 1 <= args.lines <= 5000:
+        parser.error("--lines must be between 1 and 5000")
+    paths = generate_set(args.out, page_params(args), args.count, args.font, args.seed)
+    print(f"Wrote {len(paths)} page(s) to {args.out}")
+
+
+if __name__ == "__main__":
+    main()
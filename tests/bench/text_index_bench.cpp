@@ -0,0 +1,332 @@
+// Text index benchmark: fills a TextIndex with synthetic recognized lines
+// (character ids drawn Zipf-like from the CJK part of the dictionary), then
+// times phrase queries of each length against a linear scan of the same lines
+// as UTF-8, which is what searching the JSON results in JS amounts to. Both
+// must find the same boxes. Then a share of the images is re-indexed with new
+// text, and most of them are removed, so the index rebuilds; the queries are
+// checked again after each step.
+// Exits with 1 when the index and the scan disagree.
+//
+// Usage: text-index-bench [--lines N] [--boxes N] [--queries N] [--lengths LIST]
+//                         [--churn PERCENT] [--seed N] [--out FILE]
+
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <set>
+#include <sstream>
+
+#include "bench_common.h"
+#include "ppocrv5_dict.h"
+#include "text_index.h"
+
+struct Options {
+    std::string out_path; // stdout when empty
+    int lines = 100000;
+    int boxes = 20; // lines per image
+    int queries = 200; // per phrase length
+    std::vector<int> lengths = { 1, 2, 3, 4, 6, 8 };
+    double churn = 10.0; // % of the images re-indexed
+    unsigned seed = 1;
+};
+
+static void print_usage()
+{
+    fprintf(stderr,
+        "Usage: text-index-bench [--lines N] [--boxes N] [--queries N] [--lengths 1,2,3,4,6,8]\n"
+        "                        [--churn PERCENT] [--seed N] [--out FILE]\n");
+}
+
+static bool parse_args(int argc, char** argv, Options& opt)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--lines" && has_value) {
+            opt.lines = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--boxes" && has_value) {
+            opt.boxes = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--queries" && has_value) {
+            opt.queries = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--lengths" && has_value) {
+            opt.lengths.clear();
+            std::stringstream ss(argv[++i]);
+            std::string item;
+            while (std::getline(ss, item, ',')) opt.lengths.push_back(std::max(1, atoi(item.c_str())));
+        } else if (arg == "--churn" && has_value) {
+            opt.churn = std::min(100.0, std::max(0.0, atof(argv[++i])));
+        } else if (arg == "--seed" && has_value) {
+            opt.seed = (unsigned)atoi(argv[++i]);
+        } else if (arg == "--out" && has_value) {
+            opt.out_path = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return !opt.lengths.empty();
+}
+
+// Character ids with a Zipf-like frequency (rank r drawn with weight 1/r),
+// over the single-codepoint CJK entries of the dictionary
+class CharSource {
+public:
+    CharSource()
+    {
+        for (int id = 0; id < character_dict_size; id++) {
+            std::vector<unsigned int> cps = to_codepoints(character_dict[id]);
+            if (cps.size() == 1 && cps[0] >= 0x4E00 && cps[0] <= 0x9FFF) m_ids.push_back(id);
+        }
+        double sum = 0.0;
+        for (size_t r = 0; r < m_ids.size(); r++) {
+            sum += 1.0 / (r + 1);
+            m_cdf.push_back(sum);
+        }
+    }
+
+    int next(std::mt19937& rng) const
+    {
+        std::uniform_real_distribution<double> u(0.0, m_cdf.back());
+        size_t r = std::lower_bound(m_cdf.begin(), m_cdf.end(), u(rng)) - m_cdf.begin();
+        return m_ids[std::min(r, m_ids.size() - 1)];
+    }
+
+private:
+    std::vector<int> m_ids;
+    std::vector<double> m_cdf;
+};
+
+struct Box {
+    std::vector<int> ids;
+    std::string utf8;
+};
+
+// Boxes of every image, as indexed and as the UTF-8 a JS scan would see
+struct Corpus {
+    std::vector<std::vector<Box>> images;
+};
+
+static std::string to_utf8(const std::vector<int>& ids)
+{
+    std::string s;
+    for (int id : ids) s += character_dict[id];
+    return s;
+}
+
+static std::vector<Box> make_image(int boxes, const CharSource& chars, std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> length(4, 32);
+    std::vector<Box> image(boxes);
+    for (Box& box : image) {
+        box.ids.resize(length(rng));
+        for (int& id : box.ids) id = chars.next(rng);
+        box.utf8 = to_utf8(box.ids);
+    }
+    return image;
+}
+
+static void index_image(TextIndex& index, uint32_t image_id, const std::vector<Box>& image)
+{
+    for (size_t b = 0; b < image.size(); b++) {
+        index.add(image_id, (uint32_t)b, image[b].ids.data(), image[b].ids.size());
+    }
+}
+
+// Boxes containing the phrase, by linear scan over the UTF-8 text
+static std::set<std::pair<uint32_t, uint32_t>> scan(const Corpus& corpus, const std::string& phrase)
+{
+    std::set<std::pair<uint32_t, uint32_t>> found;
+    for (size_t i = 0; i < corpus.images.size(); i++) {
+        for (size_t b = 0; b < corpus.images[i].size(); b++) {
+            if (corpus.images[i][b].utf8.find(phrase) != std::string::npos) found.insert({ (uint32_t)i, (uint32_t)b });
+        }
+    }
+    return found;
+}
+
+struct Query {
+    std::vector<int> ids;
+    std::string utf8;
+};
+
+// Half the phrases are cut from indexed boxes, half are random
+static std::vector<Query> make_queries(
+    const Corpus& corpus, int length, int count, const CharSource& chars, std::mt19937& rng)
+{
+    std::vector<Query> queries;
+    std::uniform_int_distribution<size_t> pick_image(0, corpus.images.size() - 1);
+    while ((int)queries.size() < count) {
+        Query q;
+        const std::vector<Box>& image = corpus.images[pick_image(rng)];
+        if (image.empty()) continue;
+        const Box& box = image[std::uniform_int_distribution<size_t>(0, image.size() - 1)(rng)];
+        if (queries.size() % 2 == 0 && (int)box.ids.size() >= length) {
+            const size_t start = std::uniform_int_distribution<size_t>(0, box.ids.size() - length)(rng);
+            q.ids.assign(box.ids.begin() + start, box.ids.begin() + start + length);
+        } else {
+            for (int k = 0; k < length; k++) q.ids.push_back(chars.next(rng));
+        }
+        q.utf8 = to_utf8(q.ids);
+        queries.push_back(q);
+    }
+    return queries;
+}
+
+struct LengthResult {
+    int length = 0;
+    std::vector<double> index_ms;
+    std::vector<double> scan_ms;
+    long hits = 0;
+    int mismatches = 0;
+};
+
+// Runs the queries both ways; returns the number of disagreements
+static int check_queries(
+    const TextIndex& index, const Corpus& corpus, const std::vector<Query>& queries, LengthResult* result)
+{
+    int mismatches = 0;
+    for (const Query& q : queries) {
+        double t0 = now_ms();
+        std::vector<TextHit> hits = index.search(q.ids.data(), q.ids.size());
+        const double index_ms = now_ms() - t0;
+
+        t0 = now_ms();
+        std::set<std::pair<uint32_t, uint32_t>> expected = scan(corpus, q.utf8);
+        const double scan_ms = now_ms() - t0;
+
+        std::set<std::pair<uint32_t, uint32_t>> got;
+        bool positions_ok = true;
+        for (const TextHit& h : hits) {
+            got.insert({ h.image_id, h.box_id });
+            const std::vector<int>& ids = corpus.images[h.image_id][h.box_id].ids;
+            positions_ok = positions_ok && h.position + q.ids.size() <= ids.size()
+                && std::equal(q.ids.begin(), q.ids.end(), ids.begin() + h.position);
+        }
+        if (got != expected || got.size() != hits.size() || !positions_ok) mismatches++;
+
+        if (result) {
+            result->index_ms.push_back(index_ms);
+            result->scan_ms.push_back(scan_ms);
+            result->hits += (long)hits.size();
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        print_usage();
+        return 2;
+    }
+
+    std::mt19937 rng(opt.seed);
+    CharSource chars;
+    Corpus corpus;
+    const int image_count = (opt.lines + opt.boxes - 1) / opt.boxes;
+    long utf8_bytes = 0;
+    for (int i = 0; i < image_count; i++) {
+        corpus.images.push_back(make_image(std::min(opt.boxes, opt.lines - i * opt.boxes), chars, rng));
+        for (const Box& box : corpus.images.back()) utf8_bytes += (long)box.utf8.size();
+    }
+
+    TextIndex index;
+    double t0 = now_ms();
+    for (int i = 0; i < image_count; i++) index_image(index, (uint32_t)i, corpus.images[i]);
+    const double build_ms = now_ms() - t0;
+    const size_t memory_bytes = index.memory_bytes();
+    fprintf(stderr, "Indexed %zu lines of %d images in %.1f ms: %zu grams, %.1f MB (UTF-8 text %.1f MB)\n",
+        index.lines(), image_count, build_ms, index.grams(), memory_bytes / 1048576.0, utf8_bytes / 1048576.0);
+
+    int mismatches = 0;
+    std::vector<LengthResult> results;
+    for (int length : opt.lengths) {
+        LengthResult r;
+        r.length = length;
+        r.mismatches = check_queries(index, corpus, make_queries(corpus, length, opt.queries, chars, rng), &r);
+        mismatches += r.mismatches;
+        results.push_back(r);
+    }
+
+    // Re-index a share of the images with new text, as after re-running OCR
+    std::vector<uint32_t> order(image_count);
+    for (int i = 0; i < image_count; i++) order[i] = (uint32_t)i;
+    std::shuffle(order.begin(), order.end(), rng);
+    const size_t churned = (size_t)(image_count * opt.churn / 100.0);
+    std::vector<double> update_ms;
+    for (size_t k = 0; k < churned; k++) {
+        const uint32_t i = order[k];
+        corpus.images[i] = make_image((int)corpus.images[i].size(), chars, rng);
+        t0 = now_ms();
+        index.remove(i);
+        index_image(index, i, corpus.images[i]);
+        update_ms.push_back(now_ms() - t0);
+    }
+    const int query_length = opt.lengths.size() > 1 ? opt.lengths[1] : opt.lengths[0];
+    const int churn_mismatches
+        = check_queries(index, corpus, make_queries(corpus, query_length, opt.queries, chars, rng), nullptr);
+
+    // Remove three quarters of the images; one of the removals rebuilds the index
+    std::vector<double> remove_ms;
+    for (size_t k = 0; k < order.size() * 3 / 4; k++) {
+        t0 = now_ms();
+        index.remove(order[k]);
+        remove_ms.push_back(now_ms() - t0);
+        corpus.images[order[k]].clear();
+    }
+    const int shrink_mismatches
+        = check_queries(index, corpus, make_queries(corpus, query_length, opt.queries, chars, rng), nullptr);
+    mismatches += churn_mismatches + shrink_mismatches;
+
+    fprintf(stderr, "%-7s %10s %10s %10s %10s %9s %8s\n", "Length", "Index p50", "Index p95", "Scan p50", "Speedup",
+        "Hits/q", "Errors");
+    for (const LengthResult& r : results) {
+        const double idx = percentile(r.index_ms, 50), scan_p50 = percentile(r.scan_ms, 50);
+        fprintf(stderr, "%-7d %8.3fms %8.3fms %8.3fms %9.1fx %9.1f %8d\n", r.length, idx, percentile(r.index_ms, 95),
+            scan_p50, idx > 0 ? scan_p50 / idx : 0.0, (double)r.hits / r.index_ms.size(), r.mismatches);
+    }
+    fprintf(stderr, "Re-indexed %zu images: p50 %.3f ms, max %.3f ms (%d errors)\n", churned,
+        percentile(update_ms, 50), percentile(update_ms, 100), churn_mismatches);
+    fprintf(stderr, "Removed %zu images: p50 %.4f ms, max %.3f ms with rebuild (%d errors), %.1f MB left\n",
+        remove_ms.size(), percentile(remove_ms, 50), percentile(remove_ms, 100), shrink_mismatches,
+        index.memory_bytes() / 1048576.0);
+
+    std::ostringstream js;
+    js << "{\n";
+    js << "  \"variant\": \"" << build_variant() << "\",\n";
+    js << "  \"lines\": " << opt.lines << ",\n";
+    js << "  \"images\": " << image_count << ",\n";
+    js << "  \"build_ms\": " << build_ms << ",\n";
+    js << "  \"grams\": " << index.grams() << ",\n";
+    js << "  \"memory_bytes\": " << memory_bytes << ",\n";
+    js << "  \"utf8_bytes\": " << utf8_bytes << ",\n";
+    js << "  \"queries\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const LengthResult& r = results[i];
+        js << (i ? ",\n" : "\n") << "    {\"length\": " << r.length << ", \"index_ms\": {\"p50\": "
+           << percentile(r.index_ms, 50) << ", \"p95\": " << percentile(r.index_ms, 95)
+           << "}, \"scan_ms\": {\"p50\": " << percentile(r.scan_ms, 50) << ", \"p95\": " << percentile(r.scan_ms, 95)
+           << "}, \"hits\": " << r.hits << ", \"mismatches\": " << r.mismatches << "}";
+    }
+    js << "\n  ],\n";
+    js << "  \"reindex_ms\": {\"p50\": " << percentile(update_ms, 50) << ", \"max\": " << percentile(update_ms, 100)
+       << "},\n";
+    js << "  \"remove_ms\": {\"p50\": " << percentile(remove_ms, 50) << ", \"max\": " << percentile(remove_ms, 100)
+       << "},\n";
+    js << "  \"mismatches\": " << mismatches << "\n";
+    js << "}\n";
+
+    if (opt.out_path.empty()) {
+        fputs(js.str().c_str(), stdout);
+    } else {
+        FILE* f = fopen(opt.out_path.c_str(), "wb");
+        if (!f) {
+            fprintf(stderr, "Cannot write %s\n", opt.out_path.c_str());
+            return 1;
+        }
+        fputs(js.str().c_str(), f);
+        fclose(f);
+        fprintf(stderr, "Wrote %s\n", opt.out_path.c_str());
+    }
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,204 @@
+#!/usr/bin/env node
+// Cold-start benchmark for the test-wasm variants. Every run is a fresh Node
+// process, so module compile and instantiation are really cold (apart from
+// the OS file cache). A run is split into:
+//   compile, instantiate, runtime_init (pthread pool, preload data),
+//   param_parse, weight_read, pipeline (from the engine's load timings),
+//   warmup, first_detect, and second_detect as the steady-state reference.
+// The table also lists each variant's test-wasm.wasm size, so builds can be
+// compared for size and startup together.
+//
+// Usage: node tests/node/cold-start.cjs [options]
+//   --build DIR       variant bundles (default build/benchmark/www/benchmark)
+//   --models DIR      model directory (default assets/models)
+//   --variants LIST   comma separated subset of basic,simd,threads,simd-threads
+//   --formats LIST    text (*.ncnn.param) and/or bin (*.ncnn.param.bin); default text,bin
+//   --image FILE      image for the first detect (default tests/web/test.jpg)
+//   --runs N          processes per variant and format (default 5)
+//   --json FILE       also write every run as JSON
+const { execFileSync } = require('child_process');
+const fs = require('fs');
+const path = require('path');
+const { ROOT_DIR, VARIANTS, decodeImage, toHeap, percentile } = require('./lib/wasm.cjs');
+
+const FORMATS = {
+  text: '.ncnn.param',
+  bin: '.ncnn.param.bin',
+};
+
+const STAGES = [
+  'compile',
+  'instantiate',
+  'runtime_init',
+  'param_parse',
+  'weight_read',
+  'pipeline',
+  'warmup',
+  'first_detect',
+  'to_first_result',
+  'second_detect',
+];
+
+function allocString(module, str) {
+  const len = Buffer.byteLength(str) + 1;
+  const ptr = module._malloc(len);
+  module.stringToUTF8(str, ptr, len);
+  return ptr;
+}
+
+// One cold start inside this process; prints a JSON line
+async function child(buildDir, variantId, format, modelsDir, imagePath) {
+  const dir = path.join(buildDir, variantId);
+  const tStart = performance.now();
+  const bytes = fs.readFileSync(path.join(dir, 'test-wasm.wasm'));
+  const wasmModule = await WebAssembly.compile(bytes);
+  const tCompiled = performance.now();
+
+  let tInstantiated = 0;
+  const factory = require(path.join(dir, 'test-wasm.js'));
+  const module = await factory({
+    locateFile: (file) => path.join(dir, file),
+    print: () => {},
+    printErr: (text) => console.error(text),
+    instantiateWasm(imports, receiveInstance) {
+      const instance = new WebAssembly.Instance(wasmModule, imports);
+      tInstantiated = performance.now();
+      receiveInstance(instance, wasmModule);
+      return instance.exports;
+    },
+  });
+  const tReady = performance.now();
+
+  // Model files are staged in the VFS outside the timed region
+  const names = ['det', 'rec'].map((net) => `PP_OCRv5_mobile_${net}`);
+  const paths = [];
+  for (const name of names) {
+    for (const ext of [FORMATS[format], '.ncnn.bin']) {
+      const vfsPath = `/models/${name}${ext}`;
+      module.FS.writeFile(vfsPath, fs.readFileSync(path.join(modelsDir, name + ext)));
+      paths.push(vfsPath);
+    }
+  }
+  const ptrs = paths.map((p) => allocString(module, p));
+  const image = decodeImage(imagePath);
+  const imagePtr = toHeap(module, image);
+
+  const t0 = performance.now();
+  module._init_ocr_paths(ptrs[0], ptrs[1], ptrs[2], ptrs[3]);
+  const t1 = performance.now();
+  const load = JSON.parse(module.UTF8ToString(module._get_timings())).load;
+  module._warmup_model();
+  const t2 = performance.now();
+  module._detect(imagePtr, image.width, image.height);
+  const t3 = performance.now();
+  module._detect(imagePtr, image.width, image.height);
+  const t4 = performance.now();
+
+  const run = {
+    compile: tCompiled - tStart,
+    instantiate: tInstantiated - tCompiled,
+    runtime_init: tReady - tInstantiated,
+    param_parse: load.param_parse,
+    weight_read: load.weight_read,
+    pipeline: load.pipeline,
+    init_total: t1 - t0,
+    warmup: t2 - t1,
+    first_detect: t3 - t2,
+    second_detect: t4 - t3,
+  };
+  run.to_first_result = tReady - tStart + (t3 - t0);
+  process.stdout.write(JSON.stringify(run) + '\n');
+}
+
+function parseArgs(argv) {
+  const opts = {
+    build: path.join(ROOT_DIR, 'build', 'benchmark', 'www', 'benchmark'),
+    models: path.join(ROOT_DIR, 'assets', 'models'),
+    variants: VARIANTS.map((v) => v.id),
+    formats: Object.keys(FORMATS),
+    image: path.join(ROOT_DIR, 'tests', 'web', 'test.jpg'),
+    runs: 5,
+    json: null,
+  };
+  for (let i = 0; i < argv.length; i++) {
+    const arg = argv[i];
+    const next = () => {
+      if (i + 1 >= argv.length) throw new Error(`${arg} needs a value`);
+      return argv[++i];
+    };
+    if (arg === '--build') opts.build = path.resolve(next());
+    else if (arg === '--models') opts.models = path.resolve(next());
+    else if (arg === '--variants') opts.variants = next().split(',');
+    else if (arg === '--formats') opts.formats = next().split(',');
+    else if (arg === '--image') opts.image = path.resolve(next());
+    else if (arg === '--runs') opts.runs = Math.max(1, parseInt(next(), 10));
+    else if (arg === '--json') opts.json = path.resolve(next());
+    else throw new Error(`Unknown option ${arg}`);
+  }
+  return opts;
+}
+
+function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  const rows = [];
+  const report = [];
+
+  for (const id of opts.variants) {
+    const variant = VARIANTS.find((v) => v.id === id);
+    if (!variant) throw new Error(`Unknown variant ${id}`);
+    for (const format of opts.formats) {
+      if (!FORMATS[format]) throw new Error(`Unknown format ${format}`);
+      const param = path.join(opts.models, `PP_OCRv5_mobile_det${FORMATS[format]}`);
+      if (!fs.existsSync(param)) {
+        console.error(`${variant.name}/${format}: ${param} not found, skipping`);
+        continue;
+      }
+
+      const runs = [];
+      for (let r = 0; r < opts.runs; r++) {
+        const out = execFileSync(
+          process.execPath,
+          [__filename, '--child', opts.build, id, format, opts.models, opts.image],
+          { encoding: 'utf8', stdio: ['ignore', 'pipe', 'inherit'] },
+        );
+        runs.push(JSON.parse(out.trim().split('\n').pop()));
+      }
+      const median = {};
+      for (const stage of STAGES) median[stage] = percentile(runs.map((run) => run[stage]), 50);
+      const wasmBytes = fs.statSync(path.join(opts.build, id, 'test-wasm.wasm')).size;
+      rows.push({ label: `${variant.name} ${format}`, median, wasmBytes });
+      report.push({ variant: id, format, wasm_bytes: wasmBytes, median, runs });
+      console.error(`${variant.name}/${format}: first result ${median.to_first_result.toFixed(0)} ms`);
+    }
+  }
+
+  // Median over runs, ms
+  const header = ['Variant', 'wasm_kb', ...STAGES];
+  const cells = rows.map((r) => [
+    r.label,
+    (r.wasmBytes / 1024).toFixed(0),
+    ...STAGES.map((s) => r.median[s].toFixed(1)),
+  ]);
+  const widths = header.map((h, c) => Math.max(h.length, ...cells.map((row) => row[c].length)));
+  const line = (row) => row.map((cell, c) => cell.padEnd(widths[c])).join('  ');
+  console.log(line(header));
+  console.log(widths.map((w) => '-'.repeat(w)).join('  '));
+  cells.forEach((row) => console.log(line(row)));
+
+  if (opts.json) {
+    fs.writeFileSync(opts.json, JSON.stringify({ node: process.version, results: report }, null, 2));
+    console.log(`\nWrote ${opts.json}`);
+  }
+}
+
+if (process.argv[2] === '--child') {
+  const [, , , buildDir, variantId, format, modelsDir, imagePath] = process.argv;
+  child(buildDir, variantId, format, modelsDir, imagePath)
+    .then(() => process.exit(0))
+    .catch((e) => {
+      console.error(e);
+      process.exit(1);
+    });
+} else {
+  main();
+}
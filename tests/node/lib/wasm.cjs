@@ -0,0 +1,104 @@
+// Helpers for driving the test-wasm bundles (build.sh benchmark) from Node.
+// Threads variants run their pthreads on worker_threads.
+const fs = require('fs');
+const path = require('path');
+
+const ROOT_DIR = path.resolve(__dirname, '..', '..', '..');
+
+const VARIANTS = [
+  { id: 'basic', name: 'Basic', exportName: 'createTestModuleBasic' },
+  { id: 'simd', name: 'SIMD', exportName: 'createTestModuleSimd' },
+  { id: 'threads', name: 'Threads', exportName: 'createTestModuleThreads' },
+  { id: 'simd-threads', name: 'SIMD+Threads', exportName: 'createTestModuleSimdThreads' },
+];
+
+const MODEL_FILES = [
+  'PP_OCRv5_mobile_det.ncnn.param',
+  'PP_OCRv5_mobile_det.ncnn.bin',
+  'PP_OCRv5_mobile_rec.ncnn.param',
+  'PP_OCRv5_mobile_rec.ncnn.bin',
+];
+
+// Instantiates one variant from `<buildDir>/<id>/test-wasm.js`. Models are
+// written from `modelsDir` over the preloaded copies, so the working tree's
+// models are measured without rebuilding. Returns { module, loadMs, initMs }.
+async function loadVariant(buildDir, variant, modelsDir, quiet = true) {
+  const dir = path.join(buildDir, variant.id);
+  const script = path.join(dir, 'test-wasm.js');
+  if (!fs.existsSync(script)) {
+    throw new Error(`${script} not found (run ./scripts/build.sh benchmark)`);
+  }
+
+  const t0 = performance.now();
+  const factory = require(script);
+  const module = await factory({
+    locateFile: (file) => path.join(dir, file),
+    print: quiet ? () => {} : (text) => console.log(`[${variant.name}] ${text}`),
+    printErr: (text) => console.error(`[${variant.name} ERR] ${text}`),
+  });
+  const t1 = performance.now();
+
+  if (modelsDir) {
+    for (const file of MODEL_FILES) {
+      module.FS.writeFile(`/models/${file}`, fs.readFileSync(path.join(modelsDir, file)));
+    }
+  }
+  const res = module._init_ocr();
+  if (res !== 0) throw new Error(`init_ocr failed with code ${res}`);
+  const t2 = performance.now();
+
+  return { module, loadMs: t1 - t0, initMs: t2 - t1 };
+}
+
+// Decodes a PNG or JPEG file into { name, width, height, data } (RGBA)
+function decodeImage(file) {
+  const buf = fs.readFileSync(file);
+  const name = path.basename(file);
+  if (buf[0] === 0x89 && buf[1] === 0x50) {
+    const { PNG } = require('pngjs');
+    const png = PNG.sync.read(buf);
+    return { name, width: png.width, height: png.height, data: new Uint8Array(png.data) };
+  }
+  const jpeg = require('jpeg-js');
+  const img = jpeg.decode(buf, { useTArray: true, formatAsRGBA: true, maxMemoryUsageInMB: 1024 });
+  return { name, width: img.width, height: img.height, data: img.data };
+}
+
+// Image files from a list of files and/or directories
+function collectImages(inputs) {
+  const files = [];
+  for (const input of inputs) {
+    if (fs.statSync(input).isDirectory()) {
+      for (const entry of fs.readdirSync(input).sort()) {
+        if (/\.(png|jpe?g)$/i.test(entry)) files.push(path.join(input, entry));
+      }
+    } else {
+      files.push(input);
+    }
+  }
+  return files;
+}
+
+// Copies an image into the module heap; the caller frees the pointer
+function toHeap(module, image) {
+  const ptr = module._malloc(image.data.length);
+  module.HEAPU8.set(image.data, ptr);
+  return ptr;
+}
+
+function percentile(values, p) {
+  if (values.length === 0) return 0;
+  const sorted = [...values].sort((a, b) => a - b);
+  const rank = Math.max(1, Math.ceil((p / 100) * sorted.length));
+  return sorted[Math.min(rank, sorted.length) - 1];
+}
+
+module.exports = {
+  ROOT_DIR,
+  VARIANTS,
+  loadVariant,
+  decodeImage,
+  collectImages,
+  toHeap,
+  percentile,
+};
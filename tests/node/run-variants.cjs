@@ -0,0 +1,171 @@
+#!/usr/bin/env node
+// Runs the basic/simd/threads/simd-threads test-wasm bundles on a fixed image
+// set in Node and prints a comparison table.
+//
+// Usage: node tests/node/run-variants.cjs [images...] [options]
+//   --build DIR       variant bundles (default build/benchmark/www/benchmark)
+//   --models DIR      model files written into each module (default assets/models)
+//   --variants LIST   comma separated subset, e.g. simd,simd-threads
+//   --warmup N        untimed detect calls per image (default 2)
+//   --repeat N        timed detect calls per image (default 5)
+//   --threads N       thread budget for threads variants (default: engine default)
+//   --json FILE       also write the results as JSON
+//   --trace DIR       write a Chrome trace of the timed calls per variant (DIR/<variant>.trace.json)
+// Images default to tests/web/test.jpg.
+const fs = require('fs');
+const path = require('path');
+const {
+  ROOT_DIR,
+  VARIANTS,
+  loadVariant,
+  decodeImage,
+  collectImages,
+  toHeap,
+  percentile,
+} = require('./lib/wasm.cjs');
+
+function parseArgs(argv) {
+  const opts = {
+    build: path.join(ROOT_DIR, 'build', 'benchmark', 'www', 'benchmark'),
+    models: path.join(ROOT_DIR, 'assets', 'models'),
+    variants: VARIANTS.map((v) => v.id),
+    warmup: 2,
+    repeat: 5,
+    threads: 0,
+    json: null,
+    trace: null,
+    images: [],
+  };
+  for (let i = 0; i < argv.length; i++) {
+    const arg = argv[i];
+    const next = () => {
+      if (i + 1 >= argv.length) throw new Error(`${arg} needs a value`);
+      return argv[++i];
+    };
+    if (arg === '--build') opts.build = path.resolve(next());
+    else if (arg === '--models') opts.models = path.resolve(next());
+    else if (arg === '--variants') opts.variants = next().split(',');
+    else if (arg === '--warmup') opts.warmup = Math.max(0, parseInt(next(), 10));
+    else if (arg === '--repeat') opts.repeat = Math.max(1, parseInt(next(), 10));
+    else if (arg === '--threads') opts.threads = Math.max(0, parseInt(next(), 10));
+    else if (arg === '--json') opts.json = path.resolve(next());
+    else if (arg === '--trace') opts.trace = path.resolve(next());
+    else if (arg.startsWith('--')) throw new Error(`Unknown option ${arg}`);
+    else opts.images.push(arg);
+  }
+  if (opts.images.length === 0) opts.images.push(path.join(ROOT_DIR, 'tests', 'web', 'test.jpg'));
+  return opts;
+}
+
+async function runVariant(variant, images, opts) {
+  const { module, loadMs, initMs } = await loadVariant(opts.build, variant, opts.models);
+  if (opts.threads > 0 && variant.id.includes('threads')) module._set_num_threads(opts.threads);
+
+  const t0 = performance.now();
+  module._warmup_model();
+  const warmupMs = performance.now() - t0;
+
+  const samples = [];
+  const perImage = [];
+  if (opts.trace) module._start_trace(1 << 20);
+  for (const image of images) {
+    const ptr = toHeap(module, image);
+    for (let i = 0; i < opts.warmup; i++) module._detect(ptr, image.width, image.height);
+
+    const times = [];
+    let boxes = 0;
+    for (let i = 0; i < opts.repeat; i++) {
+      const start = performance.now();
+      const resPtr = module._detect(ptr, image.width, image.height);
+      times.push(performance.now() - start);
+      if (i === 0) boxes = JSON.parse(module.UTF8ToString(resPtr)).length;
+    }
+    module._free(ptr);
+
+    samples.push(...times);
+    perImage.push({ name: image.name, boxes, p50: percentile(times, 50) });
+  }
+
+  if (opts.trace) {
+    module._stop_trace();
+    fs.mkdirSync(opts.trace, { recursive: true });
+    const tracePath = path.join(opts.trace, `${variant.id}.trace.json`);
+    fs.writeFileSync(tracePath, module.UTF8ToString(module._export_trace()));
+    console.error(`${variant.name}: wrote ${tracePath}`);
+  }
+
+  return {
+    id: variant.id,
+    name: variant.name,
+    poolSize: module.pthreadPoolSize || 0,
+    loadMs,
+    initMs,
+    warmupMs,
+    mean: samples.reduce((a, b) => a + b, 0) / samples.length,
+    p50: percentile(samples, 50),
+    p95: percentile(samples, 95),
+    min: Math.min(...samples),
+    heapMB: module.HEAPU8.length / (1024 * 1024),
+    perImage,
+  };
+}
+
+function printTable(results) {
+  const base = results.find((r) => r.id === 'basic');
+  const columns = [
+    ['Variant', (r) => r.name],
+    ['Pool', (r) => (r.poolSize ? String(r.poolSize) : '-')],
+    ['Load', (r) => r.loadMs.toFixed(0) + 'ms'],
+    ['Init', (r) => r.initMs.toFixed(0) + 'ms'],
+    ['Warmup', (r) => r.warmupMs.toFixed(0) + 'ms'],
+    ['Mean', (r) => r.mean.toFixed(2) + 'ms'],
+    ['p50', (r) => r.p50.toFixed(2) + 'ms'],
+    ['p95', (r) => r.p95.toFixed(2) + 'ms'],
+    ['Min', (r) => r.min.toFixed(2) + 'ms'],
+    ['Heap', (r) => r.heapMB.toFixed(0) + 'MB'],
+    ['vs Basic', (r) => (base ? (base.p50 / r.p50).toFixed(2) + 'x' : '-')],
+  ];
+  const rows = results.map((r) => columns.map(([, fn]) => fn(r)));
+  const widths = columns.map(([title], c) => Math.max(title.length, ...rows.map((row) => row[c].length)));
+  const line = (cells) => cells.map((cell, c) => cell.padEnd(widths[c])).join('  ');
+  console.log(line(columns.map(([title]) => title)));
+  console.log(widths.map((w) => '-'.repeat(w)).join('  '));
+  rows.forEach((row) => console.log(line(row)));
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  const images = collectImages(opts.images).map(decodeImage);
+  console.log(
+    `Images: ${images.map((i) => `${i.name} (${i.width}x${i.height})`).join(', ')}; ` +
+      `warmup ${opts.warmup}, repeat ${opts.repeat}`,
+  );
+
+  const results = [];
+  for (const id of opts.variants) {
+    const variant = VARIANTS.find((v) => v.id === id);
+    if (!variant) throw new Error(`Unknown variant ${id}`);
+    try {
+      results.push(await runVariant(variant, images, opts));
+      console.error(`${variant.name}: done`);
+    } catch (e) {
+      console.error(`${variant.name}: ${e.message}`);
+    }
+  }
+
+  console.log('');
+  printTable(results);
+
+  if (opts.json) {
+    const report = { node: process.version, warmup: opts.warmup, repeat: opts.repeat, results };
+    fs.writeFileSync(opts.json, JSON.stringify(report, null, 2));
+    console.log(`\nWrote ${opts.json}`);
+  }
+}
+
+main()
+  .then(() => process.exit(0))
+  .catch((e) => {
+    console.error(e);
+    process.exit(1);
+  });
@@ -1,7 +1,8 @@
 #include "../../src/core/log.h"
 #include "../../src/core/ocr_engine.h"
+#include "../../src/core/trace.h"
 #include <emscripten.h>
-#include <iostream>
+#include <sstream>
 #include <string>
 #include <unistd.h> // for unlink
 #include <vector>
@@ -29,6 +30,36 @@ int init_ocr()
     return 0;
 }
 
+// Initialize (Explicit Paths, e.g. binary .param.bin or fp16 weights)
+EMSCRIPTEN_KEEPALIVE
+int init_ocr_paths(const char* det_param, const char* det_bin, const char* rec_param, const char* rec_bin)
+{
+    if (g_ocr) delete g_ocr;
+    g_ocr = new OCREngine();
+    g_ocr->load_model(det_param, det_bin, rec_param, rec_bin);
+    return 0;
+}
+
+// Load and last-call stage timings as JSON (ms)
+EMSCRIPTEN_KEEPALIVE
+const char* get_timings()
+{
+    if (!g_ocr) return "{}";
+    const LoadTimings& l = g_ocr->load_timings();
+    const StageTimings& t = g_ocr->last_timings();
+    std::ostringstream ss;
+    ss << "{\"load\":{\"param_parse\":" << l.param_parse << ",\"weight_read\":" << l.weight_read
+       << ",\"pipeline\":" << l.pipeline << "},\"stages\":{\"det_preprocess\":" << t.det_preprocess
+       << ",\"det_inference\":" << t.det_inference << ",\"det_postprocess\":" << t.det_postprocess
+       << ",\"rec_preprocess\":" << t.rec_preprocess << ",\"rec_inference\":" << t.rec_inference
+       << ",\"rec_decode\":" << t.rec_decode << ",\"layout\":" << t.layout << ",\"total\":" << t.total
+       << ",\"frame_diff\":" << t.frame_diff << ",\"boxes\":" << t.boxes << ",\"boxes_reused\":" << t.boxes_reused
+       << ",\"tiles\":" << t.tiles << ",\"tiles_changed\":" << t.tiles_changed << "}}";
+    static std::string ret_cache;
+    ret_cache = ss.str();
+    return ret_cache.c_str();
+}
+
 // Detect Wrapper
 EMSCRIPTEN_KEEPALIVE
 const char* detect(unsigned char* rgba_data, int width, int height)
@@ -44,6 +75,141 @@ const char* detect(unsigned char* rgba_data, int width, int height)
     return ret_cache.c_str();
 }
 
+// Batch Detect Wrapper
+EMSCRIPTEN_KEEPALIVE
+const char* detect_batch(unsigned char** rgba_ptrs, int* widths, int* heights, int count)
+{
+    if (!g_ocr) {
+        return "{\"error\": \"Model not initialized\"}";
+    }
+
+    std::string json_result = g_ocr->detect_batch(rgba_ptrs, widths, heights, count);
+
+    static std::string ret_cache;
+    ret_cache = json_result;
+    return ret_cache.c_str();
+}
+
+// Thread Budget Wrapper
+EMSCRIPTEN_KEEPALIVE
+void set_num_threads(int num_threads)
+{
+    if (g_ocr) g_ocr->set_num_threads(num_threads);
+}
+
+// Rolling Latency Percentiles (JSON)
+EMSCRIPTEN_KEEPALIVE
+const char* get_latency_stats()
+{
+    if (!g_ocr) return "{}";
+    static std::string ret_cache;
+    ret_cache = g_ocr->latency_stats_json();
+    return ret_cache.c_str();
+}
+
+EMSCRIPTEN_KEEPALIVE
+void reset_latency_stats()
+{
+    if (g_ocr) g_ocr->reset_latency_stats();
+}
+
+// Sequence mode: rerun det/rec only where the frame changed (tile_size 0 disables)
+EMSCRIPTEN_KEEPALIVE
+void set_sequence_mode(int tile_size, int margin)
+{
+    if (g_ocr) g_ocr->set_sequence_mode(tile_size, margin);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void reset_sequence()
+{
+    if (g_ocr) g_ocr->reset_sequence();
+}
+
+// Per-Layer Profiling (det/rec inference layer by layer)
+EMSCRIPTEN_KEEPALIVE
+void set_layer_profiling(int enabled)
+{
+    if (g_ocr) g_ocr->set_layer_profiling(enabled != 0);
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char* get_layer_profile()
+{
+    if (!g_ocr) return "{}";
+    static std::string ret_cache;
+    ret_cache = g_ocr->layer_profile_json();
+    return ret_cache.c_str();
+}
+
+EMSCRIPTEN_KEEPALIVE
+void reset_layer_profile()
+{
+    if (g_ocr) g_ocr->reset_layer_profile();
+}
+
+// Tracing Wrappers
+EMSCRIPTEN_KEEPALIVE
+void start_trace(int capacity)
+{
+    if (capacity > 0)
+        trace::start(capacity);
+    else
+        trace::start();
+}
+
+EMSCRIPTEN_KEEPALIVE
+void stop_trace()
+{
+    trace::stop();
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char* export_trace()
+{
+    static std::string ret_cache;
+    ret_cache = trace::export_json();
+    return ret_cache.c_str();
+}
+
+// Logging (levels: 0 debug, 1 info, 2 warn, 3 error, 4 off)
+EMSCRIPTEN_KEEPALIVE
+void set_log_level(int level)
+{
+    logger::set_level(level);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void set_log_echo_level(int level)
+{
+    logger::set_echo_level(level);
+}
+
+// Buffered log records as a JSON array; clears the buffer
+EMSCRIPTEN_KEEPALIVE
+const char* get_logs()
+{
+    static std::string ret_cache;
+    ret_cache = logger::drain_json();
+    return ret_cache.c_str();
+}
+
+// Det Preprocess Scaling Benchmark (ms per iteration)
+EMSCRIPTEN_KEEPALIVE
+double bench_det_preprocess(unsigned char* rgba_data, int width, int height, int num_threads, int iterations)
+{
+    if (!g_ocr) return -1.0;
+    return g_ocr->benchmark_det_preprocess(rgba_data, width, height, num_threads, iterations);
+}
+
+// Det Postprocess Scaling Benchmark (ms per iteration)
+EMSCRIPTEN_KEEPALIVE
+double bench_det_postprocess(unsigned char* rgba_data, int width, int height, int num_threads, int iterations)
+{
+    if (!g_ocr) return -1.0;
+    return g_ocr->benchmark_det_postprocess(rgba_data, width, height, num_threads, iterations);
+}
+
 // Warmup
 EMSCRIPTEN_KEEPALIVE
 void warmup_model()